@@ -0,0 +1,124 @@
+#ifndef __BENCHMARKS_H__
+#define __BENCHMARKS_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <malloc.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#ifdef __linux__
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+
+// 单调时钟，单位纳秒
+static inline long long benchNanotime(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// CPU周期计数，x86上读取TSC，其他平台退化为纳秒
+static inline unsigned long long benchCycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (unsigned long long)benchNanotime();
+#endif
+}
+
+// 当前堆上已分配的字节数（包括mmap分配的大块）
+static inline size_t benchHeapUsed(void) {
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+}
+
+// 当前进程的常驻内存（RSS），单位字节
+static inline size_t benchRss(void) {
+    FILE *fp = fopen("/proc/self/statm", "r");
+    long pages = 0;
+
+    if (fp) {
+        if (fscanf(fp, "%*s %ld", &pages) != 1) pages = 0;
+        fclose(fp);
+    }
+    return (size_t)pages * sysconf(_SC_PAGESIZE);
+}
+
+// 打开当前线程用户态的dTLB读缺失计数器，不支持时（如部分虚拟机）返回-1
+static inline int benchPerfOpenDtlbMiss(void) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+// 计数器清零并开始计数
+static inline void benchPerfStart(int fd) {
+#ifdef __linux__
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+// 停止计数并返回计数值，计数器不可用时返回-1
+static inline long long benchPerfStop(int fd) {
+    long long count = -1;
+#ifdef __linux__
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+            count = -1;
+        }
+    }
+#endif
+    return count;
+}
+
+// 每秒操作数（百万）
+#define BENCH_MOPS(ops, ns) ((double)(ops) * 1000.0 / (double)((ns) ? (ns) : 1))
+
+void oadictBench(int argc, char **argv);
+void findManyBench(int argc, char **argv);
+void poolBench(int argc, char **argv);
+void layoutBench(int argc, char **argv);
+void intdictBench(int argc, char **argv);
+void templateBench(int argc, char **argv);
+void hashBench(int argc, char **argv);
+void siphashMultiBench(int argc, char **argv);
+void batchHashBench(int argc, char **argv);
+void concurrentBench(int argc, char **argv);
+void rcuBench(int argc, char **argv);
+void randomBench(int argc, char **argv);
+void rehashSchedBench(int argc, char **argv);
+void bulkBench(int argc, char **argv);
+void hugePageBench(int argc, char **argv);
+void lazyfreeBench(int argc, char **argv);
+void sdsMemoryBench(int argc, char **argv);
+void sdsKeysBench(int argc, char **argv);
+void sdsIntegerBench(int argc, char **argv);
+void sdsCatFmtBench(int argc, char **argv);
+void sdsOpsBench(int argc, char **argv);
+void sdsBuildBench(int argc, char **argv);
+
+#endif
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "concurrentdict.h"
+#include "benchmarks.h"
+
+
+static uint64_t intHashCallback(const void *key) {
+    return dictGenHashFunction(&key, sizeof(key));
+}
+
+static dictType intKeyType = {intHashCallback, NULL, NULL, NULL, NULL, NULL};
+
+typedef struct concurrentBenchArg {
+    concurrentDict *cd;
+    long ops;
+    long keyspace;
+    int readPercent;
+    uint64_t seed;
+    pthread_barrier_t *barrier;
+} concurrentBenchArg;
+
+
+// xorshift64*，每个线程独立的随机数
+static inline uint64_t benchRandom(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static void *concurrentBenchThread(void *privdata) {
+    concurrentBenchArg *arg = privdata;
+    uint64_t state = arg->seed;
+    long j;
+
+    pthread_barrier_wait(arg->barrier);
+    for (j = 0; j < arg->ops; j++) {
+        uint64_t r = benchRandom(&state);
+        void *key = (void *)(long)(r % arg->keyspace + 1);
+
+        if ((long)((r >> 40) % 100) < arg->readPercent) {
+            concurrentDictFind(arg->cd, key, NULL);
+        } else if (concurrentDictDelete(arg->cd, key) == DICT_ERR) {
+            // 写操作在删除和添加之间切换，键的总数保持稳定
+            concurrentDictAdd(arg->cd, key, key);
+        }
+    }
+    return NULL;
+}
+
+static double benchConcurrentRun(int shardbits, int threads, int readPercent, long keyspace, long ops) {
+    concurrentDict *cd = concurrentDictCreate(&intKeyType, NULL, shardbits);
+    concurrentBenchArg args[64];
+    pthread_t tids[64];
+    pthread_barrier_t barrier;
+    long long start, ns;
+    long j;
+    int i;
+
+    // 预先放入一半的键
+    for (j = 1; j <= keyspace; j += 2) {
+        concurrentDictAdd(cd, (void *)j, (void *)j);
+    }
+    while (concurrentDictRehashMilliseconds(cd, 100));
+
+    pthread_barrier_init(&barrier, NULL, threads + 1);
+    for (i = 0; i < threads; i++) {
+        args[i].cd = cd;
+        args[i].ops = ops / threads;
+        args[i].keyspace = keyspace;
+        args[i].readPercent = readPercent;
+        args[i].seed = 0x9E3779B97F4A7C15ULL * (i + 1);
+        args[i].barrier = &barrier;
+        pthread_create(&tids[i], NULL, concurrentBenchThread, &args[i]);
+    }
+    pthread_barrier_wait(&barrier);
+    start = benchNanotime();
+    for (i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    ns = benchNanotime() - start;
+
+    pthread_barrier_destroy(&barrier);
+    concurrentDictRelease(cd);
+    return BENCH_MOPS(ops / threads * threads, ns);
+}
+
+/**
+ * concurrentDict在不同线程数和读写比例下的吞吐量
+ * 用法：benchapp concurrent [ops] [keyspace] [shardbits]
+ * shardbits为0时整个字典只有一把锁，作为对照。
+ */
+void concurrentBench(int argc, char **argv) {
+    static const int threads[] = {1, 2, 4, 8, 16, 32, 64};
+    static const int mixes[] = {90, 50};
+    long ops = argc > 0 ? atol(argv[0]) : 4000000;
+    long keyspace = argc > 1 ? atol(argv[1]) : 1000000;
+    int shardbits = argc > 2 ? atoi(argv[2]) : 6;
+    unsigned long m, t;
+
+    printf("online cpus: %ld, keyspace: %ld, ops: %ld\n", sysconf(_SC_NPROCESSORS_ONLN), keyspace, ops);
+    printf("%-8s %-7s %14s %14s\n", "threads", "reads%", "1 lock Mops/s", "sharded Mops/s");
+    for (m = 0; m < sizeof(mixes) / sizeof(mixes[0]); m++) {
+        for (t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+            double single = benchConcurrentRun(0, threads[t], mixes[m], keyspace, ops);
+            double sharded = benchConcurrentRun(shardbits, threads[t], mixes[m], keyspace, ops);
+
+            printf("%-8d %-7d %14.2f %14.2f\n", threads[t], mixes[m], single, sharded);
+        }
+    }
+}
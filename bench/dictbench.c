@@ -0,0 +1,846 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "dict.h"
+#include "oadict.h"
+#include "intdict.h"
+#include "sds.h"
+#include "lazyfree.h"
+#include "benchmarks.h"
+
+
+/* 与test/dicttest.c相同的sds键回调 */
+static uint64_t hashCallback(const void *key) {
+    return dictGenHashFunction((unsigned char*)key, sdslen((char*)key));
+}
+
+static int compareCallback(void *privdata, const void *key1, const void *key2) {
+    int l1,l2;
+    DICT_NOTUSED(privdata);
+
+    l1 = sdslen((sds)key1);
+    l2 = sdslen((sds)key2);
+    if (l1 != l2) return 0;
+    return memcmp(key1, key2, l1) == 0;
+}
+
+static void freeCallback(void *privdata, void *val) {
+    DICT_NOTUSED(privdata);
+
+    sdsfree(val);
+}
+
+static dictType sdsKeyType = {
+    hashCallback,
+    NULL,
+    NULL,
+    compareCallback,
+    freeCallback,
+    NULL
+};
+
+
+// 生成count个键，shuffle不为0时打乱顺序
+static sds *benchCreateKeys(long count, long offset, int shuffle) {
+    sds *keys = malloc(sizeof(sds) * count);
+    long j;
+
+    for (j = 0; j < count; j++) {
+        keys[j] = sdsfromlonglong(j + offset);
+    }
+    if (shuffle) {
+        for (j = count - 1; j > 0; j--) {
+            long r = random() % (j + 1);
+            sds tmp = keys[j];
+            keys[j] = keys[r];
+            keys[r] = tmp;
+        }
+    }
+    return keys;
+}
+
+static void benchFreeKeys(sds *keys, long count) {
+    long j;
+
+    for (j = 0; j < count; j++) {
+        sdsfree(keys[j]);
+    }
+    free(keys);
+}
+
+
+/* --------------------------- dict vs oadict ------------------------------- */
+
+typedef struct dictOps {
+    const char *name;
+    void *(*create)(dictType *type);
+    int (*add)(void *d, void *key, void *val);
+    void *(*find)(void *d, const void *key);
+    void (*release)(void *d);
+    void (*finishRehash)(void *d);
+} dictOps;
+
+static void *chainedCreate(dictType *type) { return dictCreate(type, NULL); }
+static int chainedAdd(void *d, void *key, void *val) { return dictAdd(d, key, val); }
+static void *chainedFind(void *d, const void *key) { return dictFind(d, key); }
+static void chainedRelease(void *d) { dictRelease(d); }
+static void chainedFinishRehash(void *d) { while (dictRehash(d, 100)); }
+
+static void *oaCreate(dictType *type) { return oadictCreate(type, NULL); }
+static int oaAdd(void *d, void *key, void *val) { return oadictAdd(d, key, val); }
+static void *oaFind(void *d, const void *key) { return oadictFind(d, key); }
+static void oaRelease(void *d) { oadictRelease(d); }
+static void oaFinishRehash(void *d) { while (oadictRehash(d, 100)); }
+
+static dictOps chainedOps = {"dict", chainedCreate, chainedAdd, chainedFind, chainedRelease, chainedFinishRehash};
+static dictOps oaOps = {"oadict", oaCreate, oaAdd, oaFind, oaRelease, oaFinishRehash};
+
+
+static void benchDictOps(dictOps *ops, long count, long lookups) {
+    sds *keys = benchCreateKeys(count, 0, 1);
+    sds *hits = benchCreateKeys(lookups, 0, 1);
+    sds *misses = benchCreateKeys(lookups, count, 1);
+    long long start, insert_ns, hit_ns, miss_ns;
+    size_t heap;
+    long j, found = 0;
+    void *d;
+
+    heap = benchHeapUsed();
+    d = ops->create(&sdsKeyType);
+
+    start = benchNanotime();
+    for (j = 0; j < count; j++) {
+        ops->add(d, keys[j], NULL);
+    }
+    insert_ns = benchNanotime() - start;
+
+    // 在稳定状态下统计内存和查找性能
+    ops->finishRehash(d);
+    heap = benchHeapUsed() - heap;
+
+    start = benchNanotime();
+    for (j = 0; j < lookups; j++) {
+        found += ops->find(d, hits[j]) != NULL;
+    }
+    hit_ns = benchNanotime() - start;
+
+    start = benchNanotime();
+    for (j = 0; j < lookups; j++) {
+        found += ops->find(d, misses[j]) != NULL;
+    }
+    miss_ns = benchNanotime() - start;
+
+    printf("%-8s keys=%-10ld insert=%6.2f Mops/s  hit=%6.2f Mops/s  miss=%6.2f Mops/s  "
+           "bytes/key=%5.1f  (found %ld)\n",
+           ops->name, count,
+           BENCH_MOPS(count, insert_ns), BENCH_MOPS(lookups, hit_ns), BENCH_MOPS(lookups, miss_ns),
+           (double)heap / count, found);
+
+    // 键归字典所有，由dictRelease释放
+    free(keys);
+    ops->release(d);
+    benchFreeKeys(hits, lookups);
+    benchFreeKeys(misses, lookups);
+}
+
+
+/**
+ * 对比链式dict与开放寻址oadict的插入、查找吞吐量和每个键的额外内存
+ * 参数：键数量列表，缺省为1000000
+ * bytes/key只统计rehash完成后的哈希表和节点，不包括sds键本身
+ */
+void oadictBench(int argc, char **argv) {
+    long counts[16];
+    int i, n = 0;
+
+    for (i = 0; i < argc && n < 16; i++) {
+        counts[n++] = atol(argv[i]);
+    }
+    if (n == 0) {
+        counts[n++] = 1000000;
+    }
+
+    for (i = 0; i < n; i++) {
+        long lookups = counts[i] < 1000000 ? counts[i] : 1000000;
+        benchDictOps(&chainedOps, counts[i], lookups);
+        benchDictOps(&oaOps, counts[i], lookups);
+    }
+}
+
+
+/* --------------------------- dictFindMany --------------------------------- */
+
+/**
+ * 对比循环调用dictFind与dictFindMany的查找吞吐量
+ * 参数：键数量（缺省4000000，应远大于LLC），每批键数量列表（缺省16 64）
+ */
+void findManyBench(int argc, char **argv) {
+    long count = argc > 0 ? atol(argv[0]) : 4000000;
+    long lookups = count < 4000000 ? count : 4000000;
+    long batches[16] = {16, 64};
+    int nbatches = 2, i;
+    sds *keys = benchCreateKeys(count, 0, 0);
+    sds *probes = benchCreateKeys(lookups, 0, 1);
+    dictEntry **out = malloc(sizeof(dictEntry *) * lookups);
+    dict *d = dictCreate(&sdsKeyType, NULL);
+    long long start, ns;
+    long j, found;
+
+    if (argc > 1) {
+        for (nbatches = 0, i = 1; i < argc && nbatches < 16; i++) {
+            batches[nbatches++] = atol(argv[i]);
+        }
+    }
+
+    for (j = 0; j < count; j++) {
+        dictAdd(d, keys[j], NULL);
+    }
+    while (dictRehash(d, 100));
+
+    start = benchNanotime();
+    for (found = 0, j = 0; j < lookups; j++) {
+        found += dictFind(d, probes[j]) != NULL;
+    }
+    ns = benchNanotime() - start;
+    printf("dictFind      keys=%-10ld           %6.2f Mops/s  (found %ld)\n",
+           count, BENCH_MOPS(lookups, ns), found);
+
+    for (i = 0; i < nbatches; i++) {
+        long batch = batches[i];
+
+        start = benchNanotime();
+        for (found = 0, j = 0; j < lookups; j += batch) {
+            long len = (lookups - j < batch) ? lookups - j : batch;
+            found += dictFindMany(d, (const void **)probes + j, len, out + j);
+        }
+        ns = benchNanotime() - start;
+        printf("dictFindMany  keys=%-10ld batch=%-4ld %6.2f Mops/s  (found %ld)\n",
+               count, batch, BENCH_MOPS(lookups, ns), found);
+    }
+
+    free(keys);
+    dictRelease(d);
+    benchFreeKeys(probes, lookups);
+    free(out);
+}
+
+
+/* --------------------------- dictEntry pool ------------------------------- */
+
+/* 整数直接作为键指针，只有节点需要分配内存 */
+static uint64_t intHashCallback(const void *key) {
+    return dictGenHashFunction((const unsigned char *)&key, sizeof(key));
+}
+
+static dictType intKeyType = {intHashCallback, NULL, NULL, NULL, NULL, NULL, 0};
+static dictType intKeyPooledType = {intHashCallback, NULL, NULL, NULL, NULL, NULL, 1};
+
+static void benchPool(dictType *type, long count) {
+    dict *d = dictCreate(type, NULL);
+    long long start, insert_ns, delete_ns, reinsert_ns;
+    size_t rss = benchRss();
+    long j;
+
+    start = benchNanotime();
+    for (j = 0; j < count; j++) {
+        dictAdd(d, (void *)(j + 1), NULL);
+    }
+    insert_ns = benchNanotime() - start;
+
+    start = benchNanotime();
+    for (j = 0; j < count; j++) {
+        dictDelete(d, (void *)(j + 1));
+    }
+    delete_ns = benchNanotime() - start;
+
+    start = benchNanotime();
+    for (j = 0; j < count; j++) {
+        dictAdd(d, (void *)(j + 1 + count), NULL);
+    }
+    reinsert_ns = benchNanotime() - start;
+
+    // 链式节点每次插入分配一次，slab池每个slab分配一次
+    printf("%-7s count=%-10ld insert=%6.2f  delete=%6.2f  reinsert=%6.2f Mops/s  "
+           "entry mallocs=%-10ld rss=+%zu MB\n",
+           type->pooledEntries ? "pooled" : "malloc", count,
+           BENCH_MOPS(count, insert_ns), BENCH_MOPS(count, delete_ns), BENCH_MOPS(count, reinsert_ns),
+           d->entryPool ? (long)d->entryPool->slabcount : 2 * count,
+           (benchRss() - rss) >> 20);
+
+    dictRelease(d);
+}
+
+/**
+ * 对比逐个malloc节点与slab池分配节点：插入count个键、全部删除、再插入count个新键
+ * 参数：键数量（缺省1000000）
+ */
+void poolBench(int argc, char **argv) {
+    long count = argc > 0 ? atol(argv[0]) : 1000000;
+
+    dictType *types[] = {&intKeyType, &intKeyPooledType};
+    int i;
+
+    // 每种方式在单独的子进程中运行，RSS互不影响
+    for (i = 0; i < 2; i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            benchPool(types[i], count);
+            fflush(stdout);
+            _exit(0);
+        }
+        waitpid(pid, NULL, 0);
+    }
+}
+
+
+/* --------------------------- entry layouts -------------------------------- */
+
+static size_t embedSizeCallback(const void *key) {
+    return sdsembedsize(sdslen((sds)key));
+}
+
+static void *embedCallback(void *buf, const void *key) {
+    return sdsembed(buf, key, sdslen((sds)key));
+}
+
+static dictType layoutTypes[] = {
+    {hashCallback, NULL, NULL, compareCallback, freeCallback, NULL, 0, 0, NULL, NULL},
+    {hashCallback, NULL, NULL, compareCallback, freeCallback, NULL, 0, 1, NULL, NULL},
+    {hashCallback, NULL, NULL, compareCallback, NULL, NULL, 0, 0, embedSizeCallback, embedCallback},
+    {hashCallback, NULL, NULL, compareCallback, NULL, NULL, 0, 1, embedSizeCallback, embedCallback},
+};
+
+static const char *layoutNames[] = {"dictEntry", "noValue", "embedded", "noValue+embedded"};
+
+// 固定长度为30字节的键
+static sds benchLayoutKey(long j) {
+    char buf[32];
+    int len = snprintf(buf, sizeof(buf), "key:%026ld", j);
+    return sdsnewlen(buf, len);
+}
+
+/**
+ * 对比不同节点布局的每键内存（包括键本身）和命中查找吞吐量，键长30字节
+ * 参数：键数量（缺省1000000）
+ */
+void layoutBench(int argc, char **argv) {
+    long count = argc > 0 ? atol(argv[0]) : 1000000;
+    long lookups = count < 1000000 ? count : 1000000;
+    sds *probes = malloc(sizeof(sds) * lookups);
+    long j, found;
+    int t;
+
+    for (j = 0; j < lookups; j++) {
+        probes[j] = benchLayoutKey(random() % count);
+    }
+
+    for (t = 0; t < 4; t++) {
+        dictType *type = &layoutTypes[t];
+        size_t heap = benchHeapUsed();
+        dict *d = dictCreate(type, NULL);
+        long long start, ns;
+
+        for (j = 0; j < count; j++) {
+            sds key = benchLayoutKey(j);
+            dictAdd(d, key, NULL);
+            // 内嵌键的字典复制了键
+            if (type->keyEmbed) sdsfree(key);
+        }
+        while (dictRehash(d, 100));
+        heap = benchHeapUsed() - heap;
+
+        start = benchNanotime();
+        for (found = 0, j = 0; j < lookups; j++) {
+            found += dictFind(d, probes[j]) != NULL;
+        }
+        ns = benchNanotime() - start;
+
+        printf("%-17s keys=%-10ld bytes/key=%5.1f  hit=%6.2f Mops/s  (found %ld)\n",
+               layoutNames[t], count, (double)heap / count, BENCH_MOPS(lookups, ns), found);
+        dictRelease(d);
+    }
+
+    benchFreeKeys(probes, lookups);
+}
+
+
+/* ------------------------------ intdict ----------------------------------- */
+
+/**
+ * 对比整数键字典intdict与使用sds键的dict（test/dicttest.c中的回调）
+ * 以及把整数当作键指针的dict
+ * 参数：键数量（缺省1000000）
+ */
+void intdictBench(int argc, char **argv) {
+    long count = argc > 0 ? atol(argv[0]) : 1000000;
+    long lookups = count < 1000000 ? count : 1000000;
+    uint64_t *ids = malloc(sizeof(uint64_t) * lookups);
+    long long start, insert_ns, hit_ns;
+    long j, found;
+
+    for (j = 0; j < lookups; j++) {
+        ids[j] = random() % count;
+    }
+
+    /* dict + sds键 */
+    {
+        sds *keys = benchCreateKeys(count, 0, 0);
+        sds *probes = malloc(sizeof(sds) * lookups);
+        dict *d = dictCreate(&sdsKeyType, NULL);
+
+        for (j = 0; j < lookups; j++) {
+            probes[j] = sdsfromlonglong(ids[j]);
+        }
+        start = benchNanotime();
+        for (j = 0; j < count; j++) {
+            dictAdd(d, keys[j], NULL);
+        }
+        insert_ns = benchNanotime() - start;
+        while (dictRehash(d, 100));
+
+        start = benchNanotime();
+        for (found = 0, j = 0; j < lookups; j++) {
+            found += dictFind(d, probes[j]) != NULL;
+        }
+        hit_ns = benchNanotime() - start;
+        printf("dict(sds)      keys=%-10ld insert=%6.2f Mops/s  hit=%6.2f Mops/s  (found %ld)\n",
+               count, BENCH_MOPS(count, insert_ns), BENCH_MOPS(lookups, hit_ns), found);
+
+        free(keys);
+        dictRelease(d);
+        benchFreeKeys(probes, lookups);
+    }
+
+    /* dict + 整数当作键指针 */
+    {
+        dict *d = dictCreate(&intKeyType, NULL);
+
+        start = benchNanotime();
+        for (j = 0; j < count; j++) {
+            dictAdd(d, (void *)j, NULL);
+        }
+        insert_ns = benchNanotime() - start;
+        while (dictRehash(d, 100));
+
+        start = benchNanotime();
+        for (found = 0, j = 0; j < lookups; j++) {
+            found += dictFind(d, (void *)ids[j]) != NULL;
+        }
+        hit_ns = benchNanotime() - start;
+        printf("dict(pointer)  keys=%-10ld insert=%6.2f Mops/s  hit=%6.2f Mops/s  (found %ld)\n",
+               count, BENCH_MOPS(count, insert_ns), BENCH_MOPS(lookups, hit_ns), found);
+
+        dictRelease(d);
+    }
+
+    /* intdict */
+    {
+        intdict *d = intdictCreate(NULL);
+
+        start = benchNanotime();
+        for (j = 0; j < count; j++) {
+            intdictAdd(d, j, NULL);
+        }
+        insert_ns = benchNanotime() - start;
+        while (intdictRehash(d, 100));
+
+        start = benchNanotime();
+        for (found = 0, j = 0; j < lookups; j++) {
+            found += intdictFind(d, ids[j]) != NULL;
+        }
+        hit_ns = benchNanotime() - start;
+        printf("intdict        keys=%-10ld insert=%6.2f Mops/s  hit=%6.2f Mops/s  (found %ld)\n",
+               count, BENCH_MOPS(count, insert_ns), BENCH_MOPS(lookups, hit_ns), found);
+
+        intdictRelease(d);
+    }
+
+    free(ids);
+}
+
+
+/* ------------------------- batched hashing -------------------------------- */
+
+static void batchHashCallback(const void **keys, size_t n, uint64_t *hashes) {
+    size_t lens[DICT_FIND_BATCH], i;
+
+    for (i = 0; i < n; i++) {
+        lens[i] = sdslen((sds)keys[i]);
+    }
+    dictGenHashFunctionBatch(keys, lens, n, hashes);
+}
+
+static dictType sdsKeyBatchType = {
+    hashCallback, NULL, NULL, compareCallback, freeCallback, NULL,
+    0, 0, NULL, NULL, batchHashCallback
+};
+
+// 生成固定长度的键，数字部分左侧补零
+static sds *benchCreatePaddedKeys(long count, int keylen, int shuffle) {
+    sds *keys = benchCreateKeys(count, 0, shuffle);
+    long j;
+
+    for (j = 0; j < count; j++) {
+        sds padded = sdsempty();
+        long pad = keylen - (long)sdslen(keys[j]);
+
+        while (pad-- > 0) {
+            padded = sdscatlen(padded, "0", 1);
+        }
+        padded = sdscatsds(padded, keys[j]);
+        sdsfree(keys[j]);
+        keys[j] = padded;
+    }
+    return keys;
+}
+
+static void benchBatchHash(const char *name, dictType *type, long count, int keylen) {
+    sds *keys = benchCreatePaddedKeys(count, keylen, 0);
+    sds *probes = benchCreatePaddedKeys(count, keylen, 1);
+    dictEntry **out = malloc(sizeof(dictEntry *) * DICT_FIND_BATCH * 4);
+    long long start, add_ns, find_ns;
+    long j, found = 0;
+    dict *d = dictCreate(type, NULL);
+
+    dictExpand(d, count);
+    start = benchNanotime();
+    for (j = 0; j < count; j += DICT_FIND_BATCH * 4) {
+        long len = (count - j < DICT_FIND_BATCH * 4) ? count - j : DICT_FIND_BATCH * 4;
+        dictAddMany(d, (void **)keys + j, NULL, len, NULL);
+    }
+    add_ns = benchNanotime() - start;
+
+    start = benchNanotime();
+    for (j = 0; j < count; j += DICT_FIND_BATCH * 4) {
+        long len = (count - j < DICT_FIND_BATCH * 4) ? count - j : DICT_FIND_BATCH * 4;
+        found += dictFindMany(d, (const void **)probes + j, len, out);
+    }
+    find_ns = benchNanotime() - start;
+
+    printf("%-14s keylen=%-4d dictAddMany=%6.2f Mkeys/s  dictFindMany=%6.2f Mkeys/s  (found %ld)\n",
+           name, keylen, BENCH_MOPS(count, add_ns), BENCH_MOPS(count, find_ns), found);
+
+    free(keys);
+    dictRelease(d);
+    benchFreeKeys(probes, count);
+    free(out);
+}
+
+/**
+ * dictAddMany/dictFindMany使用逐个哈希和多路SipHash的对比
+ * 用法：benchapp batchhash [keys] [keylen...]
+ */
+void batchHashBench(int argc, char **argv) {
+    long count = argc > 0 ? atol(argv[0]) : 1000000;
+    int lengths[16] = {8, 32, 64}, nlengths = 3, i;
+
+    if (argc > 1) {
+        for (nlengths = 0, i = 1; i < argc && nlengths < 16; i++) {
+            lengths[nlengths++] = atoi(argv[i]);
+        }
+    }
+
+    for (i = 0; i < nlengths; i++) {
+        benchBatchHash("hashFunction", &sdsKeyType, count, lengths[i]);
+        benchBatchHash("hashBatch", &sdsKeyBatchType, count, lengths[i]);
+    }
+}
+
+
+/* --------------------------- random sampling ------------------------------ */
+
+/**
+ * 随机采样的速度
+ * 用法：benchapp random [keys] [samples]
+ */
+void randomBench(int argc, char **argv) {
+    long count = argc > 0 ? atol(argv[0]) : 10000000;
+    long samples = argc > 1 ? atol(argv[1]) : 2000000;
+    unsigned int batches[] = {5, 16, 64}, b;
+    dictEntry *des[64];
+    dict *d = dictCreate(&intKeyPooledType, NULL);
+    long long start, ns;
+    long j, sum = 0;
+
+    for (j = 1; j <= count; j++) {
+        dictAdd(d, (void *)j, NULL);
+    }
+    while (dictRehash(d, 100));
+    printf("keys=%ld buckets=%lu\n", count, d->ht[0].size);
+
+    start = benchNanotime();
+    for (j = 0; j < samples; j++) {
+        sum += (long)dictGetKey(dictGetRandomKey(d));
+    }
+    ns = benchNanotime() - start;
+    printf("dictGetRandomKey          %8.2f Msamples/s\n", BENCH_MOPS(samples, ns));
+
+    start = benchNanotime();
+    for (j = 0; j < samples; j++) {
+        sum += (long)dictGetKey(dictGetFairRandomKey(d));
+    }
+    ns = benchNanotime() - start;
+    printf("dictGetFairRandomKey      %8.2f Msamples/s\n", BENCH_MOPS(samples, ns));
+
+    for (b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+        long got = 0;
+
+        start = benchNanotime();
+        while (got < samples) {
+            unsigned int n = dictGetSomeKeys(d, des, batches[b]);
+            sum += (long)dictGetKey(des[0]);
+            got += n;
+        }
+        ns = benchNanotime() - start;
+        printf("dictGetSomeKeys count=%-3u %8.2f Msamples/s\n", batches[b], BENCH_MOPS(got, ns));
+    }
+
+    if (sum == 42) printf("\n");
+    dictRelease(d);
+}
+
+
+/* --------------------------- rehash scheduler ----------------------------- */
+
+/**
+ * 大量字典同时rehash时，按时间预算分摊rehash
+ * 用法：benchapp rehashsched [dicts] [keys per dict] [budget us]
+ */
+void rehashSchedBench(int argc, char **argv) {
+    long ndicts = argc > 0 ? atol(argv[0]) : 2000;
+    long keys = argc > 1 ? atol(argv[1]) : 2000;
+    long long budget = argc > 2 ? atoll(argv[2]) : 1000;
+    dictRehashScheduler *s = dictRehashSchedulerCreate(budget);
+    dict **dicts = malloc(ndicts * sizeof(dict *));
+    dictRehashStats stats;
+    long i, j;
+
+    for (i = 0; i < ndicts; i++) {
+        dicts[i] = dictCreate(&intKeyPooledType, NULL);
+        dictSetRehashScheduler(dicts[i], s);
+        // 字典大小不同，验证大字典优先
+        for (j = 1; j <= keys + i % keys; j++) {
+            dictAdd(dicts[i], (void *)j, NULL);
+        }
+        while (dictRehash(dicts[i], 100));
+        dictExpand(dicts[i], dictSize(dicts[i]) * 4);
+    }
+
+    dictRehashSchedulerGetStats(s, &stats);
+    printf("dicts=%lu buckets=%llu entries=%llu budget=%lldus\n",
+        stats.pendingDicts, stats.pendingBuckets, stats.pendingEntries, budget);
+
+    while (stats.pendingDicts) {
+        unsigned long buckets = dictRehashSchedulerTick(s);
+        dictRehashSchedulerGetStats(s, &stats);
+        if (stats.ticks <= 3 || stats.pendingDicts == 0) {
+            printf("tick %3llu: %8lu buckets in %6.1f us, %lu dicts left\n",
+                stats.ticks, buckets, stats.lastTickNs / 1e3, stats.pendingDicts);
+        }
+    }
+    printf("ticks=%llu steps=%llu total=%.2f ms max step=%.1f us\n",
+        stats.ticks, stats.steps, stats.totalNs / 1e6, stats.maxStepNs / 1e3);
+
+    for (i = 0; i < ndicts; i++) {
+        dictRelease(dicts[i]);
+    }
+    free(dicts);
+    dictRehashSchedulerRelease(s);
+}
+
+
+/* ------------------------------ bulk load --------------------------------- */
+
+/**
+ * 批量装载与逐个dictAdd的耗时对比
+ * 用法：benchapp bulk [keys]
+ */
+void bulkBench(int argc, char **argv) {
+    long count = argc > 0 ? atol(argv[0]) : 50000000;
+    const char *names[] = {"dictAdd", "dictExpand+dictAdd", "dictBulkLoad",
+                           "dictBulkLoad UNIQUE", "dictBulkLoad UNIQUE|PARTITION"};
+    int flags[] = {0, 0, 0, DICT_BULK_UNIQUE, DICT_BULK_UNIQUE | DICT_BULK_PARTITION};
+    void **keys = malloc(count * sizeof(void *));
+    long j;
+    int m;
+
+    // 打乱键的顺序，模拟快照中无序的键
+    for (j = 0; j < count; j++) {
+        keys[j] = (void *)(j + 1);
+    }
+    for (j = count - 1; j > 0; j--) {
+        long r = random() % (j + 1);
+        void *tmp = keys[j];
+        keys[j] = keys[r];
+        keys[r] = tmp;
+    }
+
+    for (m = 0; m < 5; m++) {
+        dict *d = dictCreate(&intKeyPooledType, NULL);
+        long long start = benchNanotime(), ns;
+
+        if (m < 2) {
+            if (m == 1) {
+                dictExpand(d, count);
+            }
+            for (j = 0; j < count; j++) {
+                dictAdd(d, keys[j], NULL);
+            }
+        } else {
+            dictBulkLoad(d, keys, NULL, count, flags[m]);
+        }
+        ns = benchNanotime() - start;
+        printf("%-30s %ld keys in %7.2f s, %6.2f Mkeys/s\n",
+            names[m], dictSize(d), ns / 1e9, BENCH_MOPS(count, ns));
+        dictRelease(d);
+    }
+    free(keys);
+}
+
+
+/* ------------------------- huge page bucket arrays ------------------------ */
+
+// 当前进程使用的透明大页，单位字节
+static size_t anonHugePages(void) {
+    FILE *fp = fopen("/proc/self/smaps_rollup", "r");
+    char line[256];
+    size_t kb = 0;
+
+    if (fp) {
+        while (fgets(line, sizeof(line), fp)) {
+            if (sscanf(line, "AnonHugePages: %zu kB", &kb) == 1) break;
+        }
+        fclose(fp);
+    }
+    return kb * 1024;
+}
+
+/**
+ * 桶数组使用和不使用透明大页时随机查找的延迟和dTLB缺失
+ * 用法：benchapp hugepage [keys] [lookups]
+ */
+void hugePageBench(int argc, char **argv) {
+    long count = argc > 0 ? atol(argv[0]) : 20000000;
+    long lookups = argc > 1 ? atol(argv[1]) : 10000000;
+    void **keys = malloc(count * sizeof(void *));
+    int fd = benchPerfOpenDtlbMiss();
+    int hugepages;
+    long j;
+
+    for (j = 0; j < count; j++) {
+        keys[j] = (void *)(j + 1);
+    }
+    if (fd < 0) {
+        printf("dTLB miss counter not available\n");
+    }
+
+    for (hugepages = 0; hugepages <= 1; hugepages++) {
+        dict *d = dictCreate(&intKeyPooledType, NULL);
+        long long start, ns, misses;
+        long found = 0;
+
+        dictSetTableHugePages(hugepages);
+        dictBulkLoad(d, keys, NULL, count, DICT_BULK_UNIQUE);
+
+        srandom(1);
+        benchPerfStart(fd);
+        start = benchNanotime();
+        for (j = 0; j < lookups; j++) {
+            found += dictFind(d, keys[random() % count]) != NULL;
+        }
+        ns = benchNanotime() - start;
+        misses = benchPerfStop(fd);
+
+        printf("hugepages=%d buckets=%lu (%lu MB) AnonHugePages=%zu MB\n",
+            hugepages, d->ht[0].size, d->ht[0].size * sizeof(dictEntry *) >> 20,
+            anonHugePages() >> 20);
+        printf("  %ld lookups: %.1f ns/lookup", found, (double)ns / lookups);
+        if (misses >= 0) {
+            printf(", %.3f dTLB misses/lookup", (double)misses / lookups);
+        }
+        printf("\n");
+
+        // 只读取桶数组，不访问节点，单独观察桶数组上的TLB缺失
+        found = 0;
+        srandom(1);
+        benchPerfStart(fd);
+        start = benchNanotime();
+        for (j = 0; j < lookups; j++) {
+            uint64_t h = dictHashKey(d, keys[random() % count]);
+            found += d->ht[0].table[h & d->ht[0].sizemask] != NULL;
+        }
+        ns = benchNanotime() - start;
+        misses = benchPerfStop(fd);
+        printf("  %ld bucket probes: %.1f ns/probe", found, (double)ns / lookups);
+        if (misses >= 0) {
+            printf(", %.3f dTLB misses/probe", (double)misses / lookups);
+        }
+        printf("\n");
+        dictRelease(d);
+    }
+    dictSetTableHugePages(1);
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(keys);
+}
+
+
+// 创建count个sds键的字典，并完成rehash
+static dict *lazyfreeBenchDict(long count) {
+    dict *d = dictCreate(&sdsKeyType, NULL);
+    long j;
+
+    for (j = 0; j < count; j++) {
+        dictAdd(d, sdsfromlonglong(j), NULL);
+    }
+    while (dictIsRehashing(d)) {
+        dictRehash(d, 1000);
+    }
+    return d;
+}
+
+/**
+ * 释放大字典时调用者一侧的停顿：同步dictRelease，dictEmptyStep的单步最大停顿，
+ * 以及交给后台线程的lazyfreeDict
+ * 用法：benchapp lazyfree [keys] [budget]
+ */
+void lazyfreeBench(int argc, char **argv) {
+    long count = argc > 0 ? atol(argv[0]) : 5000000;
+    unsigned long budget = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000;
+    long long start, ns, maxStep = 0, steps = 0;
+    dict *d;
+
+    d = lazyfreeBenchDict(count);
+    start = benchNanotime();
+    dictRelease(d);
+    ns = benchNanotime() - start;
+    printf("dictRelease    %ld keys: stall %.3f ms\n", count, ns / 1e6);
+
+    d = lazyfreeBenchDict(count);
+    start = benchNanotime();
+    while (1) {
+        long long stepStart = benchNanotime();
+        int more = dictEmptyStep(d, budget);
+
+        ns = benchNanotime() - stepStart;
+        if (ns > maxStep) maxStep = ns;
+        steps++;
+        if (!more) break;
+    }
+    ns = benchNanotime() - start;
+    dictRelease(d);
+    printf("dictEmptyStep  %ld keys: budget %lu, %lld steps, max stall %.3f ms, total %.3f ms\n",
+           count, budget, steps, maxStep / 1e6, ns / 1e6);
+
+    d = lazyfreeBenchDict(count);
+    start = benchNanotime();
+    lazyfreeDict(d);
+    ns = benchNanotime() - start;
+    printf("lazyfreeDict   %ld keys: stall %.3f ms", count, ns / 1e6);
+    start = benchNanotime();
+    lazyfreeWait();
+    printf(", background %.3f ms\n", (benchNanotime() - start) / 1e6);
+}
@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "dict.h"
+#include "hash.h"
+#include "benchmarks.h"
+
+
+static struct hashFunction {
+    const char *name;
+    uint64_t (*proc)(const void *key, int len);
+} hashFunctions[] = {
+    {"siphash-2-4", dictGenSipHash24Function},
+    {"siphash-1-2", dictGenHashFunction},
+    {"siphash-1-2-nocase", dictGenCaseHashFunction},
+    {"xxh3-64", dictGenFastHashFunction},
+};
+
+#define HASH_FUNCTION_COUNT (sizeof(hashFunctions) / sizeof(hashFunctions[0]))
+
+
+/**
+ * 各哈希函数在不同键长下的开销
+ * 用法：benchapp hash [iterations]
+ * 每次调用的输入起点都不同，并把上一次的结果混入下一次的偏移，避免被编译器合并，
+ * 得到的是接近字典查找场景的单次调用延迟。
+ */
+void hashBench(int argc, char **argv) {
+    static const int lengths[] = {8, 16, 24, 32, 64, 128, 256};
+    long iterations = argc > 0 ? atol(argv[0]) : 2000000;
+    unsigned char buf[256 + 64];
+    unsigned long i, j, k;
+
+    for (i = 0; i < sizeof(buf); i++) {
+        buf[i] = (unsigned char)(i * 131 + 7);
+    }
+
+    printf("%-20s %6s %12s %12s\n", "function", "keylen", "ns/hash", "cycles/byte");
+    for (i = 0; i < HASH_FUNCTION_COUNT; i++) {
+        for (j = 0; j < sizeof(lengths) / sizeof(lengths[0]); j++) {
+            int len = lengths[j];
+            uint64_t h = 0;
+            unsigned long long c0, c1;
+            long long t0, t1;
+
+            for (k = 0; k < 1000; k++) {
+                h += hashFunctions[i].proc(buf + (k & 63), len);
+            }
+
+            t0 = benchNanotime();
+            c0 = benchCycles();
+            for (k = 0; k < (unsigned long)iterations; k++) {
+                h += hashFunctions[i].proc(buf + ((k + h) & 63), len);
+            }
+            c1 = benchCycles();
+            t1 = benchNanotime();
+
+            printf("%-20s %6d %12.2f %12.3f\n", hashFunctions[i].name, len,
+                   (double)(t1 - t0) / iterations,
+                   (double)(c1 - c0) / ((double)iterations * len));
+            if (h == 42) printf("\n");
+        }
+    }
+}
+
+
+/**
+ * 多路SipHash与逐个调用siphash的吞吐量
+ * 用法：benchapp siphashx [keys]
+ * 键互相独立，标量版本也能利用乱序执行重叠相邻的调用，比较的是每秒处理的键数。
+ */
+void siphashMultiBench(int argc, char **argv) {
+    static const int lengths[] = {8, 16, 32, 64, 128};
+    long count = argc > 0 ? atol(argv[0]) : 4000000;
+    const uint8_t *seed = dictGetHashFunctionSeed();
+    unsigned char buf[4096 + 128];
+    const uint8_t *in[8];
+    size_t lens[8];
+    uint64_t out[8], h = 0;
+    unsigned long i, j;
+    long k;
+
+    for (i = 0; i < sizeof(buf); i++) {
+        buf[i] = (unsigned char)(i * 131 + 7);
+    }
+
+    printf("multi-buffer implementation: %s\n", siphash_multi_impl());
+    printf("%6s %14s %14s %14s\n", "keylen", "scalar Mkeys/s", "x4 Mkeys/s", "x8 Mkeys/s");
+    for (j = 0; j < sizeof(lengths) / sizeof(lengths[0]); j++) {
+        int len = lengths[j];
+        long long t0, scalar_ns, x4_ns, x8_ns;
+
+        for (i = 0; i < 8; i++) {
+            lens[i] = len;
+        }
+
+        t0 = benchNanotime();
+        for (k = 0; k < count; k++) {
+            h += siphash(buf + (k & 4095), len, seed);
+        }
+        scalar_ns = benchNanotime() - t0;
+
+        t0 = benchNanotime();
+        for (k = 0; k < count; k += 4) {
+            for (i = 0; i < 4; i++) {
+                in[i] = buf + ((k + i) & 4095);
+            }
+            siphash_x4(in, lens, seed, out);
+            h += out[0] ^ out[1] ^ out[2] ^ out[3];
+        }
+        x4_ns = benchNanotime() - t0;
+
+        t0 = benchNanotime();
+        for (k = 0; k < count; k += 8) {
+            for (i = 0; i < 8; i++) {
+                in[i] = buf + ((k + i) & 4095);
+            }
+            siphash_x8(in, lens, seed, out);
+            h += out[0] ^ out[7];
+        }
+        x8_ns = benchNanotime() - t0;
+
+        printf("%6d %14.2f %14.2f %14.2f\n", len,
+               BENCH_MOPS(count, scalar_ns), BENCH_MOPS(count, x4_ns), BENCH_MOPS(count, x8_ns));
+    }
+    if (h == 42) printf("\n");
+}
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "benchmarks.h"
+
+
+static struct benchmark {
+    const char *name;
+    void (*proc)(int argc, char **argv);
+} benchmarks[] = {
+    {"oadict", oadictBench},
+    {"findmany", findManyBench},
+    {"pool", poolBench},
+    {"layout", layoutBench},
+    {"intdict", intdictBench},
+    {"template", templateBench},
+    {"hash", hashBench},
+    {"siphashx", siphashMultiBench},
+    {"batchhash", batchHashBench},
+    {"concurrent", concurrentBench},
+    {"rcu", rcuBench},
+    {"random", randomBench},
+    {"rehashsched", rehashSchedBench},
+    {"bulk", bulkBench},
+    {"hugepage", hugePageBench},
+    {"lazyfree", lazyfreeBench},
+    {"sdsmem", sdsMemoryBench},
+    {"sdskeys", sdsKeysBench},
+    {"sdsint", sdsIntegerBench},
+    {"sdsfmt", sdsCatFmtBench},
+    {"sdsops", sdsOpsBench},
+    {"sdsbuild", sdsBuildBench},
+};
+
+#define BENCHMARK_COUNT (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+
+int main(int argc, char *argv[]) {
+    unsigned long i;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <benchmark> [args...]\n", argv[0]);
+        for (i = 0; i < BENCHMARK_COUNT; i++) {
+            fprintf(stderr, "    %s\n", benchmarks[i].name);
+        }
+        return 1;
+    }
+
+    for (i = 0; i < BENCHMARK_COUNT; i++) {
+        if (strcmp(argv[1], benchmarks[i].name) == 0) {
+            benchmarks[i].proc(argc - 2, argv + 2);
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "unknown benchmark: %s\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "dict.h"
+#include "rcudict.h"
+#include "benchmarks.h"
+
+
+static uint64_t intHashCallback(const void *key) {
+    return dictGenHashFunction(&key, sizeof(key));
+}
+
+static dictType intKeyType = {intHashCallback, NULL, NULL, NULL, NULL, NULL};
+
+// 对照组：由一把互斥锁保护的dict
+typedef struct lockedDict {
+    pthread_mutex_t lock;
+    dict *d;
+} lockedDict;
+
+typedef struct rcuBenchState {
+    rcudict *rd;
+    lockedDict ld;
+    int useRcu;
+    long keyspace;
+    int stop;
+    long long lookups[64];
+} rcuBenchState;
+
+typedef struct rcuBenchArg {
+    rcuBenchState *state;
+    int id;
+} rcuBenchArg;
+
+
+static void *rcuBenchReader(void *privdata) {
+    rcuBenchArg *arg = privdata;
+    rcuBenchState *state = arg->state;
+    uint64_t r = 0x9E3779B97F4A7C15ULL * (arg->id + 1);
+    int reader = state->useRcu ? rcudictRegisterReader(state->rd) : 0;
+    long long lookups = 0;
+
+    while (!__atomic_load_n(&state->stop, __ATOMIC_RELAXED)) {
+        int i;
+
+        // 每次进入临界区查找16个键
+        if (state->useRcu) {
+            rcudictReadLock(state->rd, reader);
+        } else {
+            pthread_mutex_lock(&state->ld.lock);
+        }
+        for (i = 0; i < 16; i++) {
+            void *key;
+
+            r ^= r << 13; r ^= r >> 7; r ^= r << 17;
+            key = (void *)(long)(r % state->keyspace + 1);
+            if (state->useRcu) {
+                rcudictFind(state->rd, key);
+            } else {
+                dictFind(state->ld.d, key);
+            }
+        }
+        if (state->useRcu) {
+            rcudictReadUnlock(state->rd, reader);
+        } else {
+            pthread_mutex_unlock(&state->ld.lock);
+        }
+        lookups += 16;
+    }
+    state->lookups[arg->id] = lookups;
+    return NULL;
+}
+
+// 唯一的写者，在删除和添加之间切换
+static void *rcuBenchWriter(void *privdata) {
+    rcuBenchState *state = privdata;
+    uint64_t r = 0x2545F4914F6CDD1DULL;
+
+    while (!__atomic_load_n(&state->stop, __ATOMIC_RELAXED)) {
+        void *key;
+
+        r ^= r << 13; r ^= r >> 7; r ^= r << 17;
+        key = (void *)(long)(r % state->keyspace + 1);
+        if (state->useRcu) {
+            if (rcudictDelete(state->rd, key) == DICT_ERR) rcudictAdd(state->rd, key, key);
+        } else {
+            pthread_mutex_lock(&state->ld.lock);
+            if (dictDelete(state->ld.d, key) == DICT_ERR) dictAdd(state->ld.d, key, key);
+            pthread_mutex_unlock(&state->ld.lock);
+        }
+    }
+    return NULL;
+}
+
+static double rcuBenchRun(int useRcu, int readers, long keyspace, int ms) {
+    rcuBenchState state = {0};
+    rcuBenchArg args[64];
+    pthread_t tids[64], writer;
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    long long total = 0;
+    long j;
+    int i;
+
+    state.useRcu = useRcu;
+    state.keyspace = keyspace;
+    if (useRcu) {
+        state.rd = rcudictCreate(&intKeyType, NULL);
+    } else {
+        pthread_mutex_init(&state.ld.lock, NULL);
+        state.ld.d = dictCreate(&intKeyType, NULL);
+    }
+    for (j = 1; j <= keyspace; j += 2) {
+        if (useRcu) {
+            rcudictAdd(state.rd, (void *)j, (void *)j);
+        } else {
+            dictAdd(state.ld.d, (void *)j, (void *)j);
+        }
+    }
+
+    for (i = 0; i < readers; i++) {
+        args[i].state = &state;
+        args[i].id = i;
+        pthread_create(&tids[i], NULL, rcuBenchReader, &args[i]);
+    }
+    pthread_create(&writer, NULL, rcuBenchWriter, &state);
+    nanosleep(&ts, NULL);
+    __atomic_store_n(&state.stop, 1, __ATOMIC_RELAXED);
+    for (i = 0; i < readers; i++) {
+        pthread_join(tids[i], NULL);
+        total += state.lookups[i];
+    }
+    pthread_join(writer, NULL);
+
+    if (useRcu) {
+        rcudictRelease(state.rd);
+    } else {
+        dictRelease(state.ld.d);
+        pthread_mutex_destroy(&state.ld.lock);
+    }
+    return (double)total / ms / 1000.0;
+}
+
+/**
+ * rcudict无锁读与互斥锁保护的dict的读吞吐量，同时有一个写者持续修改
+ * 用法：benchapp rcu [keyspace] [ms]
+ */
+void rcuBench(int argc, char **argv) {
+    static const int readers[] = {1, 2, 4, 8, 16};
+    long keyspace = argc > 0 ? atol(argv[0]) : 1000000;
+    int ms = argc > 1 ? atoi(argv[1]) : 500;
+    unsigned long i;
+
+    printf("online cpus: %ld, keyspace: %ld, %d ms per run, 1 writer\n",
+           sysconf(_SC_NPROCESSORS_ONLN), keyspace, ms);
+    printf("%-8s %18s %18s\n", "readers", "mutex Mlookups/s", "rcu Mlookups/s");
+    for (i = 0; i < sizeof(readers) / sizeof(readers[0]); i++) {
+        double locked = rcuBenchRun(0, readers[i], keyspace, ms);
+        double rcu = rcuBenchRun(1, readers[i], keyspace, ms);
+
+        printf("%-8d %18.2f %18.2f\n", readers[i], locked, rcu);
+    }
+}
@@ -0,0 +1,440 @@
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+
+#include "sds.h"
+#include "sdsbuilder.h"
+#include "benchmarks.h"
+
+
+#define SDS_GROW_GREEDY 0
+#define SDS_GROW_TRIM 1
+#define SDS_GROW_NONGREEDY 2
+
+static const char *sdsGrowModes[] = {"greedy", "greedy+trim", "nongreedy"};
+
+
+// 非贪婪地拼接字符串
+static sds sdscatlenNonGreedy(sds s, const void *t, size_t len) {
+    size_t curlen = sdslen(s);
+
+    s = sdsMakeRoomForNonGreedy(s, len);
+    memcpy(s + curlen, t, len);
+    sdssetlen(s, curlen + len);
+    s[curlen + len] = '\0';
+    return s;
+}
+
+/**
+ * 用多次sdscatlen构造大量字符串后占用的堆内存：
+ * 贪婪扩充、贪婪扩充后sdsRemoveFreeSpace、非贪婪扩充
+ * 每个字符串拼接appends次，每次1~16字节
+ * 用法：benchapp sdsmem [values] [appends]
+ */
+void sdsMemoryBench(int argc, char **argv) {
+    long count = argc > 0 ? atol(argv[0]) : 10000000;
+    int appends = argc > 1 ? atoi(argv[1]) : 8;
+    sds *values = malloc(count * sizeof(sds));
+    const char *piece = "0123456789abcdef";
+    int mode;
+
+    printf("%ld values, %d appends of 1-16 bytes each\n", count, appends);
+    printf("%-12s %12s %12s %14s %10s\n", "mode", "payload MB", "heap MB", "bytes/value", "ms");
+    for (mode = SDS_GROW_GREEDY; mode <= SDS_GROW_NONGREEDY; mode++) {
+        size_t base = benchHeapUsed(), payload = 0, used;
+        unsigned long r = 1;
+        long long start = benchNanotime(), ns;
+        long j;
+        int k;
+
+        for (j = 0; j < count; j++) {
+            sds s = sdsempty();
+
+            for (k = 0; k < appends; k++) {
+                size_t len;
+
+                r = r * 6364136223846793005UL + 1442695040888963407UL;
+                len = (r >> 60) + 1;
+                if (mode == SDS_GROW_NONGREEDY) {
+                    s = sdscatlenNonGreedy(s, piece, len);
+                } else {
+                    s = sdscatlen(s, piece, len);
+                }
+            }
+            if (mode == SDS_GROW_TRIM) {
+                s = sdsRemoveFreeSpace(s);
+            }
+            payload += sdslen(s);
+            values[j] = s;
+        }
+        ns = benchNanotime() - start;
+        used = benchHeapUsed() - base;
+
+        printf("%-12s %12.1f %12.1f %14.1f %10lld\n", sdsGrowModes[mode],
+               payload / 1048576.0, used / 1048576.0, (double)used / count, ns / 1000000);
+        for (j = 0; j < count; j++) {
+            sdsfree(values[j]);
+        }
+        malloc_trim(0);
+    }
+    free(values);
+}
+
+/**
+ * 大量短键占用的堆内存：SDS_TYPE_5与SDS_TYPE_8头部对比
+ * 键形如"user:<id>"，长度在8到31字节之间
+ * SDS_TYPE_8的键用空字符串加非贪婪扩充构造，与引入SDS_TYPE_5之前sdsnewlen的布局相同
+ * 用法：benchapp sdskeys [keys]
+ */
+void sdsKeysBench(int argc, char **argv) {
+    long count = argc > 0 ? atol(argv[0]) : 10000000;
+    sds *keys = malloc(count * sizeof(sds));
+    int type5;
+
+    printf("%ld keys\n", count);
+    printf("%-8s %12s %12s %14s %10s\n", "header", "payload MB", "heap MB", "bytes/key", "ms");
+    for (type5 = 1; type5 >= 0; type5--) {
+        size_t base = benchHeapUsed(), payload = 0, used;
+        long long start = benchNanotime(), ns;
+        char buf[64];
+        long j;
+
+        for (j = 0; j < count; j++) {
+            int len = snprintf(buf, sizeof(buf), "user:%ld", j * 2654435761UL % 1000000000000000UL);
+
+            // 后缀补到8~31字节
+            len += snprintf(buf + len, sizeof(buf) - len, "%.*s", (int)(j % 11), ":session:xx");
+            if (type5) {
+                keys[j] = sdsnewlen(buf, len);
+            } else {
+                keys[j] = sdscatlen(sdsMakeRoomForNonGreedy(sdsempty(), len), buf, len);
+            }
+            payload += len;
+        }
+        ns = benchNanotime() - start;
+        used = benchHeapUsed() - base;
+
+        printf("%-8s %12.1f %12.1f %14.1f %10lld\n", type5 ? "type5" : "type8",
+               payload / 1048576.0, used / 1048576.0, (double)used / count, ns / 1000000);
+        for (j = 0; j < count; j++) {
+            sdsfree(keys[j]);
+        }
+        malloc_trim(0);
+    }
+    free(keys);
+}
+
+
+// 对照组：逐位取模后反转的旧版sdsll2str
+static int ll2strReverse(char *s, long long value) {
+    char *p, aux;
+    unsigned long long v;
+    size_t l;
+
+    v = (value < 0) ? -value : value;
+    p = s;
+    do {
+        *p++ = '0'+(v%10);
+        v /= 10;
+    } while(v);
+    if (value < 0) *p++ = '-';
+
+    l = p-s;
+    *p = '\0';
+
+    p--;
+    while(s < p) {
+        aux = *s;
+        *s = *p;
+        *p = aux;
+        s++;
+        p--;
+    }
+    return l;
+}
+
+/**
+ * 整数与字符串互相转换的速度
+ * 数值的位数在1到19之间均匀分布，一半是负数
+ * 用法：benchapp sdsint [count]
+ */
+void sdsIntegerBench(int argc, char **argv) {
+    long count = argc > 0 ? atol(argv[0]) : 10000000;
+    long long *values = malloc(count * sizeof(long long));
+    char (*strs)[SDS_LLSTR_SIZE] = malloc(count * SDS_LLSTR_SIZE);
+    int *lens = malloc(count * sizeof(int));
+    unsigned long long r = 1;
+    long long start, ns, sum;
+    long j;
+
+    for (j = 0; j < count; j++) {
+        long long mod = 10;
+        int digits;
+
+        r = r * 6364136223846793005ULL + 1442695040888963407ULL;
+        for (digits = (r >> 33) % 18; digits > 0; digits--) mod *= 10;
+        values[j] = (long long)((r >> 1) % mod);
+        if (r & 1) values[j] = -values[j];
+    }
+
+    printf("%ld integers\n", count);
+    printf("%-24s %12s\n", "conversion", "Mconv/s");
+
+    start = benchNanotime();
+    for (j = 0; j < count; j++) lens[j] = snprintf(strs[j], SDS_LLSTR_SIZE, "%lld", values[j]);
+    ns = benchNanotime() - start;
+    printf("%-24s %12.2f\n", "snprintf", BENCH_MOPS(count, ns));
+
+    start = benchNanotime();
+    for (j = 0; j < count; j++) lens[j] = ll2strReverse(strs[j], values[j]);
+    ns = benchNanotime() - start;
+    printf("%-24s %12.2f\n", "ll2str (reverse)", BENCH_MOPS(count, ns));
+
+    start = benchNanotime();
+    for (j = 0; j < count; j++) lens[j] = sdsll2str(strs[j], values[j]);
+    ns = benchNanotime() - start;
+    printf("%-24s %12.2f\n", "sdsll2str", BENCH_MOPS(count, ns));
+
+    sum = 0;
+    start = benchNanotime();
+    for (j = 0; j < count; j++) sum += strtoll(strs[j], NULL, 10);
+    ns = benchNanotime() - start;
+    printf("%-24s %12.2f\n", "strtoll", BENCH_MOPS(count, ns));
+
+    start = benchNanotime();
+    for (j = 0; j < count; j++) {
+        long long v;
+        string2ll(strs[j], lens[j], &v);
+        sum -= v;
+    }
+    ns = benchNanotime() - start;
+    printf("%-24s %12.2f\n", "string2ll", BENCH_MOPS(count, ns));
+    if (sum != 0) {
+        printf("string2ll and strtoll disagree\n");
+    }
+
+    free(values);
+    free(strs);
+    free(lens);
+}
+
+/**
+ * 构造协议头"*<argc>\r\n$<len>\r\n"的速度：sdscatprintf与sdscatfmt对比
+ * 每构造1000个协议头清空一次字符串，模拟复用的回复缓冲区
+ * 用法：benchapp sdsfmt [count]
+ */
+void sdsCatFmtBench(int argc, char **argv) {
+    long count = argc > 0 ? atol(argv[0]) : 10000000;
+    int fast;
+
+    printf("%ld protocol headers\n", count);
+    printf("%-14s %12s %10s\n", "formatter", "Mcalls/s", "ns/call");
+    for (fast = 0; fast <= 1; fast++) {
+        sds s = sdsempty();
+        long long start = benchNanotime(), ns;
+        long j;
+
+        for (j = 0; j < count; j++) {
+            if (fast) {
+                s = sdscatfmt(s, "*%i\r\n$%i\r\n", (int)(j & 7), (int)(j & 0xffff));
+            } else {
+                s = sdscatprintf(s, "*%d\r\n$%d\r\n", (int)(j & 7), (int)(j & 0xffff));
+            }
+            if (j % 1000 == 999) {
+                sdssetlen(s, 0);
+            }
+        }
+        ns = benchNanotime() - start;
+        printf("%-14s %12.2f %10.1f\n", fast ? "sdscatfmt" : "sdscatprintf",
+               BENCH_MOPS(count, ns), (double)ns / count);
+        sdsfree(s);
+    }
+}
+
+
+// 对照组：在每个位置比较分隔符的分割，返回的数组与sdssplitlen相同
+static sds *naiveSplit(const char *s, size_t len, const char *sep, size_t seplen, int *count) {
+    size_t j, start = 0;
+    int elements = 0, slots = 5;
+    sds *tokens = malloc(sizeof(sds) * slots);
+
+    for (j = 0; j + seplen <= len; j++) {
+        if (slots < elements + 2) {
+            slots *= 2;
+            tokens = realloc(tokens, sizeof(sds) * slots);
+        }
+        if (s[j] == sep[0] && memcmp(s + j, sep, seplen) == 0) {
+            tokens[elements++] = sdsnewlen(s + start, j - start);
+            start = j + seplen;
+            j = start - 1;
+        }
+    }
+    tokens[elements++] = sdsnewlen(s + start, len - start);
+    *count = elements;
+    return tokens;
+}
+
+// 对照组：用strchr判断字符是否属于集合的修剪
+static sds naiveTrim(sds s, const char *cset) {
+    char *sp = s, *ep = s + sdslen(s) - 1;
+    size_t len;
+
+    while (sp <= ep && strchr(cset, *sp)) sp++;
+    while (ep > sp && strchr(cset, *ep)) ep--;
+    len = (sp > ep) ? 0 : (ep - sp) + 1;
+    if (s != sp) memmove(s, sp, len);
+    s[len] = '\0';
+    sdssetlen(s, len);
+    return s;
+}
+
+// 对照组：逐字节调用tolower
+static void naiveToLower(sds s) {
+    size_t j, len = sdslen(s);
+
+    for (j = 0; j < len; j++) s[j] = tolower((unsigned char)s[j]);
+}
+
+#define SDSOPS_NAIVE 0
+#define SDSOPS_SCALAR 1
+#define SDSOPS_SIMD 2
+
+static double sdsOpsRun(int op, int impl, const char *input, size_t len, long rounds) {
+    sds s = sdsnewlen(input, len);
+    long long start, ns;
+    long j;
+    int count, sink = 0;
+
+    sdsSimdForceScalar(impl == SDSOPS_SCALAR);
+    start = benchNanotime();
+    for (j = 0; j < rounds; j++) {
+        if (op == 0) {
+            sds *tokens = (impl == SDSOPS_NAIVE) ? naiveSplit(input, len, ", ", 2, &count)
+                                                 : sdssplitlen(input, len, ", ", 2, &count);
+            sink += count;
+            sdsfreesplitres(tokens, count);
+        } else if (op == 1) {
+            s = sdscpylen(s, input, len);
+            s = (impl == SDSOPS_NAIVE) ? naiveTrim(s, " \t\r\n") : sdstrim(s, " \t\r\n");
+            sink += sdslen(s);
+        } else {
+            if (impl == SDSOPS_NAIVE) {
+                naiveToLower(s);
+            } else {
+                sdstolower(s);
+            }
+            sink += s[0];
+        }
+    }
+    ns = benchNanotime() - start;
+    sdsSimdForceScalar(0);
+    sdsfree(s);
+    if (sink == 42) printf(" ");
+    return (double)len * rounds / (ns ? ns : 1);
+}
+
+/**
+ * sdssplitlen、sdstrim、sdstolower与逐字节实现的吞吐量（GB/s）
+ * split：每256字节一个", "分隔符；
+ * trim：两端各1/4是空白，每轮先sdscpylen恢复输入；tolower：大小写混合的字母
+ * 用法：benchapp sdsops [bytes per size]
+ */
+void sdsOpsBench(int argc, char **argv) {
+    static const size_t sizes[] = {16, 256, 4096, 65536, 1048576};
+    static const char *ops[] = {"split", "trim", "tolower"};
+    long total = argc > 0 ? atol(argv[0]) : 256L * 1048576;
+    char *input = malloc(sizes[4]);
+    unsigned long i;
+    int op;
+
+    printf("simd implementation: %s\n", sdsSimdImpl());
+    printf("%-8s %8s %12s %12s %12s\n", "op", "bytes", "naive GB/s", "scalar GB/s", "simd GB/s");
+    for (op = 0; op < 3; op++) {
+        for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            size_t len = sizes[i], j;
+            long rounds = total / len;
+
+            for (j = 0; j < len; j++) {
+                if (op == 0) {
+                    input[j] = (j % 256 == 254) ? ',' : (j % 256 == 255) ? ' ' : 'a' + j % 26;
+                } else if (op == 1) {
+                    input[j] = (j < len / 4 || j >= len - len / 4) ? " \t\r\n"[j % 4] : 'a' + j % 26;
+                } else {
+                    input[j] = ((j * 7) & 1 ? 'A' : 'a') + j % 26;
+                }
+            }
+            printf("%-8s %8zu %12.2f %12.2f %12.2f\n", ops[op], len,
+                   sdsOpsRun(op, SDSOPS_NAIVE, input, len, rounds),
+                   sdsOpsRun(op, SDSOPS_SCALAR, input, len, rounds),
+                   sdsOpsRun(op, SDSOPS_SIMD, input, len, rounds));
+        }
+    }
+    free(input);
+}
+
+/**
+ * 用4KB的追加构造1GB的值：sdscatlen（zrealloc或mremap扩充）与sdsbuilder
+ * moves是扩充时缓冲区地址改变的次数，zrealloc时每次都意味着拷贝整个缓冲区
+ * 用法：benchapp sdsbuild [MB] [append bytes]
+ */
+void sdsBuildBench(int argc, char **argv) {
+    size_t total = (size_t)(argc > 0 ? atol(argv[0]) : 1024) * 1048576;
+    size_t piece = argc > 1 ? (size_t)atol(argv[1]) : 4096;
+    char *buf = malloc(piece);
+    int mode, fd = open("/dev/null", O_WRONLY);
+
+    memset(buf, 'x', piece);
+    printf("%zu MB by %zu byte appends\n", total >> 20, piece);
+    printf("%-22s %10s %10s\n", "method", "ms", "moves");
+    for (mode = 0; mode < 4; mode++) {
+        long long start = benchNanotime(), ns;
+        const char *name;
+        long moves = 0;
+        size_t done;
+
+        if (mode < 2) {
+            sds s = sdsempty();
+
+            sdsSetMmapGrowth(mode);
+            for (done = 0; done < total; done += piece) {
+                sds old = s;
+
+                s = sdscatlen(s, buf, piece);
+                moves += (s != old);
+            }
+            name = mode ? "sdscatlen mremap" : "sdscatlen zrealloc";
+            sdsfree(s);
+            sdsSetMmapGrowth(1);
+        } else {
+            sdsbuilder b;
+
+            sdsbuilderInit(&b, 0);
+            for (done = 0; done < total; done += piece) {
+                sdsbuilderAppend(&b, buf, piece);
+            }
+            if (mode == 2) {
+                sdsfree(sdsbuilderFlatten(&b));
+                name = "sdsbuilder flatten";
+            } else {
+                struct iovec iov[64];
+
+                // 写到/dev/null，相当于交给writev的开销
+                while (sdsbuilderLen(&b)) {
+                    int cnt = sdsbuilderIovec(&b, iov, 64);
+                    ssize_t n = writev(fd, iov, cnt);
+
+                    if (n <= 0) break;
+                    sdsbuilderConsume(&b, n);
+                }
+                sdsbuilderReset(&b);
+                name = "sdsbuilder writev";
+            }
+        }
+        ns = benchNanotime() - start;
+        printf("%-22s %10lld %10ld\n", name, ns / 1000000, moves);
+    }
+    close(fd);
+    free(buf);
+}
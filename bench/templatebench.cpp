@@ -0,0 +1,114 @@
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "dict.hpp"
+
+extern "C" {
+#include "benchmarks.h"
+}
+
+
+/* 与test/dicttest.c相同的sds键回调 */
+static uint64_t hashCallback(const void *key) {
+    return dictGenHashFunction((unsigned char*)key, sdslen((char*)key));
+}
+
+static int compareCallback(void *privdata, const void *key1, const void *key2) {
+    int l1,l2;
+    DICT_NOTUSED(privdata);
+
+    l1 = sdslen((sds)key1);
+    l2 = sdslen((sds)key2);
+    if (l1 != l2) return 0;
+    return memcmp(key1, key2, l1) == 0;
+}
+
+static void freeCallback(void *privdata, void *val) {
+    DICT_NOTUSED(privdata);
+
+    sdsfree((sds)val);
+}
+
+static dictType sdsKeyType = {
+    hashCallback,
+    NULL,
+    NULL,
+    compareCallback,
+    freeCallback,
+    NULL
+};
+
+
+static void benchCDict(sds *probes, long count, long lookups) {
+    dict *d = dictCreate(&sdsKeyType, NULL);
+    long long start, insert_ns, hit_ns;
+    long j, found;
+
+    start = benchNanotime();
+    for (j = 0; j < count; j++) {
+        dictAdd(d, sdsfromlonglong(j), NULL);
+    }
+    insert_ns = benchNanotime() - start;
+    while (dictRehash(d, 100));
+
+    start = benchNanotime();
+    for (found = 0, j = 0; j < lookups; j++) {
+        found += dictFind(d, probes[(j * 7919) % count]) != NULL;
+    }
+    hit_ns = benchNanotime() - start;
+    printf("dict   keys=%-10ld insert=%6.2f Mops/s  hit=%6.2f Mops/s  (found %ld)\n",
+           count, BENCH_MOPS(count, insert_ns), BENCH_MOPS(lookups, hit_ns), found);
+    dictRelease(d);
+}
+
+static void benchTemplateDict(sds *probes, long count, long lookups) {
+    Dict<sds, void *, SdsDictTraits> d;
+    long long start, insert_ns, hit_ns;
+    long j, found;
+
+    start = benchNanotime();
+    for (j = 0; j < count; j++) {
+        d.add(sdsfromlonglong(j), (void *)NULL);
+    }
+    insert_ns = benchNanotime() - start;
+    while (d.rehash(100));
+
+    start = benchNanotime();
+    for (found = 0, j = 0; j < lookups; j++) {
+        found += d.find(probes[(j * 7919) % count]) != NULL;
+    }
+    hit_ns = benchNanotime() - start;
+    printf("Dict<> keys=%-10ld insert=%6.2f Mops/s  hit=%6.2f Mops/s  (found %ld)\n",
+           count, BENCH_MOPS(count, insert_ns), BENCH_MOPS(lookups, hit_ns), found);
+}
+
+
+/**
+ * 对比C的dict（函数指针回调）与编译期特化的Dict模板，均使用sds键
+ * 参数：键数量（缺省100000），查找次数（缺省10000000）
+ */
+void templateBench(int argc, char **argv) {
+    long count = argc > 0 ? atol(argv[0]) : 100000;
+    long lookups = argc > 1 ? atol(argv[1]) : 10000000;
+    void (*benches[])(sds *, long, long) = {benchCDict, benchTemplateDict};
+    int i;
+
+    // 每种字典在单独的子进程中运行，堆的碎片状态互不影响
+    for (i = 0; i < 2; i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            sds *probes = (sds *)malloc(sizeof(sds) * count);
+            long j;
+
+            for (j = 0; j < count; j++) {
+                probes[j] = sdsfromlonglong(j);
+            }
+            benches[i](probes, count, lookups);
+            fflush(stdout);
+            _exit(0);
+        }
+        waitpid(pid, NULL, 0);
+    }
+}
@@ -0,0 +1,187 @@
+#include <stdint.h>
+
+#include "concurrentdict.h"
+#include "zmalloc.h"
+
+
+// 按哈希值的高位选择分片，与dict用来选择桶的低位互不相关
+static inline concurrentDictShard *_concurrentDictShard(concurrentDict *cd, uint64_t hash) {
+    if (cd->shardbits == 0) {
+        return &cd->shards[0];
+    }
+    return &cd->shards[hash >> (64 - cd->shardbits)];
+}
+
+
+/**
+ * 创建分片字典
+ * @param  type         类型特定函数
+ * @param  privDataPtr  私有数据，所有分片共用
+ * @param  shardbits    分片数量为2^shardbits，范围0到CONCURRENTDICT_MAX_SHARD_BITS
+ * @return              失败时返回NULL
+ */
+concurrentDict *concurrentDictCreate(dictType *type, void *privDataPtr, int shardbits) {
+    concurrentDict *cd;
+    unsigned long i, count;
+
+    if (shardbits < 0 || shardbits > CONCURRENTDICT_MAX_SHARD_BITS) {
+        return NULL;
+    }
+
+    count = 1UL << shardbits;
+    cd = zmalloc(sizeof(*cd));
+    cd->type = type;
+    cd->shardbits = shardbits;
+    cd->shards = zmalloc_aligned(64, sizeof(concurrentDictShard) * count);
+    for (i = 0; i < count; i++) {
+        pthread_rwlock_init(&cd->shards[i].lock, NULL);
+        cd->shards[i].d = dictCreate(type, privDataPtr);
+    }
+    return cd;
+}
+
+
+/**
+ * 添加键值对
+ * @param  cd   分片字典
+ * @param  key  键
+ * @param  val  值
+ * @return      键已存在时返回DICT_ERR
+ */
+int concurrentDictAdd(concurrentDict *cd, void *key, void *val) {
+    concurrentDictShard *shard = _concurrentDictShard(cd, cd->type->hashFunction(key));
+    int retval;
+
+    pthread_rwlock_wrlock(&shard->lock);
+    retval = dictAdd(shard->d, key, val);
+    pthread_rwlock_unlock(&shard->lock);
+    return retval;
+}
+
+
+// 删除键
+int concurrentDictDelete(concurrentDict *cd, const void *key) {
+    concurrentDictShard *shard = _concurrentDictShard(cd, cd->type->hashFunction(key));
+    int retval;
+
+    pthread_rwlock_wrlock(&shard->lock);
+    retval = dictDelete(shard->d, key);
+    pthread_rwlock_unlock(&shard->lock);
+    return retval;
+}
+
+
+/**
+ * 查找键，只持有分片的读锁
+ * @param  cd   分片字典
+ * @param  key  键
+ * @param  val  可以为NULL，找到时写入值
+ * @return      找到返回DICT_OK，否则返回DICT_ERR
+ */
+int concurrentDictFind(concurrentDict *cd, const void *key, void **val) {
+    uint64_t hash = cd->type->hashFunction(key);
+    concurrentDictShard *shard = _concurrentDictShard(cd, hash);
+    dictEntry *de;
+
+    pthread_rwlock_rdlock(&shard->lock);
+    de = dictFindByHash(shard->d, key, hash);
+    if (de && val) {
+        *val = shard->d->type->noValue ? NULL : dictGetVal(de);
+    }
+    pthread_rwlock_unlock(&shard->lock);
+    return de ? DICT_OK : DICT_ERR;
+}
+
+
+// 所有分片的节点总数，各分片依次加锁统计，并发修改时只是近似值
+unsigned long concurrentDictSize(concurrentDict *cd) {
+    unsigned long i, size = 0;
+
+    for (i = 0; i < (1UL << cd->shardbits); i++) {
+        pthread_rwlock_rdlock(&cd->shards[i].lock);
+        size += dictSize(cd->shards[i].d);
+        pthread_rwlock_unlock(&cd->shards[i].lock);
+    }
+    return size;
+}
+
+
+/**
+ * 遍历所有节点
+ * 逐个分片持有读锁，直接读取两个哈希表而不使用dictIterator（它会修改字典的
+ * iterators计数），回调中不能修改字典。
+ * 遍历过程中其他分片仍可被修改，结果不是整个字典的一致快照。
+ * @param  cd        分片字典
+ * @param  fn        每个节点调用一次
+ * @param  privdata  传给fn的私有数据
+ * @return void
+ */
+void concurrentDictForEach(concurrentDict *cd, dictScanFunction *fn, void *privdata) {
+    unsigned long i, idx;
+    int table;
+
+    for (i = 0; i < (1UL << cd->shardbits); i++) {
+        concurrentDictShard *shard = &cd->shards[i];
+
+        pthread_rwlock_rdlock(&shard->lock);
+        for (table = 0; table <= 1; table++) {
+            dictht *ht = &shard->d->ht[table];
+
+            for (idx = 0; idx < ht->size; idx++) {
+                dictEntry *de = ht->table[idx];
+
+                while (de) {
+                    fn(privdata, de);
+                    de = de->next;
+                }
+            }
+        }
+        pthread_rwlock_unlock(&shard->lock);
+    }
+}
+
+
+/**
+ * 推进所有分片的rehash，每个分片只在迁移期间短暂持有写锁
+ * @param  cd  分片字典
+ * @param  ms  总的时间预算（毫秒）
+ * @return     迁移的桶数（以100为单位）
+ */
+int concurrentDictRehashMilliseconds(concurrentDict *cd, int ms) {
+    long long start = timeInMilliseconds();
+    unsigned long i;
+    int rehashes = 0;
+
+    for (i = 0; i < (1UL << cd->shardbits); i++) {
+        concurrentDictShard *shard = &cd->shards[i];
+
+        while (1) {
+            int more;
+
+            pthread_rwlock_wrlock(&shard->lock);
+            more = dictRehash(shard->d, 100);
+            pthread_rwlock_unlock(&shard->lock);
+            if (!more) {
+                break;
+            }
+            rehashes += 100;
+            if (timeInMilliseconds() - start > ms) {
+                return rehashes;
+            }
+        }
+    }
+    return rehashes;
+}
+
+
+// 释放分片字典，调用时不能有其他线程在访问
+void concurrentDictRelease(concurrentDict *cd) {
+    unsigned long i;
+
+    for (i = 0; i < (1UL << cd->shardbits); i++) {
+        dictRelease(cd->shards[i].d);
+        pthread_rwlock_destroy(&cd->shards[i].lock);
+    }
+    zfree(cd->shards);
+    zfree(cd);
+}
@@ -0,0 +1,55 @@
+#ifndef __CONCURRENTDICT_H__
+#define __CONCURRENTDICT_H__
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "dict.h"
+
+/*
+ * 分片的线程安全字典
+ *
+ * 由2^shardbits个dict分片组成，键按哈希值的高位选择分片（dict自身用低位选择桶），
+ * 每个分片有自己的读写锁和独立的渐进式rehash。
+ *   - 查找只持有分片的读锁，使用不推进rehash的dictFindByHash，多个读者可以并行
+ *   - 添加和删除持有分片的写锁，顺带推进该分片的rehash
+ *   - 只有读操作的分片不会推进rehash，可以定期调用concurrentDictRehashMilliseconds
+ *
+ * 查找不返回节点指针（释放读锁后节点可能被其他线程删除），而是在锁内复制出值。
+ * 值本身的生命周期由调用者保证。
+ */
+
+#define CONCURRENTDICT_MAX_SHARD_BITS 16
+
+// 分片，大小对齐到缓存行，减少相邻分片的锁伪共享
+typedef struct concurrentDictShard {
+    pthread_rwlock_t lock;
+    dict *d;
+} __attribute__((aligned(64))) concurrentDictShard;
+
+
+// 分片字典
+typedef struct concurrentDict {
+    // 类型特定函数，所有分片共用
+    dictType *type;
+
+    // 分片数组
+    concurrentDictShard *shards;
+
+    // 分片数量为2^shardbits
+    int shardbits;
+} concurrentDict;
+
+
+/* ------------------------------- APIs ------------------------------------*/
+concurrentDict *concurrentDictCreate(dictType *type, void *privDataPtr, int shardbits);
+int concurrentDictAdd(concurrentDict *cd, void *key, void *val);
+int concurrentDictDelete(concurrentDict *cd, const void *key);
+int concurrentDictFind(concurrentDict *cd, const void *key, void **val);
+void concurrentDictRelease(concurrentDict *cd);
+
+unsigned long concurrentDictSize(concurrentDict *cd);
+void concurrentDictForEach(concurrentDict *cd, dictScanFunction *fn, void *privdata);
+int concurrentDictRehashMilliseconds(concurrentDict *cd, int ms);
+
+#endif
@@ -1,25 +1,141 @@
+#include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <limits.h>
 #include <assert.h>
+#include <string.h>
 #include <sys/time.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "dict.h"
 #include "hash.h"
 #include "zmalloc.h"
 
 
+// 全局的自动调整大小开关，例如在fork出子进程期间关闭，避免写时复制
 static int dict_can_resize = 1;
 static unsigned int dict_force_resize_ratio = 5;
 
+// 哈希表填充率（百分比）低于该值时自动缩小
+static unsigned int dict_min_fill = DICT_HT_MIN_FILL;
+
+// 大的桶数组是否使用透明大页
+static int dict_table_hugepages = 1;
+
 
 /* -------------------------- hash functions -------------------------------- */
 
+// 哈希种子，进程启动时从随机源初始化，使哈希值不可预测，防止哈希洪水攻击
 static uint8_t dict_hash_function_seed[16];
 
+// 从/dev/urandom读取种子，失败时退化为时间和进程号的混合
+static void _dictInitHashFunctionSeed(void) __attribute__((constructor));
+static void _dictInitHashFunctionSeed(void) {
+    uint8_t seed[16];
+    ssize_t nread = -1;
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+
+    if (fd != -1) {
+        nread = read(fd, seed, sizeof(seed));
+        close(fd);
+    }
+    if (nread != (ssize_t)sizeof(seed)) {
+        struct timeval tv;
+        uint64_t k[2], h[2];
+
+        gettimeofday(&tv, NULL);
+        k[0] = ((uint64_t)tv.tv_sec << 20) ^ (uint64_t)tv.tv_usec;
+        k[1] = ((uint64_t)getpid() << 32) ^ (uint64_t)(uintptr_t)&tv;
+        h[0] = siphash((uint8_t *)&k[0], sizeof(k[0]), (uint8_t *)k);
+        h[1] = siphash((uint8_t *)&k[1], sizeof(k[1]), (uint8_t *)k);
+        memcpy(seed, h, sizeof(seed));
+    }
+    dictSetHashFunctionSeed(seed);
+}
+
+/**
+ * 设置哈希种子，必须在创建任何字典之前调用，否则已有字典中的键将无法找到
+ * @param  seed  16字节的种子
+ * @return void
+ */
+void dictSetHashFunctionSeed(const uint8_t *seed) {
+    memcpy(dict_hash_function_seed, seed, sizeof(dict_hash_function_seed));
+}
+
+// 获取当前的16字节哈希种子
+uint8_t *dictGetHashFunctionSeed(void) {
+    return dict_hash_function_seed;
+}
+
+// 默认哈希函数，SipHash-1-2
 uint64_t dictGenHashFunction(const void *key, int len) {
     return siphash(key, len, dict_hash_function_seed);
 }
 
+/**
+ * 批量计算dictGenHashFunction，每8个（不足时4个）键一组使用多路SipHash
+ * 供dictType的hashBatch回调使用，结果与逐个调用dictGenHashFunction相同
+ * @param  keys    键数组
+ * @param  lens    键长度数组
+ * @param  n       键的数量
+ * @param  hashes  输出的哈希值
+ * @return void
+ */
+void dictGenHashFunctionBatch(const void **keys, const size_t *lens, size_t n, uint64_t *hashes) {
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        siphash_x8((const uint8_t *const *)keys + i, lens + i, dict_hash_function_seed, hashes + i);
+    }
+    for (; i + 4 <= n; i += 4) {
+        siphash_x4((const uint8_t *const *)keys + i, lens + i, dict_hash_function_seed, hashes + i);
+    }
+    for (; i < n; i++) {
+        hashes[i] = siphash(keys[i], lens[i], dict_hash_function_seed);
+    }
+}
+
+// 大小写不敏感的哈希函数，配合不区分大小写的keyCompare使用
+uint64_t dictGenCaseHashFunction(const void *key, int len) {
+    return siphash_nocase(key, len, dict_hash_function_seed);
+}
+
+// 标准强度的SipHash-2-4
+uint64_t dictGenSipHash24Function(const void *key, int len) {
+    return siphash24(key, len, dict_hash_function_seed);
+}
+
+// 非加密的快速哈希（XXH3-64），只用于键不受外部控制的字典
+uint64_t dictGenFastHashFunction(const void *key, int len) {
+    uint64_t seed;
+
+    memcpy(&seed, dict_hash_function_seed, sizeof(seed));
+    return xxh3_64(key, len, seed);
+}
+
+/* ------------------------------ resize policy ----------------------------- */
+
+void dictEnableResize(void) {
+    dict_can_resize = 1;
+}
+
+void dictDisableResize(void) {
+    dict_can_resize = 0;
+}
+
+// 设置自动缩小的填充率阈值（百分比），0表示不自动缩小
+void dictSetMinFill(unsigned int percent) {
+    dict_min_fill = percent;
+}
+
+// 设置达到DICT_TABLE_HUGEPAGE_THRESHOLD的桶数组是否使用透明大页，只影响之后分配的数组
+void dictSetTableHugePages(int enable) {
+    dict_table_hugepages = enable;
+}
+
 /* ----------------------------- API implementation ------------------------- */
 
 // 重置哈希表
@@ -32,6 +148,52 @@ static void _dictReset(dictht *ht)
 }
 
 
+// 节点头部的大小，内嵌的键紧跟在头部之后
+static inline size_t _dictEntryHeaderSize(dictType *type) {
+    return type->noValue ? sizeof(dictEntryNoValue) : sizeof(dictEntry);
+}
+
+// 分配节点并设置键
+static inline dictEntry *_dictAllocEntry(dict *d, void *key) {
+    dictEntry *entry;
+
+    if (d->type->keyEmbed) {
+        size_t hdrsize = _dictEntryHeaderSize(d->type);
+        entry = zmalloc(hdrsize + d->type->keyEmbedSize(key));
+        entry->key = d->type->keyEmbed((char *)entry + hdrsize, key);
+        return entry;
+    }
+
+    if (d->entryPool) {
+        entry = slabAlloc(d->entryPool);
+    } else {
+        entry = zmalloc(_dictEntryHeaderSize(d->type));
+    }
+    dictSetKey(d, entry, key);
+    return entry;
+}
+
+// 释放节点
+static inline void _dictFreeEntry(dict *d, dictEntry *he) {
+    if (d->entryPool) {
+        slabFree(d->entryPool, he);
+    } else {
+        zfree(he);
+    }
+}
+
+// 释放节点以及节点的键和值
+static void _dictReleaseEntry(dict *d, dictEntry *he) {
+    if (!d->type->keyEmbed) {
+        dictFreeKey(d, he);
+    }
+    if (!d->type->noValue) {
+        dictFreeVal(d, he);
+    }
+    _dictFreeEntry(d, he);
+}
+
+
 // 初始化字典
 static int _dictInit(dict *d, dictType *type, void *privDataPtr) {
     _dictReset(&d->ht[0]);
@@ -40,6 +202,15 @@ static int _dictInit(dict *d, dictType *type, void *privDataPtr) {
     d->privdata = privDataPtr;
     d->rehashidx = -1;
     d->iterators = 0;
+    d->resizable = 1;
+    d->entryPool = NULL;
+    d->scheduler = NULL;
+    d->schedIndex = -1;
+    d->clearidx = 0;
+    if (type->pooledEntries && !type->keyEmbed) {
+        d->entryPool = zmalloc(sizeof(slabPool));
+        slabPoolInit(d->entryPool, _dictEntryHeaderSize(type));
+    }
     return DICT_OK;
 }
 
@@ -56,6 +227,64 @@ dict *dictCreate(dictType *type, void *privDataPtr) {
     return d;
 }
 
+static void _dictSchedulerPush(dict *d);
+static void _dictSchedulerRemove(dict *d);
+
+
+/**
+ * 分配清零的桶数组
+ * 小数组使用zcalloc；达到DICT_TABLE_MMAP_THRESHOLD时直接mmap，内核按需提供零页，
+ * 扩充时不需要一次写遍整个数组；达到DICT_TABLE_HUGEPAGE_THRESHOLD时再把起始地址
+ * 对齐到大页边界并建议内核使用透明大页，减少随机访问时的TLB缺失
+ * @param  size  桶数
+ * @return       分配失败时返回NULL
+ */
+static dictEntry **_dictAllocTable(unsigned long size) {
+    size_t bytes = size * sizeof(dictEntry *);
+    char *p, *aligned;
+    size_t len;
+
+    if (bytes < DICT_TABLE_MMAP_THRESHOLD) {
+        return zcalloc(size, sizeof(dictEntry *));
+    }
+
+    if (!dict_table_hugepages || bytes < DICT_TABLE_HUGEPAGE_THRESHOLD) {
+        p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return p == MAP_FAILED ? NULL : (dictEntry **)p;
+    }
+
+    // 多映射一个大页，再释放首尾多余的部分，得到对齐的区间
+    len = bytes + DICT_HUGEPAGE_SIZE;
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        return NULL;
+    }
+    aligned = (char *)(((uintptr_t)p + DICT_HUGEPAGE_SIZE - 1) & ~((uintptr_t)DICT_HUGEPAGE_SIZE - 1));
+    if (aligned > p) {
+        munmap(p, aligned - p);
+    }
+    if (p + len > aligned + bytes) {
+        munmap(aligned + bytes, p + len - (aligned + bytes));
+    }
+#ifdef MADV_HUGEPAGE
+    // 内核不支持透明大页时失败，不影响使用
+    madvise(aligned, bytes, MADV_HUGEPAGE);
+#endif
+    return (dictEntry **)aligned;
+}
+
+// 释放桶数组，size必须与分配时相同
+static void _dictFreeTable(dictEntry **table, unsigned long size) {
+    size_t bytes = size * sizeof(dictEntry *);
+
+    if (bytes < DICT_TABLE_MMAP_THRESHOLD) {
+        zfree(table);
+    } else {
+        munmap(table, bytes);
+    }
+}
+
+
 /**
  * rehash操作
  * @param  d  字典
@@ -98,10 +327,11 @@ int dictRehash(dict *d, int n) {
 
     // 全部移动到新表后，将ht[1]设置为ht[0]
     if (d->ht[0].used == 0) {
-        zfree(d->ht[0].table);
+        _dictFreeTable(d->ht[0].table, d->ht[0].size);
         d->ht[0] = d->ht[1];
         _dictReset(&d->ht[1]);
         d->rehashidx = -1;
+        _dictSchedulerRemove(d);
         return 0;
     }
 
@@ -118,6 +348,11 @@ static void _dictRehashStep(dict *d) {
 }
 
 
+// 是否允许自动调整字典的大小
+static int _dictCanResize(dict *d) {
+    return dict_can_resize && d->resizable;
+}
+
 // 扩充后的哈希表大小
 static unsigned long _dictNextPower(unsigned long size)
 {
@@ -149,8 +384,11 @@ int dictExpand(dict *d, unsigned long size) {
 
     n.size = realsize;
     n.sizemask = realsize - 1;
-    n.table = zmalloc(realsize * sizeof(dictEntry *));
+    n.table = _dictAllocTable(realsize);
     n.used = 0;
+    if (n.table == NULL) {
+        return DICT_ERR;
+    }
 
     if (d->ht[0].table == NULL) {
         d->ht[0] = n;
@@ -159,9 +397,29 @@ int dictExpand(dict *d, unsigned long size) {
 
     d->ht[1] = n;
     d->rehashidx = 0;
+    _dictSchedulerPush(d);
     return DICT_OK;
 }
 
+/**
+ * 把哈希表缩小到能容纳所有节点的最小大小
+ * @param  d  字典
+ * @return    不允许调整大小或者正在rehash时返回DICT_ERR
+ */
+int dictResize(dict *d) {
+    unsigned long minimal;
+
+    if (!_dictCanResize(d) || dictIsRehashing(d)) {
+        return DICT_ERR;
+    }
+
+    minimal = d->ht[0].used;
+    if (minimal < DICT_HT_INITIAL_SIZE) {
+        minimal = DICT_HT_INITIAL_SIZE;
+    }
+    return dictExpand(d, minimal);
+}
+
 // 如果需要，则重新调整哈希表大小
 static int _dictExpandIfNeeded(dict *d) {
     if (dictIsRehashing(d)) {
@@ -173,14 +431,30 @@ static int _dictExpandIfNeeded(dict *d) {
         return dictExpand(d, DICT_HT_INITIAL_SIZE);
     }
 
-    // 需要判断dict_can_resize，或者空间使用比例
+    // 需要判断是否允许调整大小，或者空间使用比例
     if (d->ht[0].used >= d->ht[0].size &&
-        (dict_can_resize || d->ht[0].used / d->ht[0].size > dict_force_resize_ratio)) {
+        (_dictCanResize(d) || d->ht[0].used / d->ht[0].size > dict_force_resize_ratio)) {
         return dictExpand(d, d->ht[0].size * 2);
     }
     return DICT_OK;
 }
 
+// 如果填充率过低，则开始缩小哈希表，复用渐进式rehash
+static int _dictShrinkIfNeeded(dict *d) {
+    unsigned long size = d->ht[0].size, used = d->ht[0].used;
+
+    if (dictIsRehashing(d) || size <= DICT_HT_INITIAL_SIZE) {
+        return DICT_OK;
+    }
+
+    // 与扩充相同，不允许调整大小时只在填充率低到dict_force_resize_ratio倍以下时才缩小
+    if ((_dictCanResize(d) && used * 100 < size * dict_min_fill) ||
+        used * 100 * dict_force_resize_ratio < size * dict_min_fill) {
+        return dictExpand(d, used < DICT_HT_INITIAL_SIZE ? DICT_HT_INITIAL_SIZE : used);
+    }
+    return DICT_OK;
+}
+
 /**
  * 获取一个键的索引
  */
@@ -211,8 +485,21 @@ static long _dictKeyIndex(dict *d, const void *key, uint64_t hash, dictEntry **e
     return idx;
 }
 
-// 添加值
-dictEntry *dictAddRaw(dict *d, void *key, dictEntry **existing) {
+// 批量计算哈希值，类型提供了hashBatch时使用它
+static void _dictHashKeys(dict *d, const void **keys, size_t n, uint64_t *hashes) {
+    size_t i;
+
+    if (d->type->hashBatch) {
+        d->type->hashBatch(keys, n, hashes);
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        hashes[i] = dictHashKey(d, keys[i]);
+    }
+}
+
+// 使用已经算好的哈希值添加键
+static dictEntry *_dictAddRawWithHash(dict *d, void *key, uint64_t hash, dictEntry **existing) {
     long index;
     dictEntry *entry;
     dictht *ht;
@@ -222,22 +509,25 @@ dictEntry *dictAddRaw(dict *d, void *key, dictEntry **existing) {
         _dictRehashStep(d);
     }
 
-    if ((index = _dictKeyIndex(d, key, dictHashKey(d, key), existing)) == -1) {
+    if ((index = _dictKeyIndex(d, key, hash, existing)) == -1) {
         return NULL;
     }
 
     ht = dictIsRehashing(d) ? &d->ht[1] : &d->ht[0];
 
-    entry = zmalloc(sizeof(*entry));
+    entry = _dictAllocEntry(d, key);
     entry->next = ht->table[index];
     ht->table[index] = entry;
     ht->used++;
 
-    dictSetKey(d, entry, key);
-
     return entry;
 }
 
+// 添加值
+dictEntry *dictAddRaw(dict *d, void *key, dictEntry **existing) {
+    return _dictAddRawWithHash(d, key, dictHashKey(d, key), existing);
+}
+
 /**
  * 将给定的键值对添加到字典
  * @param  d    字典
@@ -251,10 +541,168 @@ int dictAdd(dict *d, void *key, void *val) {
         return DICT_ERR;
     }
 
-    dictSetVal(d, entry, val);
+    // 集合模式的节点没有值
+    if (!d->type->noValue) {
+        dictSetVal(d, entry, val);
+    }
     return DICT_OK;
 }
 
+/**
+ * 批量添加键值对，哈希值按DICT_FIND_BATCH一组通过hashBatch计算
+ * 已存在的键不会被添加，调用者仍然拥有它
+ * @param  d     字典
+ * @param  keys  键数组
+ * @param  vals  值数组，集合模式下可以为NULL
+ * @param  n     键的数量
+ * @param  out   可以为NULL，out[i]为新节点，键已存在时为NULL
+ * @return       添加的键数量
+ */
+size_t dictAddMany(dict *d, void **keys, void **vals, size_t n, dictEntry **out) {
+    uint64_t hashes[DICT_FIND_BATCH];
+    size_t base, i, added = 0;
+
+    for (base = 0; base < n; base += DICT_FIND_BATCH) {
+        size_t batch = (n - base < DICT_FIND_BATCH) ? n - base : DICT_FIND_BATCH;
+
+        _dictHashKeys(d, (const void **)keys + base, batch, hashes);
+        for (i = 0; i < batch; i++) {
+            dictEntry *entry = _dictAddRawWithHash(d, keys[base + i], hashes[i], NULL);
+
+            if (entry) {
+                if (!d->type->noValue) {
+                    dictSetVal(d, entry, vals ? vals[base + i] : NULL);
+                }
+                added++;
+            }
+            if (out) {
+                out[base + i] = entry;
+            }
+        }
+    }
+    return added;
+}
+
+
+// 把键按桶号的高位分组，同一组的桶在内存中相邻
+// 键、值和哈希值按分组后的顺序写入新的数组，插入时顺序读取
+static void _dictBulkPartition(dictht *ht, size_t n, void ***keys, void ***vals, uint64_t **hashes) {
+    unsigned long shift = 0, groups, g;
+    void **pkeys = zmalloc(n * sizeof(void *));
+    void **pvals = *vals ? zmalloc(n * sizeof(void *)) : NULL;
+    uint64_t *phashes = zmalloc(n * sizeof(uint64_t));
+    size_t *start, i;
+
+    while ((ht->size >> shift) > (1UL << DICT_BULK_GROUP_BITS)) {
+        shift++;
+    }
+    groups = ht->size >> shift;
+    start = zmalloc((groups + 1) * sizeof(size_t));
+    memset(start, 0, (groups + 1) * sizeof(size_t));
+
+    // 计数排序：先统计每组的数量，再计算每组的起始位置，最后分配
+    for (i = 0; i < n; i++) {
+        start[(((*hashes)[i] & ht->sizemask) >> shift) + 1]++;
+    }
+    for (g = 1; g <= groups; g++) {
+        start[g] += start[g - 1];
+    }
+    for (i = 0; i < n; i++) {
+        size_t pos = start[((*hashes)[i] & ht->sizemask) >> shift]++;
+
+        pkeys[pos] = (*keys)[i];
+        phashes[pos] = (*hashes)[i];
+        if (pvals) {
+            pvals[pos] = (*vals)[i];
+        }
+    }
+
+    zfree(start);
+    zfree(*hashes);
+    *keys = pkeys;
+    *vals = pvals;
+    *hashes = phashes;
+}
+
+/**
+ * 批量装载键值对，用于从快照等来源一次性加载大量的键
+ * 先按最终大小扩充哈希表并完成rehash，装载过程中不再扩充和rehash。
+ * 有安全迭代器时无法完成rehash，新节点写入ht[1]，表的大小可能不足。
+ * @param  d      字典
+ * @param  keys   键数组
+ * @param  vals   值数组，为NULL时值为NULL
+ * @param  n      键的数量
+ * @param  flags  DICT_BULK_UNIQUE：调用者保证键互不相同且不在字典中，跳过重复检查；
+ *                DICT_BULK_PARTITION：先按桶号分组再插入，写桶数组时更好地利用缓存，
+ *                需要额外的3*n*8字节临时内存（有值时4*n*8）
+ * @return        添加的键数量，已存在的键被跳过
+ */
+size_t dictBulkLoad(dict *d, void **keys, void **vals, size_t n, int flags) {
+    uint64_t batch[DICT_FIND_BATCH], *hashes = NULL;
+    size_t i, added = 0;
+    dictht *ht;
+
+    if (n == 0) {
+        return 0;
+    }
+
+    // 预先扩充，之后的插入都落在同一张表上
+    if (d->iterators == 0) {
+        while (dictRehash(d, 1000));
+    }
+    if (!dictIsRehashing(d) && d->ht[0].size < d->ht[0].used + n) {
+        dictExpand(d, d->ht[0].used + n);
+        if (d->iterators == 0) {
+            while (dictRehash(d, 1000));
+        }
+    }
+    ht = dictIsRehashing(d) ? &d->ht[1] : &d->ht[0];
+
+    if (flags & DICT_BULK_PARTITION) {
+        hashes = zmalloc(n * sizeof(uint64_t));
+        for (i = 0; i < n; i += DICT_FIND_BATCH) {
+            size_t m = (n - i < DICT_FIND_BATCH) ? n - i : DICT_FIND_BATCH;
+            _dictHashKeys(d, (const void **)keys + i, m, hashes + i);
+        }
+        _dictBulkPartition(ht, n, &keys, &vals, &hashes);
+    }
+
+    for (i = 0; i < n; i++) {
+        dictEntry *entry;
+        uint64_t h;
+
+        if (hashes) {
+            h = hashes[i];
+        } else {
+            if (i % DICT_FIND_BATCH == 0) {
+                size_t m = (n - i < DICT_FIND_BATCH) ? n - i : DICT_FIND_BATCH;
+                _dictHashKeys(d, (const void **)keys + i, m, batch);
+            }
+            h = batch[i % DICT_FIND_BATCH];
+        }
+
+        if (flags & DICT_BULK_UNIQUE) {
+            entry = _dictAllocEntry(d, keys[i]);
+            entry->next = ht->table[h & ht->sizemask];
+            ht->table[h & ht->sizemask] = entry;
+            ht->used++;
+        } else if ((entry = _dictAddRawWithHash(d, keys[i], h, NULL)) == NULL) {
+            continue;
+        }
+        if (!d->type->noValue) {
+            dictSetVal(d, entry, vals ? vals[i] : NULL);
+        }
+        added++;
+    }
+
+    if (hashes) {
+        zfree(hashes);
+        zfree(keys);
+        zfree(vals);
+    }
+    return added;
+}
+
 
 // 删除键
 static dictEntry *dictGenericDelete(dict *d, const void *key, int nofree) {
@@ -285,11 +733,10 @@ static dictEntry *dictGenericDelete(dict *d, const void *key, int nofree) {
                     d->ht[table].table[idx] = he->next;
                 }
                 if (!nofree) {
-                    dictFreeKey(d, he);
-                    dictFreeVal(d, he);
-                    zfree(he);
+                    _dictReleaseEntry(d, he);
                 }
                 d->ht[table].used--;
+                _dictShrinkIfNeeded(d);
                 return he;
             }
             prevHe = he;
@@ -314,36 +761,60 @@ int dictDelete(dict *d, const void *key) {
 }
 
 
-// 清空字典的哈希表
-static int _dictClear(dict *d, dictht *ht, void(callback)(void *)) {
+// 清空字典的哈希表，从d->clearidx处的桶继续
+// budget不为NULL时，每释放一个节点或访问一个空桶消耗1，用完时停止，
+// 停在链表中间时剩余的节点留在桶中，下次从这个桶继续
+// callback每访问65536个桶调用一次，供调用者在长时间的清空过程中处理其他事情
+// 全部清空后释放桶数组并返回0，否则返回1
+static int _dictClear(dict *d, dictht *ht, unsigned long *budget, void(callback)(void *)) {
     unsigned long i;
 
+    if (ht->size == 0) {
+        return 0;
+    }
+
     // 释放所有元素
-    for (i = 0; i < ht->size && ht->used > 0; i++) {
+    for (i = d->clearidx; i < ht->size && ht->used > 0; i++) {
         dictEntry *he, *nextHe;
 
+        if (budget && *budget == 0) {
+            d->clearidx = i;
+            return 1;
+        }
+
         if (callback && (i & 65535) == 0) {
             callback(d->privdata);
         }
 
         if ((he = ht->table[i]) == NULL) {
+            if (budget) {
+                (*budget)--;
+            }
             continue;
         }
 
         while(he) {
+            if (budget && *budget == 0) {
+                ht->table[i] = he;
+                d->clearidx = i;
+                return 1;
+            }
             nextHe = he->next;
-            dictFreeKey(d, he);
-            dictFreeVal(d, he);
-            zfree(he);
+            _dictReleaseEntry(d, he);
             ht->used--;
             he = nextHe;
+            if (budget) {
+                (*budget)--;
+            }
         }
+        ht->table[i] = NULL;
     }
 
-    zfree(ht->table);
+    _dictFreeTable(ht->table, ht->size);
     _dictReset(ht);
+    d->clearidx = 0;
 
-    return DICT_OK;
+    return 0;
 }
 
 
@@ -353,11 +824,52 @@ static int _dictClear(dict *d, dictht *ht, void(callback)(void *)) {
  * @return void
  */
 void dictRelease(dict *d) {
-    _dictClear(d, &d->ht[0], NULL);
-    _dictClear(d, &d->ht[1], NULL);
+    dictSetRehashScheduler(d, NULL);
+    _dictClear(d, &d->ht[0], NULL, NULL);
+    _dictClear(d, &d->ht[1], NULL, NULL);
+    if (d->entryPool) {
+        slabPoolRelease(d->entryPool);
+        zfree(d->entryPool);
+    }
     zfree(d);
 }
 
+// 清空完成后恢复为空字典
+static void _dictEmptied(dict *d) {
+    d->rehashidx = -1;
+    d->iterators = 0;
+    _dictSchedulerRemove(d);
+}
+
+/**
+ * 清空字典，字典仍然可以继续使用
+ * @param  d         字典指针
+ * @param  callback  每访问65536个桶调用一次，可以为NULL
+ */
+void dictEmpty(dict *d, void(callback)(void *)) {
+    _dictClear(d, &d->ht[0], NULL, callback);
+    _dictClear(d, &d->ht[1], NULL, callback);
+    _dictEmptied(d);
+}
+
+/**
+ * 渐进式清空字典，每次只做有限的工作，适合在单线程中分多次释放大字典
+ * 清空完成之前除了继续调用dictEmptyStep和dictRelease，不能对字典执行其他操作
+ * @param  d       字典指针
+ * @param  budget  本次最多的工作量，释放一个节点或者访问一个空桶计为1
+ * @return         1表示还需要继续，0表示已经清空
+ */
+int dictEmptyStep(dict *d, unsigned long budget) {
+    if (budget == 0) {
+        budget = 1;
+    }
+    if (_dictClear(d, &d->ht[0], &budget, NULL) || _dictClear(d, &d->ht[1], &budget, NULL)) {
+        return 1;
+    }
+    _dictEmptied(d);
+    return 0;
+}
+
 
 /**
  * [dictFind 查找键]
@@ -366,9 +878,6 @@ void dictRelease(dict *d) {
  * @return     [节点]
  */
 dictEntry *dictFind(dict *d, const void *key) {
-    dictEntry *he;
-    uint64_t h, idx, table;
-
     if (d->ht[0].used + d->ht[1].used == 0) {
         return NULL;
     }
@@ -377,9 +886,29 @@ dictEntry *dictFind(dict *d, const void *key) {
         _dictRehashStep(d);
     }
 
-    h = dictHashKey(d, key);
+    return dictFindByHash(d, key, dictHashKey(d, key));
+}
+
+
+/**
+ * 使用已经算好的哈希值查找键
+ * 与dictFind不同，不会推进rehash，也不会修改字典的任何字段，
+ * 因此在没有写者的情况下可以被多个线程同时调用
+ * @param  d     字典指针
+ * @param  key   键
+ * @param  hash  键的哈希值，必须等于dictHashKey(d, key)
+ * @return       节点
+ */
+dictEntry *dictFindByHash(dict *d, const void *key, uint64_t hash) {
+    dictEntry *he;
+    uint64_t idx, table;
+
+    if (d->ht[0].used + d->ht[1].used == 0) {
+        return NULL;
+    }
+
     for (table = 0; table <= 1; table++) {
-        idx = h & d->ht[table].sizemask;
+        idx = hash & d->ht[table].sizemask;
         he = d->ht[table].table[idx];
         while (he) {
             if (key == he->key || dictCompareKeys(d, key, he->key)) {
@@ -396,18 +925,205 @@ dictEntry *dictFind(dict *d, const void *key) {
 
 
 /**
- * 创建一个字典迭代器
+ * 批量查找键
+ *
+ * 每DICT_FIND_BATCH个键为一组，先计算全部哈希值并预取桶，再预取链表头节点
+ * 和它的键，最后才遍历链表。这样一组键的缓存缺失可以重叠，而不是像循环
+ * 调用dictFind那样逐个等待。
+ *
+ * @param  d     字典指针
+ * @param  keys  键数组
+ * @param  n     键的数量
+ * @param  out   输出数组，out[i]为keys[i]对应的节点，找不到为NULL
+ * @return       找到的键数量
+ */
+size_t dictFindMany(dict *d, const void **keys, size_t n, dictEntry **out) {
+    dictEntry **bucket[DICT_FIND_BATCH][2];
+    dictEntry *he[DICT_FIND_BATCH][2];
+    uint64_t hashes[DICT_FIND_BATCH];
+    size_t base, i, found = 0;
+    int table;
+
+    for (base = 0; base < n; base += DICT_FIND_BATCH) {
+        size_t batch = (n - base < DICT_FIND_BATCH) ? n - base : DICT_FIND_BATCH;
+        const void **k = keys + base;
+
+        if (dictSize(d) == 0) {
+            for (i = 0; i < batch; i++) {
+                out[base + i] = NULL;
+            }
+            continue;
+        }
+
+        // 与逐个调用dictFind的rehash进度保持一致，并且在计算索引前完成，
+        // 保证本组处理期间两个哈希表不再变化
+        if (dictIsRehashing(d)) {
+            for (i = 0; i < batch; i++) {
+                _dictRehashStep(d);
+            }
+        }
+
+        // 计算哈希值时要读取键本身，先一起预取
+        for (i = 0; i < batch; i++) {
+            __builtin_prefetch(k[i]);
+        }
+
+        // 第一步：计算哈希值，预取桶
+        _dictHashKeys(d, k, batch, hashes);
+        for (i = 0; i < batch; i++) {
+            uint64_t h = hashes[i];
+
+            for (table = 0; table <= 1; table++) {
+                uint64_t idx = h & d->ht[table].sizemask;
+
+                bucket[i][table] = NULL;
+                if (table == 1 && !dictIsRehashing(d)) {
+                    break;
+                }
+                // ht[0]中rehashidx之前的桶已经迁移完毕，一定为空
+                if (table == 0 && dictIsRehashing(d) && idx < (uint64_t)d->rehashidx) {
+                    continue;
+                }
+                bucket[i][table] = &d->ht[table].table[idx];
+                __builtin_prefetch(bucket[i][table]);
+            }
+        }
+
+        // 第二步：读取链表头节点并预取
+        for (i = 0; i < batch; i++) {
+            for (table = 0; table <= 1; table++) {
+                he[i][table] = bucket[i][table] ? *bucket[i][table] : NULL;
+                if (he[i][table]) {
+                    __builtin_prefetch(he[i][table]);
+                }
+            }
+        }
+
+        // 第三步：预取头节点的键，比较键时一般需要访问它
+        for (i = 0; i < batch; i++) {
+            for (table = 0; table <= 1; table++) {
+                if (he[i][table]) {
+                    __builtin_prefetch(he[i][table]->key);
+                }
+            }
+        }
+
+        // 第四步：遍历链表
+        for (i = 0; i < batch; i++) {
+            out[base + i] = NULL;
+            for (table = 0; table <= 1 && !out[base + i]; table++) {
+                dictEntry *e = he[i][table];
+                while (e) {
+                    if (k[i] == e->key || dictCompareKeys(d, k[i], e->key)) {
+                        out[base + i] = e;
+                        found++;
+                        break;
+                    }
+                    e = e->next;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+/**
+ * 字典指纹，把字典的表指针、大小和节点数量混合成一个64位整数
+ * 非安全迭代器在开始和结束时各计算一次，两者不同说明迭代期间字典被修改了
  * @param  d  字典指针
  * @return
  */
-dictIterator *dictGetIterator(dict *d) {
-    dictIterator *iter = zmalloc(sizeof(*iter));
+long long dictFingerprint(dict *d) {
+    uint64_t integers[6], hash = 0;
+    int j;
+
+    integers[0] = (uintptr_t) d->ht[0].table;
+    integers[1] = d->ht[0].size;
+    integers[2] = d->ht[0].used;
+    integers[3] = (uintptr_t) d->ht[1].table;
+    integers[4] = d->ht[1].size;
+    integers[5] = d->ht[1].used;
+
+    // 逐个混合：Result = hash(hash(hash(int1)+int2)+int3) ...
+    // 这样同样的整数以不同顺序出现时指纹也不同
+    for (j = 0; j < 6; j++) {
+        hash += integers[j];
+        // Tomas Wang的64位整数哈希
+        hash = (~hash) + (hash << 21);
+        hash = hash ^ (hash >> 24);
+        hash = (hash + (hash << 3)) + (hash << 8);
+        hash = hash ^ (hash >> 14);
+        hash = (hash + (hash << 2)) + (hash << 4);
+        hash = hash ^ (hash >> 28);
+        hash = hash + (hash << 31);
+    }
+    return (long long) hash;
+}
 
+
+/**
+ * 初始化一个非安全的字典迭代器，迭代器可以在栈上分配
+ * @param  iter  迭代器
+ * @param  d     字典指针
+ */
+void dictInitIterator(dictIterator *iter, dict *d) {
     iter->d = d;
     iter->table = 0;
     iter->index = -1;
+    iter->safe = 0;
     iter->entry = NULL;
     iter->nextEntry = NULL;
+    iter->fingerprint = 0;
+}
+
+/**
+ * 初始化一个安全的字典迭代器，迭代器可以在栈上分配
+ * @param  iter  迭代器
+ * @param  d     字典指针
+ */
+void dictInitSafeIterator(dictIterator *iter, dict *d) {
+    dictInitIterator(iter, d);
+    iter->safe = 1;
+}
+
+/**
+ * 结束迭代，恢复字典的rehash或者检查字典指纹
+ * 用于dictInitIterator/dictInitSafeIterator初始化的迭代器，之后可以重新初始化
+ * @param  iter  迭代器
+ */
+void dictResetIterator(dictIterator *iter) {
+    if (!(iter->index == -1 && iter->table == 0)) {
+        if (iter->safe) {
+            iter->d->iterators--;
+        } else {
+            assert(iter->fingerprint == dictFingerprint(iter->d));
+        }
+    }
+}
+
+/**
+ * 创建一个非安全的字典迭代器
+ * 迭代期间不能修改字典，也不能调用会执行rehash步骤的函数（如dictFind）
+ * @param  d  字典指针
+ * @return
+ */
+dictIterator *dictGetIterator(dict *d) {
+    dictIterator *iter = zmalloc(sizeof(*iter));
+
+    dictInitIterator(iter, d);
+    return iter;
+}
+
+/**
+ * 创建一个安全的字典迭代器
+ * 迭代期间暂停rehash，可以删除当前节点，也可以添加和查找
+ * @param  d  字典指针
+ * @return
+ */
+dictIterator *dictGetSafeIterator(dict *d) {
+    dictIterator *iter = dictGetIterator(d);
+
+    iter->safe = 1;
     return iter;
 }
 
@@ -422,10 +1138,14 @@ dictEntry *dictNext(dictIterator *iter) {
         if (iter->entry == NULL) {
             dictht *ht = &iter->d->ht[iter->table];
             if (iter->index == -1 && iter->table == 0) {
-                iter->d->iterators++;
+                if (iter->safe) {
+                    iter->d->iterators++;
+                } else {
+                    iter->fingerprint = dictFingerprint(iter->d);
+                }
             }
             iter->index++;
-            if (iter->index >= ht->size) {
+            if (iter->index >= (long) ht->size) {
                 if (dictIsRehashing(iter->d) && iter->table == 0) {
                     iter->table++;
                     iter->index = 0;
@@ -453,13 +1173,432 @@ dictEntry *dictNext(dictIterator *iter) {
  * @return void
  */
 void dictReleaseIterator(dictIterator *iter) {
-    if (!(iter->index == -1 && iter->table == 0)) {
-        iter->d->iterators--;
-    }
+    dictResetIterator(iter);
     zfree(iter);
 }
 
 
+/* ---------------------------- random sampling ----------------------------- */
+
+// random()只有31位，组合成覆盖整个unsigned long的随机数
+static unsigned long _dictRandom(void) {
+    return ((unsigned long)random() << 62) ^ ((unsigned long)random() << 31) ^ (unsigned long)random();
+}
+
+// 随机选择一个非空的桶，返回链表头节点
+static dictEntry *_dictRandomBucket(dict *d) {
+    dictEntry *he;
+    unsigned long h, slots;
+    int probes = 0;
+
+    if (dictIsRehashing(d)) {
+        // ht[0]中rehashidx之前的桶一定为空，把两个表看作一个连续的桶数组
+        slots = d->ht[0].size + d->ht[1].size - d->rehashidx;
+        h = d->rehashidx + _dictRandom() % slots;
+        while (1) {
+            he = (h >= d->ht[0].size) ? d->ht[1].table[h - d->ht[0].size] : d->ht[0].table[h];
+            if (he) {
+                return he;
+            }
+            if (++probes < DICT_RANDOM_PROBES) {
+                h = d->rehashidx + _dictRandom() % slots;
+            } else {
+                h = (h + 1 < d->ht[0].size + d->ht[1].size) ? h + 1 : (unsigned long)d->rehashidx;
+            }
+        }
+    }
+
+    h = _dictRandom() & d->ht[0].sizemask;
+    while ((he = d->ht[0].table[h]) == NULL) {
+        if (++probes < DICT_RANDOM_PROBES) {
+            h = _dictRandom() & d->ht[0].sizemask;
+        } else {
+            h = (h + 1) & d->ht[0].sizemask;
+        }
+    }
+    return he;
+}
+
+// 链表长度
+static unsigned long _dictChainLength(dictEntry *he) {
+    unsigned long len = 0;
+
+    while (he) {
+        he = he->next;
+        len++;
+    }
+    return len;
+}
+
+/**
+ * 随机返回一个节点
+ * 先随机选择一个非空的桶，再在链表中随机选择一个节点。链表长度不同的桶中的节点
+ * 被选中的概率不同，需要均匀分布时使用dictGetFairRandomKey。
+ * 连续DICT_RANDOM_PROBES次选中空桶后改为从最后的位置顺序查找，
+ * 禁止缩容时非常稀疏的表也只需要有限的工作。
+ * @param  d  字典
+ * @return    字典为空时返回NULL
+ */
+dictEntry *dictGetRandomKey(dict *d) {
+    dictEntry *he;
+    unsigned long listele;
+
+    if (dictSize(d) == 0) {
+        return NULL;
+    }
+
+    if (dictIsRehashing(d)) {
+        _dictRehashStep(d);
+    }
+
+    he = _dictRandomBucket(d);
+    listele = random() % _dictChainLength(he);
+    while (listele--) {
+        he = he->next;
+    }
+    return he;
+}
+
+
+/**
+ * 随机采样最多count个节点
+ * 从一个随机的桶开始连续访问后面的桶，收集其中所有的节点，相邻的桶在同一个缓存行中，
+ * 比逐个调用dictGetRandomKey便宜得多。rehash时同一个下标在两个表中都会访问。
+ * 连续空桶的数量超过count（至少5个）时跳到另一个随机位置，总步数不超过count*10，
+ * 因此稀疏的表可能返回少于count个节点。返回的节点可能重复，分布也不保证均匀。
+ * @param  d      字典
+ * @param  des    输出数组，至少能容纳count个节点
+ * @param  count  需要的节点数量
+ * @return        实际采样到的节点数量
+ */
+unsigned int dictGetSomeKeys(dict *d, dictEntry **des, unsigned int count) {
+    unsigned long j, tables, stored = 0, maxsizemask, maxsteps, i, emptylen = 0;
+
+    if (dictSize(d) < count) {
+        count = dictSize(d);
+    }
+    maxsteps = (unsigned long)count * 10;
+
+    // 做与count成比例的rehash工作
+    for (j = 0; j < count && dictIsRehashing(d); j++) {
+        _dictRehashStep(d);
+    }
+
+    tables = dictIsRehashing(d) ? 2 : 1;
+    maxsizemask = d->ht[0].sizemask;
+    if (tables > 1 && maxsizemask < d->ht[1].sizemask) {
+        maxsizemask = d->ht[1].sizemask;
+    }
+
+    i = _dictRandom() & maxsizemask;
+    while (stored < count && maxsteps--) {
+        for (j = 0; j < tables; j++) {
+            dictEntry *he;
+
+            // ht[0]中rehashidx之前的桶已经迁移完毕；如果这个下标在ht[1]中也越界，
+            // 两个表在rehashidx之前都没有节点，直接跳到rehashidx
+            if (tables == 2 && j == 0 && i < (unsigned long)d->rehashidx) {
+                if (i >= d->ht[1].size) {
+                    i = d->rehashidx;
+                } else {
+                    continue;
+                }
+            }
+            if (i >= d->ht[j].size) {
+                continue;
+            }
+
+            he = d->ht[j].table[i];
+            if (he == NULL) {
+                emptylen++;
+                if (emptylen >= 5 && emptylen > count) {
+                    i = _dictRandom() & maxsizemask;
+                    emptylen = 0;
+                }
+            } else {
+                emptylen = 0;
+                while (he) {
+                    *des++ = he;
+                    he = he->next;
+                    if (++stored == count) {
+                        return stored;
+                    }
+                }
+            }
+        }
+        i = (i + 1) & maxsizemask;
+    }
+    return stored;
+}
+
+
+/**
+ * 均匀分布的随机节点
+ * 选中长度为L的链表后以L/DICT_FAIR_RANDOM_CHAIN的概率接受，否则重新选择，
+ * 抵消dictGetRandomKey中短链表节点被选中概率偏高的问题。链表长度不超过
+ * DICT_FAIR_RANDOM_CHAIN时每个节点被选中的概率严格相等，更长的链表（负载因子
+ * 为1时概率在百万分之一以下）总是接受。平均需要选择几次非空的桶。
+ * @param  d  字典
+ * @return    字典为空时返回NULL
+ */
+dictEntry *dictGetFairRandomKey(dict *d) {
+    dictEntry *he;
+    unsigned long len, listele;
+
+    if (dictSize(d) == 0) {
+        return NULL;
+    }
+
+    if (dictIsRehashing(d)) {
+        _dictRehashStep(d);
+    }
+
+    while (1) {
+        he = _dictRandomBucket(d);
+        len = _dictChainLength(he);
+        listele = random() % DICT_FAIR_RANDOM_CHAIN;
+        if (listele < len || len > DICT_FAIR_RANDOM_CHAIN) {
+            break;
+        }
+    }
+
+    // 接受时listele在链表长度内均匀分布，直接作为选中的位置
+    if (len > DICT_FAIR_RANDOM_CHAIN) {
+        listele = random() % len;
+    }
+    while (listele--) {
+        he = he->next;
+    }
+    return he;
+}
+
+
+// 按位反转
+static unsigned long rev(unsigned long v) {
+    unsigned long s = 8 * sizeof(v);
+    unsigned long mask = ~0UL;
+    while ((s >>= 1) > 0) {
+        mask ^= (mask << s);
+        v = ((v >> s) & mask) | ((v << s) & ~mask);
+    }
+    return v;
+}
+
+
+/**
+ * 遍历字典的一个桶
+ *
+ * 从cursor为0开始，每次传入上一次返回的游标，直到返回0为止。
+ * 游标按反向二进制位递增（从高位开始加1），因此哈希表在两次调用之间扩大或缩小时，
+ * 已经访问过的桶在新表中对应的桶仍然排在游标之前，整个遍历过程中一直存在的元素
+ * 至少会被返回一次（可能重复返回）。字典中不保存任何遍历状态。
+ *
+ * rehash时先遍历小表中的桶，再遍历大表中所有由它扩展出来的桶。
+ *
+ * @param  d         字典指针
+ * @param  v         游标
+ * @param  fn        对每个节点调用的回调函数
+ * @param  privdata  回调函数的私有数据
+ * @return           下一次调用使用的游标
+ */
+unsigned long dictScan(dict *d, unsigned long v, dictScanFunction *fn, void *privdata) {
+    dictht *t0, *t1;
+    const dictEntry *de, *next;
+    unsigned long m0, m1;
+
+    if (dictSize(d) == 0) {
+        return 0;
+    }
+
+    // 回调函数可能修改字典，调用期间暂停rehash
+    d->iterators++;
+
+    if (!dictIsRehashing(d)) {
+        t0 = &(d->ht[0]);
+        m0 = t0->sizemask;
+
+        de = t0->table[v & m0];
+        while (de) {
+            next = de->next;
+            fn(privdata, de);
+            de = next;
+        }
+
+        // 只保留掩码以内的位，其余位置1后再反向加1
+        v |= ~m0;
+        v = rev(v);
+        v++;
+        v = rev(v);
+    } else {
+        t0 = &d->ht[0];
+        t1 = &d->ht[1];
+
+        // 保证t0是小表
+        if (t0->size > t1->size) {
+            t0 = &d->ht[1];
+            t1 = &d->ht[0];
+        }
+
+        m0 = t0->sizemask;
+        m1 = t1->sizemask;
+
+        de = t0->table[v & m0];
+        while (de) {
+            next = de->next;
+            fn(privdata, de);
+            de = next;
+        }
+
+        // 遍历大表中所有低位与游标相同的桶
+        do {
+            de = t1->table[v & m1];
+            while (de) {
+                next = de->next;
+                fn(privdata, de);
+                de = next;
+            }
+
+            v |= ~m1;
+            v = rev(v);
+            v++;
+            v = rev(v);
+        } while (v & (m0 ^ m1));
+    }
+
+    d->iterators--;
+
+    return v;
+}
+
+/* -------------------------------- statistics ------------------------------ */
+
+// 统计一个哈希表，sampleBuckets为0或不小于表大小时统计所有桶，否则从随机位置开始统计连续的桶
+static void _dictGetStatsHt(dict *d, dictht *ht, dictHtStats *stats, unsigned long sampleBuckets) {
+    unsigned long i, start = 0, probes = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->size = ht->size;
+    stats->used = ht->used;
+    stats->tableBytes = ht->size * sizeof(dictEntry *);
+    stats->entryBytes = ht->used * _dictEntryHeaderSize(d->type);
+    if (ht->size == 0) {
+        return;
+    }
+
+    stats->sampled = ht->size;
+    if (sampleBuckets && sampleBuckets < ht->size) {
+        stats->sampled = sampleBuckets;
+        start = _dictRandom() & ht->sizemask;
+    }
+
+    for (i = 0; i < stats->sampled; i++) {
+        dictEntry *he = ht->table[(start + i) & ht->sizemask];
+        unsigned long chainlen = 0;
+
+        while (he) {
+            chainlen++;
+            he = he->next;
+        }
+        stats->clvector[chainlen < DICT_STATS_VECTLEN ? chainlen : DICT_STATS_VECTLEN - 1]++;
+        if (chainlen == 0) {
+            stats->emptyBuckets++;
+            continue;
+        }
+        if (chainlen > stats->maxChainLen) {
+            stats->maxChainLen = chainlen;
+        }
+        stats->chainedEntries += chainlen;
+        // 链表中第k个节点需要比较k次
+        probes += chainlen * (chainlen + 1) / 2;
+    }
+
+    if (stats->sampled > stats->emptyBuckets) {
+        stats->avgChainLen = (double)stats->chainedEntries / (stats->sampled - stats->emptyBuckets);
+        stats->avgProbeLen = (double)probes / stats->chainedEntries;
+    }
+}
+
+/**
+ * 获取字典的统计信息：两个哈希表的大小、节点数、空桶数、链表长度分布、
+ * 平均查找长度、内存占用，以及rehash进度
+ * 统计需要遍历桶数组和链表，对大字典可以只抽样一部分桶
+ * @param  d              字典
+ * @param  stats          输出的统计信息
+ * @param  sampleBuckets  每个表最多统计的桶数，0表示统计所有桶
+ */
+void dictGetStats(dict *d, dictStats *stats, unsigned long sampleBuckets) {
+    stats->rehashidx = d->rehashidx;
+    stats->rehashProgress = 0;
+    if (dictIsRehashing(d)) {
+        stats->rehashProgress = (double)d->rehashidx / d->ht[0].size;
+    }
+    _dictGetStatsHt(d, &d->ht[0], &stats->ht[0], sampleBuckets);
+    _dictGetStatsHt(d, &d->ht[1], &stats->ht[1], sampleBuckets);
+}
+
+/**
+ * 把统计信息格式化为可读的文本
+ * @param  buf      缓冲区，结果总是以'\0'结尾
+ * @param  bufsize  缓冲区大小
+ * @param  stats    dictGetStats获取的统计信息
+ * @return          写入的字节数，不包括结尾的'\0'
+ */
+size_t dictGetStatsMsg(char *buf, size_t bufsize, const dictStats *stats) {
+    size_t l = 0;
+    int table, i;
+
+#define STATS_APPEND(...) do { \
+    if (l < bufsize) { \
+        int n = snprintf(buf + l, bufsize - l, __VA_ARGS__); \
+        l = (n < 0) ? l : (l + n < bufsize ? l + n : bufsize - 1); \
+    } \
+} while(0)
+
+    if (bufsize == 0) {
+        return 0;
+    }
+    buf[0] = '\0';
+
+    if (stats->rehashidx != -1) {
+        STATS_APPEND("Rehashing: rehashidx %ld (%.2f%%)\n",
+            stats->rehashidx, stats->rehashProgress * 100);
+    }
+    for (table = 0; table <= 1; table++) {
+        const dictHtStats *s = &stats->ht[table];
+
+        if (s->size == 0) {
+            continue;
+        }
+        STATS_APPEND("Hash table %d stats (%s):\n"
+            " table size: %lu\n"
+            " number of elements: %lu\n"
+            " sampled buckets: %lu\n"
+            " empty buckets: %lu\n"
+            " max chain length: %lu\n"
+            " avg chain length (counted): %.02f\n"
+            " avg chain length (computed): %.02f\n"
+            " avg probe length: %.02f\n"
+            " memory: table %zu bytes, entries %zu bytes\n"
+            " Chain length distribution:\n",
+            table, table == 0 ? "main hash table" : "rehashing target",
+            s->size, s->used, s->sampled, s->emptyBuckets, s->maxChainLen,
+            s->avgChainLen, (double)s->used / s->size, s->avgProbeLen,
+            s->tableBytes, s->entryBytes);
+        for (i = 0; i < DICT_STATS_VECTLEN; i++) {
+            if (s->clvector[i] == 0) {
+                continue;
+            }
+            STATS_APPEND("   %s%d: %lu (%.02f%%)\n",
+                i == DICT_STATS_VECTLEN - 1 ? ">= " : "", i, s->clvector[i],
+                (double)s->clvector[i] * 100 / s->sampled);
+        }
+    }
+
+#undef STATS_APPEND
+    return l;
+}
+
+
 long long timeInMilliseconds(void) {
     struct timeval tv;
 
@@ -467,14 +1606,205 @@ long long timeInMilliseconds(void) {
     return (((long long)tv.tv_sec)*1000)+(tv.tv_usec/1000);
 }
 
+// 单调时钟，不受系统时间调整的影响，只用于计算时间间隔
+long long timeInNanoseconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((long long)ts.tv_sec)*1000000000 + ts.tv_nsec;
+}
+
 /* Rehash for an amount of time between ms milliseconds and ms+1 milliseconds */
 int dictRehashMilliseconds(dict *d, int ms) {
-    long long start = timeInMilliseconds();
+    long long start = timeInNanoseconds();
     int rehashes = 0;
 
     while(dictRehash(d,100)) {
         rehashes += 100;
-        if (timeInMilliseconds()-start > ms) break;
+        if (timeInNanoseconds()-start > (long long)ms*1000000) break;
     }
     return rehashes;
+}
+
+
+/* --------------------------- rehash scheduler ----------------------------- */
+
+/**
+ * 创建rehash调度器
+ * @param  budgetUs  每次tick的时间预算，单位微秒
+ * @return
+ */
+dictRehashScheduler *dictRehashSchedulerCreate(long long budgetUs) {
+    dictRehashScheduler *s = zmalloc(sizeof(*s));
+
+    s->pending = NULL;
+    s->count = 0;
+    s->capacity = 0;
+    s->attached = 0;
+    s->budgetUs = budgetUs;
+    memset(&s->stats, 0, sizeof(s->stats));
+    return s;
+}
+
+/**
+ * 释放rehash调度器
+ * 关联的字典必须已经释放或者解除关联
+ */
+void dictRehashSchedulerRelease(dictRehashScheduler *s) {
+    assert(s->attached == 0);
+    zfree(s->pending);
+    zfree(s);
+}
+
+// 字典开始rehash，登记到调度器
+static void _dictSchedulerPush(dict *d) {
+    dictRehashScheduler *s = d->scheduler;
+
+    if (s == NULL || d->schedIndex != -1) {
+        return;
+    }
+    if (s->count == s->capacity) {
+        s->capacity = s->capacity ? s->capacity * 2 : 16;
+        s->pending = zrealloc(s->pending, s->capacity * sizeof(dict *));
+    }
+    d->schedIndex = s->count;
+    s->pending[s->count++] = d;
+}
+
+// 字典rehash完成或者解除关联，从调度器移除
+// 只把位置置为NULL，不移动其他字典，tick过程中字典的顺序保持不变
+static void _dictSchedulerRemove(dict *d) {
+    if (d->schedIndex == -1) {
+        return;
+    }
+    d->scheduler->pending[d->schedIndex] = NULL;
+    d->schedIndex = -1;
+}
+
+// 去掉已经移除的字典
+static void _dictSchedulerCompact(dictRehashScheduler *s) {
+    unsigned long i, j = 0;
+
+    for (i = 0; i < s->count; i++) {
+        if (s->pending[i]) {
+            s->pending[j] = s->pending[i];
+            s->pending[j]->schedIndex = j;
+            j++;
+        }
+    }
+    s->count = j;
+}
+
+// 按ht[0]剩余节点数从多到少排序
+static int _dictSchedulerCompare(const void *a, const void *b) {
+    unsigned long ua = (*(dict * const *)a)->ht[0].used;
+    unsigned long ub = (*(dict * const *)b)->ht[0].used;
+
+    return (ua < ub) - (ua > ub);
+}
+
+// ht[0]中还没有迁移的桶数
+static unsigned long _dictPendingBuckets(dict *d) {
+    return dictIsRehashing(d) ? d->ht[0].size - d->rehashidx : 0;
+}
+
+/**
+ * 关联或解除关联rehash调度器
+ * 关联后字典每次开始rehash都会登记到调度器，正在rehash的字典立即登记
+ * @param  d  字典
+ * @param  s  调度器，NULL表示解除关联
+ */
+void dictSetRehashScheduler(dict *d, dictRehashScheduler *s) {
+    if (d->scheduler == s) {
+        return;
+    }
+    if (d->scheduler) {
+        _dictSchedulerRemove(d);
+        d->scheduler->attached--;
+    }
+    d->scheduler = s;
+    if (s) {
+        s->attached++;
+        if (dictIsRehashing(d)) {
+            _dictSchedulerPush(d);
+        }
+    }
+}
+
+/**
+ * 在时间预算内推进登记的字典的rehash，由定时任务周期性调用
+ * 剩余节点多的字典优先；每迁移DICT_REHASH_SCHED_STEP个桶检查一次时间，
+ * 有字典待rehash时至少执行一步。有安全迭代器的字典本次跳过。
+ * @param  s  调度器
+ * @return    迁移的桶数
+ */
+unsigned long dictRehashSchedulerTick(dictRehashScheduler *s) {
+    long long start = timeInNanoseconds(), now = start;
+    long long deadline = start + s->budgetUs * 1000;
+    unsigned long i, buckets = 0;
+
+    _dictSchedulerCompact(s);
+    qsort(s->pending, s->count, sizeof(dict *), _dictSchedulerCompare);
+    for (i = 0; i < s->count; i++) {
+        s->pending[i]->schedIndex = i;
+    }
+
+    for (i = 0; i < s->count; i++) {
+        dict *d = s->pending[i];
+
+        if (d->iterators) {
+            continue;
+        }
+        while (1) {
+            unsigned long before = _dictPendingBuckets(d);
+            int more = dictRehash(d, DICT_REHASH_SCHED_STEP);
+            long long t = timeInNanoseconds();
+
+            buckets += before - _dictPendingBuckets(d);
+            s->stats.steps++;
+            if (t - now > s->stats.maxStepNs) {
+                s->stats.maxStepNs = t - now;
+            }
+            now = t;
+
+            // 完成时dictRehash已经把字典从数组中移除
+            if (!more) {
+                s->stats.completed++;
+                break;
+            }
+            if (now >= deadline) {
+                break;
+            }
+        }
+        if (now >= deadline) {
+            break;
+        }
+    }
+
+    s->stats.ticks++;
+    s->stats.lastTickNs = now - start;
+    s->stats.totalNs += now - start;
+    return buckets;
+}
+
+/**
+ * 获取调度器的统计信息
+ * 待处理的字典、桶和节点数在调用时统计，其余为累计值
+ */
+void dictRehashSchedulerGetStats(dictRehashScheduler *s, dictRehashStats *stats) {
+    unsigned long i;
+
+    *stats = s->stats;
+    stats->pendingDicts = 0;
+    stats->pendingBuckets = 0;
+    stats->pendingEntries = 0;
+    for (i = 0; i < s->count; i++) {
+        dict *d = s->pending[i];
+
+        if (d) {
+            stats->pendingDicts++;
+            stats->pendingBuckets += _dictPendingBuckets(d);
+            stats->pendingEntries += d->ht[0].used;
+        }
+    }
 }
\ No newline at end of file
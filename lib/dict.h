@@ -2,6 +2,9 @@
 #define __DICT_H__
 
 #include <stdint.h>
+#include <stddef.h>
+
+#include "slab.h"
 
 
 #define DICT_OK 0
@@ -11,7 +14,11 @@
 
 
 // 哈希表节点
+// next和key必须放在开头，所有节点布局共享这一前缀，遍历链表和比较键时不需要区分布局
 typedef struct dictEntry {
+    // 指向下个哈希表节点，形成链表，以此解决键冲突（collision）的问题
+    struct dictEntry *next;
+
     // 键
     void *key;
 
@@ -22,10 +29,14 @@ typedef struct dictEntry {
         int64_t s64;
         double d;
     } v;
+} dictEntry;
 
-    // 指向下个哈希表节点，形成链表，以此解决键冲突（collision）的问题
+
+// 集合模式（dictType.noValue）的哈希表节点，没有值
+typedef struct dictEntryNoValue {
     struct dictEntry *next;
-} dictEntry;
+    void *key;
+} dictEntryNoValue;
 
 
 // 哈希表
@@ -64,6 +75,24 @@ typedef struct dictType {
 
     // 销毁值的函数
     void (*valDestructor)(void *privdata, void *obj);
+
+    // 节点从字典私有的slab池中分配，dictRelease时整体释放
+    // 内嵌键的节点大小不固定，不使用slab池
+    unsigned int pooledEntries:1;
+
+    // 集合模式，节点使用dictEntryNoValue布局，不能读写值
+    unsigned int noValue:1;
+
+    // 内嵌键：设置了这两个函数时，键被复制到节点头部之后，与节点一起分配和释放，
+    // dictGetKey返回节点内部的指针。字典不取得调用者传入的键的所有权，
+    // 也不会对内嵌的键调用keyDup和keyDestructor。
+    // keyEmbedSize返回键需要的字节数，keyEmbed把键写入buf并返回键指针。
+    size_t (*keyEmbedSize)(const void *key);
+    void *(*keyEmbed)(void *buf, const void *key);
+
+    // 可选的批量哈希函数，结果必须与hashFunction相同，
+    // dictFindMany和dictAddMany用它一次计算一组键的哈希值（见dictGenHashFunctionBatch）
+    void (*hashBatch)(const void **keys, size_t n, uint64_t *hashes);
 } dictType;
 
 
@@ -84,13 +113,31 @@ typedef struct dict {
     // 当rehash不在进行时，值为-1
     long rehashidx;
 
-    // 正在遍历该字典的迭代器个数
+    // 正在遍历该字典的安全迭代器个数（包括dictScan），不为0时暂停rehash
     unsigned long iterators; 
+
+    // 是否允许自动扩充和缩小（同时受全局开关约束）
+    int resizable;
+
+    // 节点的slab池，type->pooledEntries为0时为NULL
+    slabPool *entryPool;
+
+    // 关联的rehash调度器，没有关联时为NULL
+    struct dictRehashScheduler *scheduler;
+
+    // 在调度器待rehash数组中的下标，不在数组中时为-1
+    long schedIndex;
+
+    // 渐进式清空（dictEmptyStep）已经清空到的桶下标
+    unsigned long clearidx;
 } dict;
 
 
 // 字典迭代器
-// TODO 目前先只实现安全版本的迭代器
+// 安全迭代器在迭代期间暂停字典的rehash，可以删除当前节点；
+// 非安全迭代器不影响rehash，迭代期间只能调用不修改字典的函数（如dictFindByHash），
+// 释放时检查字典指纹，发现字典被修改则断言失败。
+// 迭代器可以在栈上分配，用dictInitIterator/dictInitSafeIterator初始化，用dictResetIterator结束
 typedef struct dictIterator {
     dict *d;
 
@@ -100,29 +147,139 @@ typedef struct dictIterator {
     // table 哈希表号
     int table;
 
-#ifdef SUPPORT_SAFE_ITER
     // safe 标记迭代器是否安全，1表示安全，0表示非安全
     int safe;
-#endif
 
     // entry表示当前迭代节点
     dictEntry *entry;
-    // nextEntry表示当前迭代节点的下一节点，非安全迭代器中，当前节点可能被修改，需要记录下一节点。
+    // nextEntry表示当前迭代节点的下一节点，安全迭代器中，当前节点可能被删除，需要记录下一节点。
     dictEntry *nextEntry;
 
-#ifdef SUPPORT_SAFE_ITER
     // 指纹是一个64位的数字
     // 表示在给定的时间内字典的状态，它只是将一些dict属性合并在一起。
     // 初始化不安全的迭代器时，我们将获得dict指纹，并在释放迭代器时再次检查指纹。
     // 如果两个指纹不同，这意味着迭代器的用户在迭代时对字典执行禁止操作。
     long long fingerprint;
-#endif
 } dictIterator;
 
 
+// dictGetStats统计的链表长度分布的项数，最后一项包括所有更长的链表
+#define DICT_STATS_VECTLEN 50
+
+
+// 一个哈希表的统计信息
+typedef struct dictHtStats {
+    // 哈希表大小和节点数量
+    unsigned long size;
+    unsigned long used;
+
+    // 实际统计的桶数，抽样时小于size，以下各项都只针对这些桶
+    unsigned long sampled;
+
+    // 空桶数量、统计到的节点数量和最长的链表
+    unsigned long emptyBuckets;
+    unsigned long chainedEntries;
+    unsigned long maxChainLen;
+
+    // 链表长度分布，clvector[i]为长度等于i的链表数量
+    unsigned long clvector[DICT_STATS_VECTLEN];
+
+    // 非空桶的平均链表长度，以及查找一个已有的键平均需要比较的节点数
+    double avgChainLen;
+    double avgProbeLen;
+
+    // 桶数组和节点占用的内存（内嵌键的节点不包括键的长度）
+    size_t tableBytes;
+    size_t entryBytes;
+} dictHtStats;
+
+
+// 字典的统计信息
+typedef struct dictStats {
+    // rehash索引和ht[0]已迁移的桶所占的比例，不在rehash时为-1和0
+    long rehashidx;
+    double rehashProgress;
+
+    dictHtStats ht[2];
+} dictStats;
+
+
+// rehash调度器的统计信息
+typedef struct dictRehashStats {
+    // 正在rehash的字典数量
+    unsigned long pendingDicts;
+
+    // ht[0]中还没有迁移的桶数和节点数
+    unsigned long long pendingBuckets;
+    unsigned long long pendingEntries;
+
+    // 执行过的tick数、rehash步数和完成rehash的字典数
+    unsigned long long ticks;
+    unsigned long long steps;
+    unsigned long long completed;
+
+    // 累计耗时、最近一次tick的耗时和单步最长耗时，单位纳秒
+    long long totalNs;
+    long long lastTickNs;
+    long long maxStepNs;
+} dictRehashStats;
+
+
+// rehash调度器
+// 关联的字典开始rehash时自动登记，rehash完成或字典释放时自动移除；
+// 每次tick在给定的时间预算内推进所有登记的字典，剩余节点多的优先
+typedef struct dictRehashScheduler {
+    // 正在rehash的字典，完成的字典先置为NULL，下次tick时压缩
+    dict **pending;
+    unsigned long count;
+    unsigned long capacity;
+
+    // 关联的字典数量，释放调度器时必须为0
+    unsigned long attached;
+
+    // 每次tick的时间预算，单位微秒
+    long long budgetUs;
+
+    dictRehashStats stats;
+} dictRehashScheduler;
+
+
+// dictScan的回调函数
+typedef void (dictScanFunction)(void *privdata, const dictEntry *de);
+
+
 // 哈希表的初始大小
 #define DICT_HT_INITIAL_SIZE     4
 
+// 填充率（百分比）低于该值时自动缩小哈希表
+#define DICT_HT_MIN_FILL 10
+
+// rehash调度器每步迁移的桶数，每步之后检查一次时间
+#define DICT_REHASH_SCHED_STEP 100
+
+// 桶数组达到该字节数时直接用mmap分配，由内核按需提供零页
+#define DICT_TABLE_MMAP_THRESHOLD (1024 * 1024)
+
+// 桶数组达到该字节数时对齐到大页并使用透明大页
+#define DICT_TABLE_HUGEPAGE_THRESHOLD (8 * 1024 * 1024)
+#define DICT_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+// dictBulkLoad的标志：调用者保证键唯一，跳过重复检查
+#define DICT_BULK_UNIQUE 1
+// dictBulkLoad的标志：按桶号分组后插入
+#define DICT_BULK_PARTITION 2
+// dictBulkLoad分组时每组包含的桶数（2的幂次），组越小插入时写桶数组越接近顺序写
+#define DICT_BULK_GROUP_BITS 10
+
+// dictFindMany和dictAddMany每组处理的键数量
+#define DICT_FIND_BATCH 16
+
+// dictGetRandomKey随机选择桶的最大次数，之后改为顺序查找非空的桶
+#define DICT_RANDOM_PROBES 100
+
+// dictGetFairRandomKey按链表长度拒绝采样时使用的最大链表长度
+#define DICT_FAIR_RANDOM_CHAIN 8
+
 /* ------------------------------- Macros ------------------------------------*/
 
 #define dictSetKey(d, entry, _key_) do { \
@@ -152,6 +309,7 @@ typedef struct dictIterator {
         (d)->type->keyCompare((d)->privdata, key1, key2) : \
         (key1) == (key2))
 
+// 集合模式（dictType.noValue）的字典不能使用读写值的宏
 #define dictGetKey(he) ((he)->key)
 #define dictGetVal(he) ((he)->v.val)
 #define dictGetSignedIntegerVal(he) ((he)->v.s64)
@@ -160,27 +318,67 @@ typedef struct dictIterator {
 #define dictSize(d) ((d)->ht[0].used+(d)->ht[1].used)
 #define dictHashKey(d, key) (d)->type->hashFunction(key)
 #define dictIsRehashing(d) ((d)->rehashidx != -1)
+#define dictSetResizable(d, enable) ((d)->resizable = (enable))
 
 
 /* ------------------------------- APIs ------------------------------------*/
 dict *dictCreate(dictType *type, void *privDataPtr);
 dictEntry *dictAddRaw(dict *d, void *key, dictEntry **existing);
 int dictAdd(dict *d, void *key, void *val);
+size_t dictAddMany(dict *d, void **keys, void **vals, size_t n, dictEntry **out);
+size_t dictBulkLoad(dict *d, void **keys, void **vals, size_t n, int flags);
 int dictDelete(dict *d, const void *key);
 void dictRelease(dict *d);
+void dictEmpty(dict *d, void(callback)(void *));
+int dictEmptyStep(dict *d, unsigned long budget);
 
 int dictExpand(dict *d, unsigned long size);
+int dictResize(dict *d);
 int dictRehash(dict *d, int n);
 
 dictEntry *dictFind(dict *d, const void *key);
+dictEntry *dictFindByHash(dict *d, const void *key, uint64_t hash);
+size_t dictFindMany(dict *d, const void **keys, size_t n, dictEntry **out);
 
 dictIterator *dictGetIterator(dict *d);
+dictIterator *dictGetSafeIterator(dict *d);
+void dictInitIterator(dictIterator *iter, dict *d);
+void dictInitSafeIterator(dictIterator *iter, dict *d);
 dictEntry *dictNext(dictIterator *iter);
+void dictResetIterator(dictIterator *iter);
 void dictReleaseIterator(dictIterator *iter);
+long long dictFingerprint(dict *d);
+
+dictEntry *dictGetRandomKey(dict *d);
+dictEntry *dictGetFairRandomKey(dict *d);
+unsigned int dictGetSomeKeys(dict *d, dictEntry **des, unsigned int count);
+
+unsigned long dictScan(dict *d, unsigned long v, dictScanFunction *fn, void *privdata);
+
+void dictGetStats(dict *d, dictStats *stats, unsigned long sampleBuckets);
+size_t dictGetStatsMsg(char *buf, size_t bufsize, const dictStats *stats);
 
 uint64_t dictGenHashFunction(const void *key, int len);
+void dictGenHashFunctionBatch(const void **keys, const size_t *lens, size_t n, uint64_t *hashes);
+uint64_t dictGenCaseHashFunction(const void *key, int len);
+uint64_t dictGenSipHash24Function(const void *key, int len);
+uint64_t dictGenFastHashFunction(const void *key, int len);
+void dictSetHashFunctionSeed(const uint8_t *seed);
+uint8_t *dictGetHashFunctionSeed(void);
+
+void dictEnableResize(void);
+void dictDisableResize(void);
+void dictSetMinFill(unsigned int percent);
+void dictSetTableHugePages(int enable);
 
 long long timeInMilliseconds(void);
+long long timeInNanoseconds(void);
 int dictRehashMilliseconds(dict *d, int ms);
 
+dictRehashScheduler *dictRehashSchedulerCreate(long long budgetUs);
+void dictRehashSchedulerRelease(dictRehashScheduler *s);
+void dictSetRehashScheduler(dict *d, dictRehashScheduler *s);
+unsigned long dictRehashSchedulerTick(dictRehashScheduler *s);
+void dictRehashSchedulerGetStats(dictRehashScheduler *s, dictRehashStats *stats);
+
 #endif
\ No newline at end of file
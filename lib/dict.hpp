@@ -0,0 +1,337 @@
+#ifndef __DICT_HPP__
+#define __DICT_HPP__
+
+#include <cstdint>
+#include <cstring>
+#include <climits>
+#include <new>
+#include <utility>
+
+extern "C" {
+#include "dict.h"
+#include "sds.h"
+#include "zmalloc.h"
+}
+
+/*
+ * 编译期特化的字典模板
+ *
+ * 与dict相同的链地址法和双表渐进式rehash，但哈希、比较、复制和销毁由Traits在编译期
+ * 绑定，查找循环中的调用可以被内联，不再经过dictType的函数指针。
+ *
+ * Traits需要提供：
+ *   static uint64_t hash(const Key &key);
+ *   static bool equal(const Key &a, const Key &b);
+ *   static Key dup(const Key &key);     插入左值键时调用，插入右值键时直接移动
+ *   static void destroy(Key &key);      节点释放前调用，之后再调用~Key()
+ *
+ * 节点使用zmalloc分配，与C的dict使用同一个分配器。
+ */
+
+// 缺省的Traits，适用于整数、指针等可以直接按字节哈希和用==比较的键
+template <typename Key>
+struct DictTraits {
+    static uint64_t hash(const Key &key) {
+        return dictGenHashFunction(&key, sizeof(key));
+    }
+    static bool equal(const Key &a, const Key &b) {
+        return a == b;
+    }
+    static Key dup(const Key &key) {
+        return key;
+    }
+    static void destroy(Key &key) {
+        DICT_NOTUSED(key);
+    }
+};
+
+// sds键的Traits，与test/dicttest.c中的回调行为一致，字典拥有键的所有权
+struct SdsDictTraits {
+    static uint64_t hash(const sds &key) {
+        return dictGenHashFunction(key, sdslen(key));
+    }
+    static bool equal(const sds &a, const sds &b) {
+        size_t l1 = sdslen(a), l2 = sdslen(b);
+        return l1 == l2 && memcmp(a, b, l1) == 0;
+    }
+    static sds dup(const sds &key) {
+        return sdsnewlen(key, sdslen(key));
+    }
+    static void destroy(sds &key) {
+        sdsfree(key);
+    }
+};
+
+
+template <typename Key, typename Val, typename Traits = DictTraits<Key> >
+class Dict {
+public:
+    // 哈希表节点
+    struct Entry {
+        Entry *next;
+        Key key;
+        Val val;
+    };
+
+    Dict() : rehashidx(-1) {
+        reset(ht[0]);
+        reset(ht[1]);
+    }
+
+    ~Dict() {
+        clear(ht[0]);
+        clear(ht[1]);
+    }
+
+    Dict(const Dict &) = delete;
+    Dict &operator=(const Dict &) = delete;
+
+    size_t size() const { return ht[0].used + ht[1].used; }
+    bool isRehashing() const { return rehashidx != -1; }
+
+    /**
+     * 添加键值对，键已存在时返回NULL
+     * 键和值按转发方式构造：右值被移动，左值键经过Traits::dup复制
+     */
+    template <typename K, typename V>
+    Entry *add(K &&key, V &&val) {
+        uint64_t h;
+        Table *t;
+        Entry *e;
+
+        if (isRehashing()) {
+            rehash(1);
+        }
+
+        h = Traits::hash(key);
+        if (lookup(key, h)) {
+            return NULL;
+        }
+        if (!expandIfNeeded()) {
+            return NULL;
+        }
+
+        t = isRehashing() ? &ht[1] : &ht[0];
+        e = static_cast<Entry *>(zmalloc(sizeof(Entry)));
+        new (&e->key) Key(makeKey(std::forward<K>(key)));
+        new (&e->val) Val(std::forward<V>(val));
+        e->next = t->table[h & t->sizemask];
+        t->table[h & t->sizemask] = e;
+        t->used++;
+        return e;
+    }
+
+    // 查找键
+    Entry *find(const Key &key) {
+        if (size() == 0) {
+            return NULL;
+        }
+        if (isRehashing()) {
+            rehash(1);
+        }
+        return lookup(key, Traits::hash(key));
+    }
+
+    // 删除键
+    bool remove(const Key &key) {
+        uint64_t h;
+        int table;
+
+        if (size() == 0) {
+            return false;
+        }
+        if (isRehashing()) {
+            rehash(1);
+        }
+
+        h = Traits::hash(key);
+        for (table = 0; table <= 1; table++) {
+            Table &t = ht[table];
+            Entry **link = &t.table[h & t.sizemask];
+
+            while (*link) {
+                Entry *e = *link;
+                if (Traits::equal(key, e->key)) {
+                    *link = e->next;
+                    release(e);
+                    t.used--;
+                    return true;
+                }
+                link = &e->next;
+            }
+            if (!isRehashing()) {
+                break;
+            }
+        }
+        return false;
+    }
+
+    // 扩充或创建哈希表
+    bool expand(unsigned long size) {
+        Table n;
+        unsigned long realsize;
+
+        if (isRehashing() || ht[0].used > size) {
+            return false;
+        }
+
+        realsize = nextPower(size);
+        if (realsize == ht[0].size) {
+            return false;
+        }
+
+        n.size = realsize;
+        n.sizemask = realsize - 1;
+        n.table = static_cast<Entry **>(zmalloc(realsize * sizeof(Entry *)));
+        memset(n.table, 0, realsize * sizeof(Entry *));
+        n.used = 0;
+
+        if (ht[0].table == NULL) {
+            ht[0] = n;
+            return true;
+        }
+        ht[1] = n;
+        rehashidx = 0;
+        return true;
+    }
+
+    /**
+     * rehash操作，与dictRehash相同
+     * @return  1表示还需要继续rehash，0表示已完成
+     */
+    int rehash(int n) {
+        int empty_visits = n * 10;
+
+        if (!isRehashing()) {
+            return 0;
+        }
+
+        while (n-- && ht[0].used != 0) {
+            Entry *e, *next;
+
+            while (ht[0].table[rehashidx] == NULL) {
+                rehashidx++;
+                if (--empty_visits == 0) {
+                    return 1;
+                }
+            }
+            e = ht[0].table[rehashidx];
+            while (e) {
+                uint64_t idx = Traits::hash(e->key) & ht[1].sizemask;
+
+                next = e->next;
+                e->next = ht[1].table[idx];
+                ht[1].table[idx] = e;
+                ht[0].used--;
+                ht[1].used++;
+                e = next;
+            }
+            ht[0].table[rehashidx] = NULL;
+            rehashidx++;
+        }
+
+        if (ht[0].used == 0) {
+            zfree(ht[0].table);
+            ht[0] = ht[1];
+            reset(ht[1]);
+            rehashidx = -1;
+            return 0;
+        }
+        return 1;
+    }
+
+private:
+    struct Table {
+        Entry **table;
+        unsigned long size;
+        unsigned long sizemask;
+        unsigned long used;
+    };
+
+    Table ht[2];
+    long rehashidx;
+
+    static void reset(Table &t) {
+        t.table = NULL;
+        t.size = 0;
+        t.sizemask = 0;
+        t.used = 0;
+    }
+
+    static Key makeKey(const Key &key) { return Traits::dup(key); }
+    static Key makeKey(Key &key) { return Traits::dup(key); }
+    static Key makeKey(Key &&key) { return std::move(key); }
+
+    static void release(Entry *e) {
+        Traits::destroy(e->key);
+        e->key.~Key();
+        e->val.~Val();
+        zfree(e);
+    }
+
+    static unsigned long nextPower(unsigned long size) {
+        unsigned long i = DICT_HT_INITIAL_SIZE;
+
+        if (size >= LONG_MAX) {
+            return LONG_MAX + 1LU;
+        }
+        while (i < size) {
+            i *= 2;
+        }
+        return i;
+    }
+
+    bool expandIfNeeded() {
+        if (isRehashing()) {
+            return true;
+        }
+        if (ht[0].size == 0) {
+            return expand(DICT_HT_INITIAL_SIZE);
+        }
+        if (ht[0].used >= ht[0].size) {
+            return expand(ht[0].size * 2);
+        }
+        return true;
+    }
+
+    Entry *lookup(const Key &key, uint64_t h) {
+        int table;
+
+        for (table = 0; table <= 1; table++) {
+            Entry *e;
+
+            if (ht[table].size == 0) {
+                break;
+            }
+            e = ht[table].table[h & ht[table].sizemask];
+            while (e) {
+                if (Traits::equal(key, e->key)) {
+                    return e;
+                }
+                e = e->next;
+            }
+            if (!isRehashing()) {
+                break;
+            }
+        }
+        return NULL;
+    }
+
+    static void clear(Table &t) {
+        unsigned long i;
+
+        for (i = 0; i < t.size && t.used > 0; i++) {
+            Entry *e = t.table[i], *next;
+            while (e) {
+                next = e->next;
+                release(e);
+                t.used--;
+                e = next;
+            }
+        }
+        zfree(t.table);
+        reset(t);
+    }
+};
+
+#endif
@@ -1,8 +1,39 @@
+#include <string.h>
+
 #include "hash.h"
 
 #define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
 
-#define U8TO64_LE(p) (*((uint64_t*)(p)))
+// 按小端读取，使用memcpy避免非对齐访问（sds的内容通常不是8字节对齐的）
+static inline uint64_t U8TO64_LE(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static inline uint32_t U8TO32_LE(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+// ASCII小写转换，不受locale影响
+static inline uint8_t siptlw(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static inline uint64_t U8TO64_LE_NOCASE(const uint8_t *p) {
+    return (uint64_t)siptlw(p[0]) | ((uint64_t)siptlw(p[1]) << 8) |
+           ((uint64_t)siptlw(p[2]) << 16) | ((uint64_t)siptlw(p[3]) << 24) |
+           ((uint64_t)siptlw(p[4]) << 32) | ((uint64_t)siptlw(p[5]) << 40) |
+           ((uint64_t)siptlw(p[6]) << 48) | ((uint64_t)siptlw(p[7]) << 56);
+}
 
 #define SIPROUND                                                               \
     do {                                                                       \
@@ -23,7 +54,22 @@
     } while (0)
 
 
-uint64_t siphash(const uint8_t *in, const size_t inlen, const uint8_t *k) {
+/* -------------------------------- SipHash --------------------------------- */
+
+/**
+ * SipHash-c-d的通用实现
+ * crounds、drounds和nocase在每个调用点都是常量，强制内联后循环会被完全展开
+ * @param  in       输入
+ * @param  inlen    输入长度
+ * @param  k        16字节的密钥
+ * @param  crounds  每个消息块的压缩轮数
+ * @param  drounds  结束轮数
+ * @param  nocase   非0时按ASCII小写处理输入
+ * @return          64位哈希值
+ */
+static inline __attribute__((always_inline))
+uint64_t _siphash(const uint8_t *in, const size_t inlen, const uint8_t *k,
+                  const int crounds, const int drounds, const int nocase) {
     uint64_t v0 = 0x736f6d6570736575ULL;
     uint64_t v1 = 0x646f72616e646f6dULL;
     uint64_t v2 = 0x6c7967656e657261ULL;
@@ -34,42 +80,605 @@ uint64_t siphash(const uint8_t *in, const size_t inlen, const uint8_t *k) {
     const uint8_t *end = in + inlen - (inlen % sizeof(uint64_t));
     const int left = inlen & 7;
     uint64_t b = ((uint64_t)inlen) << 56;
+    int i;
     v3 ^= k1;
     v2 ^= k0;
     v1 ^= k1;
     v0 ^= k0;
 
     for (; in != end; in += 8) {
-        m = U8TO64_LE(in);
+        m = nocase ? U8TO64_LE_NOCASE(in) : U8TO64_LE(in);
         v3 ^= m;
 
-        SIPROUND;
+        for (i = 0; i < crounds; i++) {
+            SIPROUND;
+        }
 
         v0 ^= m;
     }
 
+#define SIPBYTE(n) ((uint64_t)(nocase ? siptlw(in[n]) : in[n]))
     switch (left) {
-    case 7: b |= ((uint64_t)in[6]) << 48; /* fall-thru */
-    case 6: b |= ((uint64_t)in[5]) << 40; /* fall-thru */
-    case 5: b |= ((uint64_t)in[4]) << 32; /* fall-thru */
-    case 4: b |= ((uint64_t)in[3]) << 24; /* fall-thru */
-    case 3: b |= ((uint64_t)in[2]) << 16; /* fall-thru */
-    case 2: b |= ((uint64_t)in[1]) << 8; /* fall-thru */
-    case 1: b |= ((uint64_t)in[0]); break;
+    case 7: b |= SIPBYTE(6) << 48; /* fall-thru */
+    case 6: b |= SIPBYTE(5) << 40; /* fall-thru */
+    case 5: b |= SIPBYTE(4) << 32; /* fall-thru */
+    case 4: b |= SIPBYTE(3) << 24; /* fall-thru */
+    case 3: b |= SIPBYTE(2) << 16; /* fall-thru */
+    case 2: b |= SIPBYTE(1) << 8; /* fall-thru */
+    case 1: b |= SIPBYTE(0); break;
     case 0: break;
     }
+#undef SIPBYTE
 
     v3 ^= b;
 
-    SIPROUND;
+    for (i = 0; i < crounds; i++) {
+        SIPROUND;
+    }
 
     v0 ^= b;
     v2 ^= 0xff;
 
-    SIPROUND;
-    SIPROUND;
+    for (i = 0; i < drounds; i++) {
+        SIPROUND;
+    }
 
     b = v0 ^ v1 ^ v2 ^ v3;
 
     return b;
-}
\ No newline at end of file
+}
+
+
+// SipHash-1-2，字典的默认哈希函数
+uint64_t siphash(const uint8_t *in, const size_t inlen, const uint8_t *k) {
+    return _siphash(in, inlen, k, 1, 2, 0);
+}
+
+// 大小写不敏感的SipHash-1-2，结果等于对ASCII小写后的输入调用siphash
+uint64_t siphash_nocase(const uint8_t *in, const size_t inlen, const uint8_t *k) {
+    return _siphash(in, inlen, k, 1, 2, 1);
+}
+
+// 标准强度的SipHash-2-4，输出与参考实现一致
+uint64_t siphash24(const uint8_t *in, const size_t inlen, const uint8_t *k) {
+    return _siphash(in, inlen, k, 2, 4, 0);
+}
+
+
+/* ------------------------- multi-buffer SipHash --------------------------- */
+
+/*
+ * 同时计算多个独立键的SipHash-1-2，每个键占用一个64位的SIMD通道。
+ * 各通道依次消化自己的消息字，最后一个字是带长度的尾块，与普通消息块的压缩过程相同；
+ * 键长度不同时，已经处理完的通道用掩码保持状态不变。结束轮对所有通道统一执行。
+ * 指令集在第一次调用时根据CPU选择：AVX-512F（8路）、AVX2（4路）或逐个调用siphash。
+ */
+
+// 尾块：剩余不足8字节的数据加上最高字节的长度
+static inline uint64_t _siphashTail(const uint8_t *in, size_t inlen) {
+    uint64_t b = ((uint64_t)inlen) << 56;
+    const uint8_t *p = in + (inlen & ~(size_t)7);
+
+    switch (inlen & 7) {
+    case 7: b |= ((uint64_t)p[6]) << 48; /* fall-thru */
+    case 6: b |= ((uint64_t)p[5]) << 40; /* fall-thru */
+    case 5: b |= ((uint64_t)p[4]) << 32; /* fall-thru */
+    case 4: b |= ((uint64_t)p[3]) << 24; /* fall-thru */
+    case 3: b |= ((uint64_t)p[2]) << 16; /* fall-thru */
+    case 2: b |= ((uint64_t)p[1]) << 8; /* fall-thru */
+    case 1: b |= ((uint64_t)p[0]); break;
+    case 0: break;
+    }
+    return b;
+}
+
+// 第i个消息字，i等于块数时为尾块
+static inline uint64_t _siphashWord(const uint8_t *in, size_t inlen, size_t i) {
+    return i < inlen / 8 ? U8TO64_LE(in + 8 * i) : _siphashTail(in, inlen);
+}
+
+static void _siphashX4Scalar(const uint8_t *const in[4], const size_t inlen[4],
+                             const uint8_t *k, uint64_t out[4]) {
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        out[i] = siphash(in[i], inlen[i], k);
+    }
+}
+
+static void _siphashX8Scalar(const uint8_t *const in[8], const size_t inlen[8],
+                             const uint8_t *k, uint64_t out[8]) {
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        out[i] = siphash(in[i], inlen[i], k);
+    }
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+
+#define SIPHASH_X86_DISPATCH 1
+
+#define ROTL256(x, b) _mm256_or_si256(_mm256_slli_epi64((x), (b)), _mm256_srli_epi64((x), 64 - (b)))
+// 循环移位32位即交换高低两个32位
+#define ROTL256_32(x) _mm256_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+
+#define SIPROUND256                                                            \
+    do {                                                                       \
+        v0 = _mm256_add_epi64(v0, v1);                                         \
+        v1 = ROTL256(v1, 13);                                                  \
+        v1 = _mm256_xor_si256(v1, v0);                                         \
+        v0 = ROTL256_32(v0);                                                   \
+        v2 = _mm256_add_epi64(v2, v3);                                         \
+        v3 = ROTL256(v3, 16);                                                  \
+        v3 = _mm256_xor_si256(v3, v2);                                         \
+        v0 = _mm256_add_epi64(v0, v3);                                         \
+        v3 = ROTL256(v3, 21);                                                  \
+        v3 = _mm256_xor_si256(v3, v0);                                         \
+        v2 = _mm256_add_epi64(v2, v1);                                         \
+        v1 = ROTL256(v1, 17);                                                  \
+        v1 = _mm256_xor_si256(v1, v2);                                         \
+        v2 = ROTL256_32(v2);                                                   \
+    } while (0)
+
+__attribute__((target("avx2")))
+static void _siphashX4Avx2(const uint8_t *const in[4], const size_t inlen[4],
+                           const uint8_t *k, uint64_t out[4]) {
+    uint64_t k0 = U8TO64_LE(k), k1 = U8TO64_LE(k + 8);
+    __m256i v0 = _mm256_set1_epi64x(0x736f6d6570736575ULL ^ k0);
+    __m256i v1 = _mm256_set1_epi64x(0x646f72616e646f6dULL ^ k1);
+    __m256i v2 = _mm256_set1_epi64x(0x6c7967656e657261ULL ^ k0);
+    __m256i v3 = _mm256_set1_epi64x(0x7465646279746573ULL ^ k1);
+    __m256i offsets;
+    size_t minBlocks = inlen[0] / 8, maxWords = 0, i;
+    int l;
+
+    for (l = 0; l < 4; l++) {
+        if (inlen[l] / 8 < minBlocks) minBlocks = inlen[l] / 8;
+        if (inlen[l] / 8 + 1 > maxWords) maxWords = inlen[l] / 8 + 1;
+    }
+
+    // 所有通道都是完整消息块的部分，以in[0]为基址用gather一次读取四个通道
+    offsets = _mm256_set_epi64x(in[3] - in[0], in[2] - in[0], in[1] - in[0], 0);
+    for (i = 0; i < minBlocks; i++) {
+        __m256i m = _mm256_i64gather_epi64((const long long *)(in[0] + 8 * i), offsets, 1);
+        v3 = _mm256_xor_si256(v3, m);
+        SIPROUND256;
+        v0 = _mm256_xor_si256(v0, m);
+    }
+
+    // 尾块以及较长的键剩余的部分，已结束的通道保持原状态
+    for (; i < maxWords; i++) {
+        __m256i o0 = v0, o1 = v1, o2 = v2, o3 = v3, m, mask;
+        uint64_t w[4], a[4];
+        int all = 1;
+
+        for (l = 0; l < 4; l++) {
+            int active = i <= inlen[l] / 8;
+            a[l] = active ? ~0ULL : 0;
+            w[l] = active ? _siphashWord(in[l], inlen[l], i) : 0;
+            all &= active;
+        }
+        m = _mm256_loadu_si256((const __m256i *)w);
+        v3 = _mm256_xor_si256(v3, m);
+        SIPROUND256;
+        v0 = _mm256_xor_si256(v0, m);
+        if (!all) {
+            mask = _mm256_loadu_si256((const __m256i *)a);
+            v0 = _mm256_blendv_epi8(o0, v0, mask);
+            v1 = _mm256_blendv_epi8(o1, v1, mask);
+            v2 = _mm256_blendv_epi8(o2, v2, mask);
+            v3 = _mm256_blendv_epi8(o3, v3, mask);
+        }
+    }
+
+    v2 = _mm256_xor_si256(v2, _mm256_set1_epi64x(0xff));
+    SIPROUND256;
+    SIPROUND256;
+
+    v0 = _mm256_xor_si256(_mm256_xor_si256(v0, v1), _mm256_xor_si256(v2, v3));
+    _mm256_storeu_si256((__m256i *)out, v0);
+}
+
+static void _siphashX8Avx2(const uint8_t *const in[8], const size_t inlen[8],
+                           const uint8_t *k, uint64_t out[8]) {
+    _siphashX4Avx2(in, inlen, k, out);
+    _siphashX4Avx2(in + 4, inlen + 4, k, out + 4);
+}
+
+#define SIPROUND512                                                            \
+    do {                                                                       \
+        v0 = _mm512_add_epi64(v0, v1);                                         \
+        v1 = _mm512_rol_epi64(v1, 13);                                         \
+        v1 = _mm512_xor_si512(v1, v0);                                         \
+        v0 = _mm512_rol_epi64(v0, 32);                                         \
+        v2 = _mm512_add_epi64(v2, v3);                                         \
+        v3 = _mm512_rol_epi64(v3, 16);                                         \
+        v3 = _mm512_xor_si512(v3, v2);                                         \
+        v0 = _mm512_add_epi64(v0, v3);                                         \
+        v3 = _mm512_rol_epi64(v3, 21);                                         \
+        v3 = _mm512_xor_si512(v3, v0);                                         \
+        v2 = _mm512_add_epi64(v2, v1);                                         \
+        v1 = _mm512_rol_epi64(v1, 17);                                         \
+        v1 = _mm512_xor_si512(v1, v2);                                         \
+        v2 = _mm512_rol_epi64(v2, 32);                                         \
+    } while (0)
+
+__attribute__((target("avx512f")))
+static void _siphashX8Avx512(const uint8_t *const in[8], const size_t inlen[8],
+                             const uint8_t *k, uint64_t out[8]) {
+    uint64_t k0 = U8TO64_LE(k), k1 = U8TO64_LE(k + 8);
+    __m512i v0 = _mm512_set1_epi64(0x736f6d6570736575ULL ^ k0);
+    __m512i v1 = _mm512_set1_epi64(0x646f72616e646f6dULL ^ k1);
+    __m512i v2 = _mm512_set1_epi64(0x6c7967656e657261ULL ^ k0);
+    __m512i v3 = _mm512_set1_epi64(0x7465646279746573ULL ^ k1);
+    __m512i offsets;
+    size_t minBlocks = inlen[0] / 8, maxWords = 0, i;
+    int l;
+
+    for (l = 0; l < 8; l++) {
+        if (inlen[l] / 8 < minBlocks) minBlocks = inlen[l] / 8;
+        if (inlen[l] / 8 + 1 > maxWords) maxWords = inlen[l] / 8 + 1;
+    }
+
+    offsets = _mm512_set_epi64(in[7] - in[0], in[6] - in[0], in[5] - in[0], in[4] - in[0],
+                               in[3] - in[0], in[2] - in[0], in[1] - in[0], 0);
+    for (i = 0; i < minBlocks; i++) {
+        __m512i m = _mm512_i64gather_epi64(offsets, in[0] + 8 * i, 1);
+        v3 = _mm512_xor_si512(v3, m);
+        SIPROUND512;
+        v0 = _mm512_xor_si512(v0, m);
+    }
+
+    for (; i < maxWords; i++) {
+        __m512i o0 = v0, o1 = v1, o2 = v2, o3 = v3, m;
+        __mmask8 mask = 0;
+        uint64_t w[8];
+
+        for (l = 0; l < 8; l++) {
+            if (i <= inlen[l] / 8) {
+                mask |= 1 << l;
+                w[l] = _siphashWord(in[l], inlen[l], i);
+            } else {
+                w[l] = 0;
+            }
+        }
+        m = _mm512_loadu_si512(w);
+        v3 = _mm512_xor_si512(v3, m);
+        SIPROUND512;
+        v0 = _mm512_xor_si512(v0, m);
+        if (mask != 0xff) {
+            v0 = _mm512_mask_mov_epi64(o0, mask, v0);
+            v1 = _mm512_mask_mov_epi64(o1, mask, v1);
+            v2 = _mm512_mask_mov_epi64(o2, mask, v2);
+            v3 = _mm512_mask_mov_epi64(o3, mask, v3);
+        }
+    }
+
+    v2 = _mm512_xor_si512(v2, _mm512_set1_epi64(0xff));
+    SIPROUND512;
+    SIPROUND512;
+
+    v0 = _mm512_xor_si512(_mm512_xor_si512(v0, v1), _mm512_xor_si512(v2, v3));
+    _mm512_storeu_si512(out, v0);
+}
+
+#endif
+
+static void (*siphash_x4_impl)(const uint8_t *const in[4], const size_t inlen[4],
+                               const uint8_t *k, uint64_t out[4]);
+static void (*siphash_x8_impl)(const uint8_t *const in[8], const size_t inlen[8],
+                               const uint8_t *k, uint64_t out[8]);
+
+// 根据CPU选择实现
+static void _siphashSelectImpl(void) {
+    siphash_x4_impl = _siphashX4Scalar;
+    siphash_x8_impl = _siphashX8Scalar;
+#ifdef SIPHASH_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        siphash_x4_impl = _siphashX4Avx2;
+        siphash_x8_impl = _siphashX8Avx2;
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        siphash_x8_impl = _siphashX8Avx512;
+    }
+#endif
+}
+
+/**
+ * 同时计算4个键的SipHash-1-2，out[i]与siphash(in[i], inlen[i], k)相同
+ * @param  in     4个输入
+ * @param  inlen  4个输入的长度
+ * @param  k      16字节的密钥
+ * @param  out    4个哈希值
+ * @return void
+ */
+void siphash_x4(const uint8_t *const in[4], const size_t inlen[4], const uint8_t *k, uint64_t out[4]) {
+    if (!siphash_x4_impl) {
+        _siphashSelectImpl();
+    }
+    siphash_x4_impl(in, inlen, k, out);
+}
+
+// 同时计算8个键的SipHash-1-2
+void siphash_x8(const uint8_t *const in[8], const size_t inlen[8], const uint8_t *k, uint64_t out[8]) {
+    if (!siphash_x8_impl) {
+        _siphashSelectImpl();
+    }
+    siphash_x8_impl(in, inlen, k, out);
+}
+
+// 当前使用的多路实现，用于测试和基准输出
+const char *siphash_multi_impl(void) {
+    if (!siphash_x8_impl) {
+        _siphashSelectImpl();
+    }
+#ifdef SIPHASH_X86_DISPATCH
+    if (siphash_x8_impl == _siphashX8Avx512) return "avx512f";
+    if (siphash_x8_impl == _siphashX8Avx2) return "avx2";
+#endif
+    return "scalar";
+}
+
+/**
+ * 为测试强制使用标量实现，force为0时恢复按CPU选择
+ */
+void siphash_multi_force_scalar(int force) {
+    _siphashSelectImpl();
+    if (force) {
+        siphash_x4_impl = _siphashX4Scalar;
+        siphash_x8_impl = _siphashX8Scalar;
+    }
+}
+
+
+/* ------------------------------- XXH3-64 ---------------------------------- */
+
+/*
+ * XXH3的64位版本（xxHash 0.8），非加密哈希，输出与参考实现的XXH3_64bits_withSeed一致。
+ * 不能抵抗哈希洪水攻击，只应用于键不受外部控制的字典。
+ */
+
+#define XXH_PRIME32_1 0x9E3779B1U
+#define XXH_PRIME32_2 0x85EBCA77U
+#define XXH_PRIME32_3 0xC2B2AE3DU
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+#define XXH_PRIME_MX1 0x165667919E3779F9ULL
+#define XXH_PRIME_MX2 0x9FB21C651E98DF25ULL
+
+#define XXH_SECRET_SIZE 192
+#define XXH_STRIPE_LEN 64
+#define XXH_SECRET_CONSUME_RATE 8
+#define XXH_ACC_NB 8
+
+// 默认密钥
+static const uint8_t xxh3_kSecret[XXH_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+// 64x64->128位乘法，高低两半异或折叠
+static inline uint64_t _xxh3Mul128Fold64(uint64_t lhs, uint64_t rhs) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t product = (__uint128_t)lhs * rhs;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+#else
+    uint64_t lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+    uint64_t hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+    uint64_t lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+    uint64_t hi_hi = (lhs >> 32) * (rhs >> 32);
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+    return lower ^ upper;
+#endif
+}
+
+static inline uint64_t _xxh64Avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t _xxh3Avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= XXH_PRIME_MX1;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t _xxh3Rrmxmx(uint64_t h, uint64_t len) {
+    h ^= ROTL(h, 49) ^ ROTL(h, 24);
+    h *= XXH_PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= XXH_PRIME_MX2;
+    return h ^ (h >> 28);
+}
+
+static inline uint64_t _xxh3Mix16B(const uint8_t *in, const uint8_t *secret, uint64_t seed) {
+    uint64_t lo = U8TO64_LE(in);
+    uint64_t hi = U8TO64_LE(in + 8);
+    return _xxh3Mul128Fold64(lo ^ (U8TO64_LE(secret) + seed),
+                             hi ^ (U8TO64_LE(secret + 8) - seed));
+}
+
+// 0到16字节
+static uint64_t _xxh3Len0to16(const uint8_t *in, size_t len, const uint8_t *secret, uint64_t seed) {
+    if (len > 8) {
+        uint64_t bitflip1 = (U8TO64_LE(secret + 24) ^ U8TO64_LE(secret + 32)) + seed;
+        uint64_t bitflip2 = (U8TO64_LE(secret + 40) ^ U8TO64_LE(secret + 48)) - seed;
+        uint64_t lo = U8TO64_LE(in) ^ bitflip1;
+        uint64_t hi = U8TO64_LE(in + len - 8) ^ bitflip2;
+        uint64_t acc = len + __builtin_bswap64(lo) + hi + _xxh3Mul128Fold64(lo, hi);
+        return _xxh3Avalanche(acc);
+    }
+    if (len >= 4) {
+        uint64_t bitflip, input64;
+        uint32_t in1 = U8TO32_LE(in);
+        uint32_t in2 = U8TO32_LE(in + len - 4);
+
+        seed ^= (uint64_t)__builtin_bswap32((uint32_t)seed) << 32;
+        bitflip = (U8TO64_LE(secret + 8) ^ U8TO64_LE(secret + 16)) - seed;
+        input64 = in2 + ((uint64_t)in1 << 32);
+        return _xxh3Rrmxmx(input64 ^ bitflip, len);
+    }
+    if (len > 0) {
+        uint32_t combined = ((uint32_t)in[0] << 16) | ((uint32_t)in[len >> 1] << 24) |
+                            ((uint32_t)in[len - 1]) | ((uint32_t)len << 8);
+        uint64_t bitflip = (U8TO32_LE(secret) ^ U8TO32_LE(secret + 4)) + seed;
+        return _xxh64Avalanche((uint64_t)combined ^ bitflip);
+    }
+    return _xxh64Avalanche(seed ^ (U8TO64_LE(secret + 56) ^ U8TO64_LE(secret + 64)));
+}
+
+// 17到128字节
+static uint64_t _xxh3Len17to128(const uint8_t *in, size_t len, const uint8_t *secret, uint64_t seed) {
+    uint64_t acc = len * XXH_PRIME64_1;
+
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) {
+                acc += _xxh3Mix16B(in + 48, secret + 96, seed);
+                acc += _xxh3Mix16B(in + len - 64, secret + 112, seed);
+            }
+            acc += _xxh3Mix16B(in + 32, secret + 64, seed);
+            acc += _xxh3Mix16B(in + len - 48, secret + 80, seed);
+        }
+        acc += _xxh3Mix16B(in + 16, secret + 32, seed);
+        acc += _xxh3Mix16B(in + len - 32, secret + 48, seed);
+    }
+    acc += _xxh3Mix16B(in, secret, seed);
+    acc += _xxh3Mix16B(in + len - 16, secret + 16, seed);
+    return _xxh3Avalanche(acc);
+}
+
+// 129到240字节
+static uint64_t _xxh3Len129to240(const uint8_t *in, size_t len, const uint8_t *secret, uint64_t seed) {
+    uint64_t acc = len * XXH_PRIME64_1, accEnd;
+    unsigned int rounds = (unsigned int)len / 16, i;
+
+    for (i = 0; i < 8; i++) {
+        acc += _xxh3Mix16B(in + 16 * i, secret + 16 * i, seed);
+    }
+    // 136为最小密钥长度，17为最后16字节使用的密钥偏移
+    accEnd = _xxh3Mix16B(in + len - 16, secret + 136 - 17, seed);
+    acc = _xxh3Avalanche(acc);
+    for (i = 8; i < rounds; i++) {
+        accEnd += _xxh3Mix16B(in + 16 * i, secret + 16 * (i - 8) + 3, seed);
+    }
+    return _xxh3Avalanche(acc + accEnd);
+}
+
+static inline void _xxh3Accumulate512(uint64_t *acc, const uint8_t *in, const uint8_t *secret) {
+    int i;
+
+    for (i = 0; i < XXH_ACC_NB; i++) {
+        uint64_t data = U8TO64_LE(in + 8 * i);
+        uint64_t key = data ^ U8TO64_LE(secret + 8 * i);
+        acc[i ^ 1] += data;
+        acc[i] += (uint64_t)(uint32_t)key * (key >> 32);
+    }
+}
+
+static inline void _xxh3ScrambleAcc(uint64_t *acc, const uint8_t *secret) {
+    int i;
+
+    for (i = 0; i < XXH_ACC_NB; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= U8TO64_LE(secret + 8 * i);
+        a *= XXH_PRIME32_1;
+        acc[i] = a;
+    }
+}
+
+// 超过240字节，按1KB的块累加
+static uint64_t _xxh3HashLong(const uint8_t *in, size_t len, uint64_t seed) {
+    uint64_t acc[XXH_ACC_NB] = {
+        XXH_PRIME32_3, XXH_PRIME64_1, XXH_PRIME64_2, XXH_PRIME64_3,
+        XXH_PRIME64_4, XXH_PRIME32_2, XXH_PRIME64_5, XXH_PRIME32_1
+    };
+    uint8_t secret[XXH_SECRET_SIZE];
+    const size_t stripesPerBlock = (XXH_SECRET_SIZE - XXH_STRIPE_LEN) / XXH_SECRET_CONSUME_RATE;
+    const size_t blockLen = XXH_STRIPE_LEN * stripesPerBlock;
+    size_t blocks = (len - 1) / blockLen, stripes, n, s;
+    uint64_t result;
+    int i;
+
+    // 带种子时由默认密钥派生出自定义密钥
+    for (i = 0; i < XXH_SECRET_SIZE / 16; i++) {
+        uint64_t lo = U8TO64_LE(xxh3_kSecret + 16 * i) + seed;
+        uint64_t hi = U8TO64_LE(xxh3_kSecret + 16 * i + 8) - seed;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        lo = __builtin_bswap64(lo);
+        hi = __builtin_bswap64(hi);
+#endif
+        memcpy(secret + 16 * i, &lo, 8);
+        memcpy(secret + 16 * i + 8, &hi, 8);
+    }
+
+    for (n = 0; n < blocks; n++) {
+        for (s = 0; s < stripesPerBlock; s++) {
+            _xxh3Accumulate512(acc, in + n * blockLen + s * XXH_STRIPE_LEN,
+                               secret + s * XXH_SECRET_CONSUME_RATE);
+        }
+        _xxh3ScrambleAcc(acc, secret + XXH_SECRET_SIZE - XXH_STRIPE_LEN);
+    }
+
+    stripes = ((len - 1) - blockLen * blocks) / XXH_STRIPE_LEN;
+    for (s = 0; s < stripes; s++) {
+        _xxh3Accumulate512(acc, in + blocks * blockLen + s * XXH_STRIPE_LEN,
+                           secret + s * XXH_SECRET_CONSUME_RATE);
+    }
+    // 最后一个条带总是以输入末尾对齐
+    _xxh3Accumulate512(acc, in + len - XXH_STRIPE_LEN,
+                       secret + XXH_SECRET_SIZE - XXH_STRIPE_LEN - 7);
+
+    // 合并累加器
+    result = len * XXH_PRIME64_1;
+    for (i = 0; i < 4; i++) {
+        result += _xxh3Mul128Fold64(acc[2 * i] ^ U8TO64_LE(secret + 11 + 16 * i),
+                                    acc[2 * i + 1] ^ U8TO64_LE(secret + 11 + 16 * i + 8));
+    }
+    return _xxh3Avalanche(result);
+}
+
+
+/**
+ * 带种子的XXH3-64
+ * @param  in     输入
+ * @param  inlen  输入长度
+ * @param  seed   64位种子
+ * @return        64位哈希值
+ */
+uint64_t xxh3_64(const uint8_t *in, const size_t inlen, uint64_t seed) {
+    if (inlen <= 16) {
+        return _xxh3Len0to16(in, inlen, xxh3_kSecret, seed);
+    }
+    if (inlen <= 128) {
+        return _xxh3Len17to128(in, inlen, xxh3_kSecret, seed);
+    }
+    if (inlen <= 240) {
+        return _xxh3Len129to240(in, inlen, xxh3_kSecret, seed);
+    }
+    return _xxh3HashLong(in, inlen, seed);
+}
@@ -4,6 +4,26 @@
 #include <stdint.h>
 #include <stddef.h>
 
+/*
+ * 哈希函数
+ *
+ * siphash          SipHash-1-2，k为16字节密钥，抗哈希洪水，字典的默认选择
+ * siphash_nocase   大小写不敏感（ASCII）的SipHash-1-2
+ * siphash24        标准强度的SipHash-2-4，约为siphash一半的速度
+ * xxh3_64          非加密的XXH3-64，最快，但不能用于键受外部控制的字典
+ *
+ * siphash_x4/x8    同时计算4/8个键的siphash，结果与逐个调用完全相同，
+ *                  运行时选择AVX-512F、AVX2或标量实现
+ */
+
 uint64_t siphash(const uint8_t *in, const size_t inlen, const uint8_t *k);
+uint64_t siphash_nocase(const uint8_t *in, const size_t inlen, const uint8_t *k);
+uint64_t siphash24(const uint8_t *in, const size_t inlen, const uint8_t *k);
+uint64_t xxh3_64(const uint8_t *in, const size_t inlen, uint64_t seed);
+
+void siphash_x4(const uint8_t *const in[4], const size_t inlen[4], const uint8_t *k, uint64_t out[4]);
+void siphash_x8(const uint8_t *const in[8], const size_t inlen[8], const uint8_t *k, uint64_t out[8]);
+const char *siphash_multi_impl(void);
+void siphash_multi_force_scalar(int force);
 
-#endif
\ No newline at end of file
+#endif
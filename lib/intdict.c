@@ -0,0 +1,341 @@
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "intdict.h"
+#include "zmalloc.h"
+
+
+/* -------------------------- hash functions -------------------------------- */
+
+/**
+ * 64位整数的混合函数（MurmurHash3的fmix64）
+ * 输入的每一位都会影响输出的低位，连续的id也能均匀分布到各个桶
+ */
+uint64_t intdictHashKey(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+/* ----------------------------- API implementation ------------------------- */
+
+// 重置哈希表
+static void _intdictReset(intdictht *ht) {
+    ht->table = NULL;
+    ht->size = 0;
+    ht->sizemask = 0;
+    ht->used = 0;
+}
+
+
+/**
+ * 创建一个新的整数键字典
+ * @param  valDestructor  销毁值的函数，可以为NULL
+ * @return
+ */
+intdict *intdictCreate(void (*valDestructor)(void *val)) {
+    intdict *d = zmalloc(sizeof(*d));
+
+    _intdictReset(&d->ht[0]);
+    _intdictReset(&d->ht[1]);
+    d->valDestructor = valDestructor;
+    d->rehashidx = -1;
+    return d;
+}
+
+
+/**
+ * rehash操作
+ * @param  d  字典
+ * @param  n  最多迁移的桶数
+ * @return    1表示还需要继续rehash，0表示已完成
+ */
+int intdictRehash(intdict *d, int n) {
+    int empty_visits = n * 10;
+
+    if (!intdictIsRehashing(d)) {
+        return 0;
+    }
+
+    while (n-- && d->ht[0].used != 0) {
+        intdictEntry *de, *nextde;
+
+        assert(d->ht[0].size > (unsigned long)d->rehashidx);
+        while (d->ht[0].table[d->rehashidx] == NULL) {
+            d->rehashidx++;
+            if (--empty_visits == 0) {
+                return 1;
+            }
+        }
+        de = d->ht[0].table[d->rehashidx];
+        while (de) {
+            uint64_t h;
+
+            nextde = de->next;
+            h = intdictHashKey(de->key) & d->ht[1].sizemask;
+            de->next = d->ht[1].table[h];
+            d->ht[1].table[h] = de;
+            d->ht[0].used--;
+            d->ht[1].used++;
+            de = nextde;
+        }
+        d->ht[0].table[d->rehashidx] = NULL;
+        d->rehashidx++;
+    }
+
+    if (d->ht[0].used == 0) {
+        zfree(d->ht[0].table);
+        d->ht[0] = d->ht[1];
+        _intdictReset(&d->ht[1]);
+        d->rehashidx = -1;
+        return 0;
+    }
+
+    return 1;
+}
+
+
+// 扩充后的哈希表大小
+static unsigned long _intdictNextPower(unsigned long size) {
+    unsigned long i = DICT_HT_INITIAL_SIZE;
+
+    if (size >= LONG_MAX) {
+        return LONG_MAX + 1LU;
+    }
+
+    while (i < size) {
+        i *= 2;
+    }
+    return i;
+}
+
+
+// 扩充或创建哈希表
+int intdictExpand(intdict *d, unsigned long size) {
+    intdictht n;
+    unsigned long realsize;
+
+    if (intdictIsRehashing(d) || d->ht[0].used > size) {
+        return DICT_ERR;
+    }
+
+    realsize = _intdictNextPower(size);
+    if (realsize == d->ht[0].size) {
+        return DICT_ERR;
+    }
+
+    n.size = realsize;
+    n.sizemask = realsize - 1;
+    n.table = zmalloc(realsize * sizeof(intdictEntry *));
+    memset(n.table, 0, realsize * sizeof(intdictEntry *));
+    n.used = 0;
+
+    if (d->ht[0].table == NULL) {
+        d->ht[0] = n;
+        return DICT_OK;
+    }
+
+    d->ht[1] = n;
+    d->rehashidx = 0;
+    return DICT_OK;
+}
+
+
+// 如果需要，则扩充哈希表
+static int _intdictExpandIfNeeded(intdict *d) {
+    if (intdictIsRehashing(d)) {
+        return DICT_OK;
+    }
+
+    if (d->ht[0].size == 0) {
+        return intdictExpand(d, DICT_HT_INITIAL_SIZE);
+    }
+
+    if (d->ht[0].used >= d->ht[0].size) {
+        return intdictExpand(d, d->ht[0].size * 2);
+    }
+    return DICT_OK;
+}
+
+
+// 在两个哈希表中查找键
+static intdictEntry *_intdictLookup(intdict *d, uint64_t key, uint64_t hash) {
+    int table;
+
+    for (table = 0; table <= 1; table++) {
+        intdictEntry *he;
+
+        if (d->ht[table].size == 0) {
+            break;
+        }
+        he = d->ht[table].table[hash & d->ht[table].sizemask];
+        while (he) {
+            if (he->key == key) {
+                return he;
+            }
+            he = he->next;
+        }
+        if (!intdictIsRehashing(d)) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+
+// 添加值
+intdictEntry *intdictAddRaw(intdict *d, uint64_t key, intdictEntry **existing) {
+    intdictEntry *entry;
+    intdictht *ht;
+    uint64_t hash = intdictHashKey(key);
+
+    if (intdictIsRehashing(d)) {
+        intdictRehash(d, 1);
+    }
+
+    if ((entry = _intdictLookup(d, key, hash)) != NULL) {
+        if (existing) {
+            *existing = entry;
+        }
+        return NULL;
+    }
+
+    if (_intdictExpandIfNeeded(d) == DICT_ERR) {
+        return NULL;
+    }
+
+    ht = intdictIsRehashing(d) ? &d->ht[1] : &d->ht[0];
+    entry = zmalloc(sizeof(*entry));
+    entry->key = key;
+    entry->next = ht->table[hash & ht->sizemask];
+    ht->table[hash & ht->sizemask] = entry;
+    ht->used++;
+    return entry;
+}
+
+
+/**
+ * 将给定的键值对添加到字典
+ * @param  d    字典
+ * @param  key  键
+ * @param  val  值
+ * @return
+ */
+int intdictAdd(intdict *d, uint64_t key, void *val) {
+    intdictEntry *entry = intdictAddRaw(d, key, NULL);
+    if (!entry) {
+        return DICT_ERR;
+    }
+
+    entry->v.val = val;
+    return DICT_OK;
+}
+
+
+/**
+ * 将给定的键值从字典中删除
+ * @param  d    字典
+ * @param  key  键
+ * @return
+ */
+int intdictDelete(intdict *d, uint64_t key) {
+    uint64_t hash, idx;
+    intdictEntry *he, *prevHe;
+    int table;
+
+    if (intdictSize(d) == 0) {
+        return DICT_ERR;
+    }
+
+    if (intdictIsRehashing(d)) {
+        intdictRehash(d, 1);
+    }
+
+    hash = intdictHashKey(key);
+    for (table = 0; table <= 1; table++) {
+        idx = hash & d->ht[table].sizemask;
+        he = d->ht[table].table[idx];
+        prevHe = NULL;
+
+        while (he) {
+            if (he->key == key) {
+                if (prevHe) {
+                    prevHe->next = he->next;
+                } else {
+                    d->ht[table].table[idx] = he->next;
+                }
+                if (d->valDestructor) {
+                    d->valDestructor(he->v.val);
+                }
+                zfree(he);
+                d->ht[table].used--;
+                return DICT_OK;
+            }
+            prevHe = he;
+            he = he->next;
+        }
+        if (!intdictIsRehashing(d)) {
+            break;
+        }
+    }
+    return DICT_ERR;
+}
+
+
+// 清空字典的哈希表
+static void _intdictClear(intdict *d, intdictht *ht) {
+    unsigned long i;
+
+    for (i = 0; i < ht->size && ht->used > 0; i++) {
+        intdictEntry *he = ht->table[i], *nextHe;
+
+        while (he) {
+            nextHe = he->next;
+            if (d->valDestructor) {
+                d->valDestructor(he->v.val);
+            }
+            zfree(he);
+            ht->used--;
+            he = nextHe;
+        }
+    }
+
+    zfree(ht->table);
+    _intdictReset(ht);
+}
+
+
+/**
+ * 释放字典，以及字典中包含的所有键值对
+ * @param  d  字典指针
+ * @return void
+ */
+void intdictRelease(intdict *d) {
+    _intdictClear(d, &d->ht[0]);
+    _intdictClear(d, &d->ht[1]);
+    zfree(d);
+}
+
+
+/**
+ * 查找键
+ * @param  d   字典指针
+ * @param  key 键
+ * @return     节点
+ */
+intdictEntry *intdictFind(intdict *d, uint64_t key) {
+    if (intdictSize(d) == 0) {
+        return NULL;
+    }
+
+    if (intdictIsRehashing(d)) {
+        intdictRehash(d, 1);
+    }
+
+    return _intdictLookup(d, key, intdictHashKey(key));
+}
@@ -0,0 +1,77 @@
+#ifndef __INTDICT_H__
+#define __INTDICT_H__
+
+#include <stdint.h>
+
+#include "dict.h"
+
+/*
+ * 64位整数键的字典
+ *
+ * 结构与dict相同（链地址法、双表渐进式rehash），但键直接以值的形式保存在节点中，
+ * 哈希函数和键比较都是内联的，不经过dictType的函数指针，也没有键的复制和销毁。
+ * 适合id到指针这类内部索引。
+ */
+
+// 哈希表节点
+typedef struct intdictEntry {
+    // 指向下个哈希表节点
+    struct intdictEntry *next;
+
+    // 键
+    uint64_t key;
+
+    // 值
+    union {
+        void *val;
+        uint64_t u64;
+        int64_t s64;
+        double d;
+    } v;
+} intdictEntry;
+
+
+// 哈希表
+typedef struct intdictht {
+    intdictEntry **table;
+    unsigned long size;
+    unsigned long sizemask;
+    unsigned long used;
+} intdictht;
+
+
+// 字典
+typedef struct intdict {
+    // 销毁值的函数，可以为NULL
+    void (*valDestructor)(void *val);
+
+    // 哈希表，rehash时新节点只写入ht[1]
+    intdictht ht[2];
+
+    // rehash索引
+    // 当rehash不在进行时，值为-1
+    long rehashidx;
+} intdict;
+
+
+/* ------------------------------- Macros ------------------------------------*/
+
+#define intdictSize(d) ((d)->ht[0].used+(d)->ht[1].used)
+#define intdictIsRehashing(d) ((d)->rehashidx != -1)
+
+
+/* ------------------------------- APIs ------------------------------------*/
+intdict *intdictCreate(void (*valDestructor)(void *val));
+intdictEntry *intdictAddRaw(intdict *d, uint64_t key, intdictEntry **existing);
+int intdictAdd(intdict *d, uint64_t key, void *val);
+int intdictDelete(intdict *d, uint64_t key);
+void intdictRelease(intdict *d);
+
+int intdictExpand(intdict *d, unsigned long size);
+int intdictRehash(intdict *d, int n);
+
+intdictEntry *intdictFind(intdict *d, uint64_t key);
+
+uint64_t intdictHashKey(uint64_t key);
+
+#endif
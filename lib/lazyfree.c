@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "lazyfree.h"
+#include "zmalloc.h"
+
+
+// 后台释放任务
+typedef struct lazyfreeJob {
+    struct lazyfreeJob *next;
+
+    // 释放函数和对象
+    void (*freefn)(void *);
+    void *ptr;
+} lazyfreeJob;
+
+
+// 任务队列，先进先出
+static lazyfreeJob *lazyfree_head = NULL;
+static lazyfreeJob *lazyfree_tail = NULL;
+
+// 已提交但还没有完成的任务数量，包括正在执行的任务
+static unsigned long lazyfree_pending = 0;
+
+// 已经由后台线程释放的对象数量
+static unsigned long long lazyfree_freed = 0;
+
+static pthread_mutex_t lazyfree_mutex = PTHREAD_MUTEX_INITIALIZER;
+// 有新任务时通知后台线程
+static pthread_cond_t lazyfree_newjob = PTHREAD_COND_INITIALIZER;
+// 任务全部完成时通知lazyfreeWait
+static pthread_cond_t lazyfree_done = PTHREAD_COND_INITIALIZER;
+
+static pthread_once_t lazyfree_once = PTHREAD_ONCE_INIT;
+
+
+// 后台线程：依次取出任务并执行
+static void *_lazyfreeThread(void *arg) {
+    DICT_NOTUSED(arg);
+
+    pthread_mutex_lock(&lazyfree_mutex);
+    while (1) {
+        lazyfreeJob *job;
+
+        while (lazyfree_head == NULL) {
+            pthread_cond_wait(&lazyfree_newjob, &lazyfree_mutex);
+        }
+        job = lazyfree_head;
+        lazyfree_head = job->next;
+        if (lazyfree_head == NULL) {
+            lazyfree_tail = NULL;
+        }
+
+        // 释放期间不持有锁，调用者可以继续提交任务
+        pthread_mutex_unlock(&lazyfree_mutex);
+        job->freefn(job->ptr);
+        zfree(job);
+        pthread_mutex_lock(&lazyfree_mutex);
+
+        lazyfree_freed++;
+        if (--lazyfree_pending == 0) {
+            pthread_cond_broadcast(&lazyfree_done);
+        }
+    }
+    return NULL;
+}
+
+// 启动后台线程
+static void _lazyfreeStart(void) {
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attr, _lazyfreeThread, NULL) != 0) {
+        // 没有后台线程时任务会一直留在队列里，直接终止比悄悄泄漏更容易发现问题
+        abort();
+    }
+    pthread_attr_destroy(&attr);
+}
+
+
+/**
+ * 提交一个后台释放任务
+ * @param  freefn  释放函数，在后台线程中调用
+ * @param  ptr     要释放的对象
+ */
+void lazyfreeGeneric(void (*freefn)(void *), void *ptr) {
+    lazyfreeJob *job = zmalloc(sizeof(*job));
+
+    job->next = NULL;
+    job->freefn = freefn;
+    job->ptr = ptr;
+
+    pthread_once(&lazyfree_once, _lazyfreeStart);
+    pthread_mutex_lock(&lazyfree_mutex);
+    if (lazyfree_tail) {
+        lazyfree_tail->next = job;
+    } else {
+        lazyfree_head = job;
+    }
+    lazyfree_tail = job;
+    lazyfree_pending++;
+    pthread_cond_signal(&lazyfree_newjob);
+    pthread_mutex_unlock(&lazyfree_mutex);
+}
+
+
+// 分块清空字典后释放
+static void _lazyfreeDict(void *ptr) {
+    dict *d = ptr;
+
+    while (dictEmptyStep(d, LAZYFREE_DICT_STEP));
+    dictRelease(d);
+}
+
+/**
+ * 在后台释放字典
+ * 字典与rehash调度器的关联在调用者线程中解除
+ * @param  d  字典，调用后不能再访问
+ */
+void lazyfreeDict(dict *d) {
+    if (dictSize(d) < LAZYFREE_THRESHOLD) {
+        dictRelease(d);
+        return;
+    }
+    dictSetRehashScheduler(d, NULL);
+    lazyfreeGeneric(_lazyfreeDict, d);
+}
+
+
+static void _lazyfreeList(void *ptr) {
+    listRelease(ptr);
+}
+
+/**
+ * 在后台释放链表
+ * @param  l  链表，调用后不能再访问
+ */
+void lazyfreeList(list *l) {
+    if (listLength(l) < LAZYFREE_THRESHOLD) {
+        listRelease(l);
+        return;
+    }
+    lazyfreeGeneric(_lazyfreeList, l);
+}
+
+
+static void _lazyfreeSds(void *ptr) {
+    sdsfree(ptr);
+}
+
+/**
+ * 在后台释放sds字符串，用于很大的字符串（释放时可能需要munmap）
+ * @param  s  字符串，调用后不能再访问
+ */
+void lazyfreeSds(sds s) {
+    if (s == NULL) {
+        return;
+    }
+    lazyfreeGeneric(_lazyfreeSds, s);
+}
+
+
+// 已提交但还没有完成的任务数量
+unsigned long lazyfreePendingJobs(void) {
+    unsigned long pending;
+
+    pthread_mutex_lock(&lazyfree_mutex);
+    pending = lazyfree_pending;
+    pthread_mutex_unlock(&lazyfree_mutex);
+    return pending;
+}
+
+// 后台线程已经释放的对象数量
+unsigned long long lazyfreeFreedObjects(void) {
+    unsigned long long freed;
+
+    pthread_mutex_lock(&lazyfree_mutex);
+    freed = lazyfree_freed;
+    pthread_mutex_unlock(&lazyfree_mutex);
+    return freed;
+}
+
+// 等待已经提交的任务全部完成
+void lazyfreeWait(void) {
+    pthread_mutex_lock(&lazyfree_mutex);
+    while (lazyfree_pending) {
+        pthread_cond_wait(&lazyfree_done, &lazyfree_mutex);
+    }
+    pthread_mutex_unlock(&lazyfree_mutex);
+}
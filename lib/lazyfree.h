@@ -0,0 +1,38 @@
+#ifndef __LAZYFREE_H__
+#define __LAZYFREE_H__
+
+#include "dict.h"
+#include "dlist.h"
+#include "sds.h"
+
+/*
+ * 后台释放（lazy free）
+ *
+ * 释放包含大量元素的字典或链表需要逐个释放节点，耗时与元素数量成正比。
+ * 调用者把已经摘下的对象交给后台线程，立即返回，由后台线程负责释放：
+ *   - 交出之后调用者不能再访问该对象，对象中的键、值的销毁函数在后台线程中执行
+ *   - 元素少于LAZYFREE_THRESHOLD的对象直接在调用者线程中释放，避免线程间传递的开销
+ *   - 后台线程在第一次提交任务时启动，常驻直到进程退出
+ *   - 字典按LAZYFREE_DICT_STEP的工作量分块清空（见dictEmptyStep）
+ *
+ * 只想在单线程中分散释放开销的调用者可以直接使用dictEmptyStep。
+ */
+
+// 元素少于该数量时同步释放
+#define LAZYFREE_THRESHOLD 64
+
+// 后台线程每块清空字典的工作量
+#define LAZYFREE_DICT_STEP 4096
+
+
+/* ------------------------------- APIs ------------------------------------*/
+void lazyfreeDict(dict *d);
+void lazyfreeList(list *l);
+void lazyfreeSds(sds s);
+void lazyfreeGeneric(void (*freefn)(void *), void *ptr);
+
+unsigned long lazyfreePendingJobs(void);
+unsigned long long lazyfreeFreedObjects(void);
+void lazyfreeWait(void);
+
+#endif
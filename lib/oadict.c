@@ -0,0 +1,513 @@
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "oadict.h"
+#include "zmalloc.h"
+
+
+// 每次增删查操作顺带迁移的节点数
+// 取2可以保证ht[0]迁移完之前ht[1]不会被写满
+#define OADICT_REHASH_STEP 2
+
+#define H1(hash) ((hash) >> 7)
+#define H2(hash) ((int8_t)((hash) & 0x7f))
+
+
+/* -------------------------- group operations ------------------------------ */
+
+/*
+ * 每个函数对一组控制字节做比较，返回的位图中每个命中的槽位对应一个置位，
+ * 槽位下标为 ctz(mask) >> OADICT_MASK_SHIFT。
+ * SIMD版本每个槽位占1位，SWAR版本每个槽位占1字节（取最高位）。
+ */
+#if defined(__AVX2__)
+
+#define OADICT_MASK_SHIFT 0
+
+static inline uint64_t groupMatch(const int8_t *ctrl, int8_t h2) {
+    __m256i g = _mm256_loadu_si256((const __m256i *)ctrl);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(g, _mm256_set1_epi8(h2)));
+}
+
+static inline uint64_t groupMatchEmpty(const int8_t *ctrl) {
+    return groupMatch(ctrl, OADICT_CTRL_EMPTY);
+}
+
+static inline uint64_t groupMatchEmptyOrDeleted(const int8_t *ctrl) {
+    __m256i g = _mm256_loadu_si256((const __m256i *)ctrl);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(-1), g));
+}
+
+#elif defined(__SSE2__)
+
+#define OADICT_MASK_SHIFT 0
+
+static inline uint64_t groupMatch(const int8_t *ctrl, int8_t h2) {
+    __m128i g = _mm_loadu_si128((const __m128i *)ctrl);
+    return (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(h2)));
+}
+
+static inline uint64_t groupMatchEmpty(const int8_t *ctrl) {
+    return groupMatch(ctrl, OADICT_CTRL_EMPTY);
+}
+
+static inline uint64_t groupMatchEmptyOrDeleted(const int8_t *ctrl) {
+    __m128i g = _mm_loadu_si128((const __m128i *)ctrl);
+    return (uint16_t)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), g));
+}
+
+#else
+
+#define OADICT_MASK_SHIFT 3
+
+#define LSBS 0x0101010101010101ULL
+#define MSBS 0x8080808080808080ULL
+
+static inline uint64_t groupLoad(const int8_t *ctrl) {
+    uint64_t g;
+    memcpy(&g, ctrl, sizeof(g));
+    return g;
+}
+
+// 可能有假阳性，但调用者总会再比较键，不影响正确性
+static inline uint64_t groupMatch(const int8_t *ctrl, int8_t h2) {
+    uint64_t x = groupLoad(ctrl) ^ (LSBS * (uint8_t)h2);
+    return (x - LSBS) & ~x & MSBS;
+}
+
+// EMPTY为0x80，DELETED为0xFE，二者只有第1位不同
+static inline uint64_t groupMatchEmpty(const int8_t *ctrl) {
+    uint64_t g = groupLoad(ctrl);
+    return g & (~g << 6) & MSBS;
+}
+
+static inline uint64_t groupMatchEmptyOrDeleted(const int8_t *ctrl) {
+    uint64_t g = groupLoad(ctrl);
+    return g & (~g << 7) & MSBS;
+}
+
+#endif
+
+#define MASK_FIRST(mask) (__builtin_ctzll(mask) >> OADICT_MASK_SHIFT)
+#define MASK_LEADING(mask) \
+    ((__builtin_clzll(mask) - (64 - (OADICT_GROUP_WIDTH << OADICT_MASK_SHIFT))) >> OADICT_MASK_SHIFT)
+
+
+/* ----------------------------- API implementation ------------------------- */
+
+// 重置哈希表
+static void _oadictReset(oadictht *ht) {
+    ht->ctrl = NULL;
+    ht->slots = NULL;
+    ht->size = 0;
+    ht->sizemask = 0;
+    ht->used = 0;
+    ht->growthLeft = 0;
+}
+
+
+// 设置控制字节，同时更新表尾的镜像
+static inline void _oadictSetCtrl(oadictht *ht, unsigned long i, int8_t c) {
+    ht->ctrl[i] = c;
+    ht->ctrl[((i - OADICT_GROUP_WIDTH) & ht->sizemask) + OADICT_GROUP_WIDTH] = c;
+}
+
+
+// 按组做三角探测，找到第一个空槽或墓碑
+static unsigned long _oadictFindFree(oadictht *ht, uint64_t hash) {
+    unsigned long pos = H1(hash) & ht->sizemask;
+    unsigned long step = 0;
+
+    while (1) {
+        uint64_t mask = groupMatchEmptyOrDeleted(ht->ctrl + pos);
+        if (mask) {
+            return (pos + MASK_FIRST(mask)) & ht->sizemask;
+        }
+        step += OADICT_GROUP_WIDTH;
+        pos = (pos + step) & ht->sizemask;
+    }
+}
+
+
+// 在哈希表中查找键，没找到返回-1
+static long _oadictLookup(oadict *d, oadictht *ht, const void *key, uint64_t hash) {
+    unsigned long pos = H1(hash) & ht->sizemask;
+    unsigned long step = 0;
+    int8_t h2 = H2(hash);
+
+    if (ht->size == 0) {
+        return -1;
+    }
+
+    while (step <= ht->size) {
+        const int8_t *g = ht->ctrl + pos;
+        uint64_t mask = groupMatch(g, h2);
+
+        while (mask) {
+            unsigned long idx = (pos + MASK_FIRST(mask)) & ht->sizemask;
+            oadictEntry *he = &ht->slots[idx];
+            if (key == he->key || dictCompareKeys(d, key, he->key)) {
+                return idx;
+            }
+            mask &= mask - 1;
+        }
+        // 组内有空槽，说明探测序列到此为止
+        if (groupMatchEmpty(g)) {
+            return -1;
+        }
+        step += OADICT_GROUP_WIDTH;
+        pos = (pos + step) & ht->sizemask;
+    }
+    return -1;
+}
+
+
+// 把节点放到新表，不检查重复
+static oadictEntry *_oadictInsert(oadictht *ht, uint64_t hash) {
+    unsigned long idx;
+
+    assert(ht->growthLeft > 0);
+    idx = _oadictFindFree(ht, hash);
+    if (ht->ctrl[idx] == OADICT_CTRL_EMPTY) {
+        ht->growthLeft--;
+    }
+    _oadictSetCtrl(ht, idx, H2(hash));
+    ht->used++;
+    return &ht->slots[idx];
+}
+
+
+// 初始化字典
+static int _oadictInit(oadict *d, dictType *type, void *privDataPtr) {
+    _oadictReset(&d->ht[0]);
+    _oadictReset(&d->ht[1]);
+    d->type = type;
+    d->privdata = privDataPtr;
+    d->rehashidx = -1;
+    return DICT_OK;
+}
+
+
+/**
+ * 创建一个新的开放寻址字典
+ * @param  type         类型特定函数
+ * @param  privDataPtr  私有数据
+ * @return
+ */
+oadict *oadictCreate(dictType *type, void *privDataPtr) {
+    oadict *d = zmalloc(sizeof(*d));
+    _oadictInit(d, type, privDataPtr);
+    return d;
+}
+
+
+/**
+ * rehash操作
+ * @param  d  字典
+ * @param  n  最多迁移的节点数
+ * @return    1表示还需要继续rehash，0表示已完成
+ */
+int oadictRehash(oadict *d, int n) {
+    int empty_visits = n * 10;
+    oadictht *from = &d->ht[0];
+
+    if (!oadictIsRehashing(d)) {
+        return 0;
+    }
+
+    while (n-- && from->used != 0) {
+        oadictEntry *src, *dst;
+        uint64_t h;
+
+        assert(from->size > (unsigned long)d->rehashidx);
+        while (from->ctrl[d->rehashidx] < 0) {
+            d->rehashidx++;
+            if (--empty_visits == 0) {
+                return 1;
+            }
+        }
+        src = &from->slots[d->rehashidx];
+        h = dictHashKey(d, src->key);
+        dst = _oadictInsert(&d->ht[1], h);
+        *dst = *src;
+
+        // 旧表中留下墓碑，保证旧表中其它键的探测序列不被截断
+        _oadictSetCtrl(from, d->rehashidx, OADICT_CTRL_DELETED);
+        from->used--;
+        d->rehashidx++;
+    }
+
+    if (from->used == 0) {
+        zfree(from->ctrl);
+        zfree(from->slots);
+        d->ht[0] = d->ht[1];
+        _oadictReset(&d->ht[1]);
+        d->rehashidx = -1;
+        return 0;
+    }
+
+    return 1;
+}
+
+
+static void _oadictRehashStep(oadict *d) {
+    oadictRehash(d, OADICT_REHASH_STEP);
+}
+
+
+// 能容纳size个节点的哈希表大小
+static unsigned long _oadictNextPower(unsigned long size) {
+    unsigned long i = OADICT_GROUP_WIDTH;
+
+    if (size >= LONG_MAX / 8 * 7) {
+        return LONG_MAX + 1LU;
+    }
+
+    // 可以写入的槽位数（见_oadictResize中的growthLeft）要放得下size个节点
+    while (i - i / 8 < size) {
+        i *= 2;
+    }
+    return i;
+}
+
+
+// 创建指定大小的哈希表，realsize允许与当前大小相同（用于清理墓碑）
+static void _oadictResize(oadict *d, unsigned long realsize) {
+    oadictht n;
+
+    n.size = realsize;
+    n.sizemask = realsize - 1;
+    n.ctrl = zmalloc(realsize + OADICT_GROUP_WIDTH);
+    memset(n.ctrl, OADICT_CTRL_EMPTY, realsize + OADICT_GROUP_WIDTH);
+    n.slots = zmalloc(realsize * sizeof(oadictEntry));
+    n.used = 0;
+    n.growthLeft = realsize - realsize / 8;
+
+    if (d->ht[0].ctrl == NULL) {
+        d->ht[0] = n;
+        return;
+    }
+
+    d->ht[1] = n;
+    d->rehashidx = 0;
+}
+
+
+// 扩充或创建哈希表
+int oadictExpand(oadict *d, unsigned long size) {
+    unsigned long realsize;
+
+    if (oadictIsRehashing(d) || d->ht[0].used > size) {
+        return DICT_ERR;
+    }
+
+    realsize = _oadictNextPower(size);
+    if (realsize == d->ht[0].size) {
+        return DICT_ERR;
+    }
+
+    _oadictResize(d, realsize);
+    return DICT_OK;
+}
+
+
+// 如果需要，则重新调整哈希表大小
+static void _oadictExpandIfNeeded(oadict *d) {
+    oadictht *ht = &d->ht[0];
+
+    if (oadictIsRehashing(d)) {
+        // 新表的剩余空间要留给旧表中还没有迁移的节点，
+        // 放不下这些节点和这次插入的节点时先一次性完成rehash，此时新表正好放得下
+        if (d->ht[1].growthLeft > d->ht[0].used) {
+            return;
+        }
+        while (oadictRehash(d, 100));
+    }
+
+    if (ht->size == 0) {
+        _oadictResize(d, OADICT_GROUP_WIDTH);
+        return;
+    }
+
+    if (ht->growthLeft > 0) {
+        return;
+    }
+
+    // 空间主要被墓碑占用时原地重建，否则扩大一倍
+    if (ht->used * 16 > ht->size * 7) {
+        _oadictResize(d, ht->size * 2);
+    } else {
+        _oadictResize(d, ht->size);
+    }
+}
+
+
+// 添加值
+oadictEntry *oadictAddRaw(oadict *d, void *key, oadictEntry **existing) {
+    oadictEntry *entry;
+    uint64_t hash;
+    int table;
+
+    if (oadictIsRehashing(d)) {
+        _oadictRehashStep(d);
+    }
+
+    hash = dictHashKey(d, key);
+    for (table = 0; table <= 1; table++) {
+        long idx = _oadictLookup(d, &d->ht[table], key, hash);
+        if (idx != -1) {
+            if (existing) {
+                *existing = &d->ht[table].slots[idx];
+            }
+            return NULL;
+        }
+        if (!oadictIsRehashing(d)) {
+            break;
+        }
+    }
+
+    _oadictExpandIfNeeded(d);
+    entry = _oadictInsert(oadictIsRehashing(d) ? &d->ht[1] : &d->ht[0], hash);
+    dictSetKey(d, entry, key);
+    return entry;
+}
+
+
+/**
+ * 将给定的键值对添加到字典
+ * @param  d    字典
+ * @param  key  键
+ * @param  val  值
+ * @return
+ */
+int oadictAdd(oadict *d, void *key, void *val) {
+    oadictEntry *entry = oadictAddRaw(d, key, NULL);
+    if (!entry) {
+        return DICT_ERR;
+    }
+
+    dictSetVal(d, entry, val);
+    return DICT_OK;
+}
+
+
+// 删除槽位，所在位置从未连续占满一组时可以直接置空，否则留下墓碑
+static void _oadictEraseSlot(oadictht *ht, unsigned long idx) {
+    unsigned long before = (idx - OADICT_GROUP_WIDTH) & ht->sizemask;
+    uint64_t empty_before = groupMatchEmpty(ht->ctrl + before);
+    uint64_t empty_after = groupMatchEmpty(ht->ctrl + idx);
+
+    if (empty_before && empty_after &&
+        MASK_LEADING(empty_before) + MASK_FIRST(empty_after) < OADICT_GROUP_WIDTH) {
+        _oadictSetCtrl(ht, idx, OADICT_CTRL_EMPTY);
+        ht->growthLeft++;
+    } else {
+        _oadictSetCtrl(ht, idx, OADICT_CTRL_DELETED);
+    }
+    ht->used--;
+}
+
+
+/**
+ * 将给定的键值从字典中删除
+ * @param  d    字典
+ * @param  key  键
+ * @return
+ */
+int oadictDelete(oadict *d, const void *key) {
+    uint64_t hash;
+    int table;
+
+    if (oadictSize(d) == 0) {
+        return DICT_ERR;
+    }
+
+    if (oadictIsRehashing(d)) {
+        _oadictRehashStep(d);
+    }
+
+    hash = dictHashKey(d, key);
+    for (table = 0; table <= 1; table++) {
+        oadictht *ht = &d->ht[table];
+        long idx = _oadictLookup(d, ht, key, hash);
+        if (idx != -1) {
+            dictFreeKey(d, &ht->slots[idx]);
+            dictFreeVal(d, &ht->slots[idx]);
+            _oadictEraseSlot(ht, idx);
+            return DICT_OK;
+        }
+        if (!oadictIsRehashing(d)) {
+            break;
+        }
+    }
+    return DICT_ERR;
+}
+
+
+// 清空字典的哈希表
+static void _oadictClear(oadict *d, oadictht *ht) {
+    unsigned long i;
+
+    for (i = 0; i < ht->size && ht->used > 0; i++) {
+        if (ht->ctrl[i] < 0) {
+            continue;
+        }
+        dictFreeKey(d, &ht->slots[i]);
+        dictFreeVal(d, &ht->slots[i]);
+        ht->used--;
+    }
+
+    zfree(ht->ctrl);
+    zfree(ht->slots);
+    _oadictReset(ht);
+}
+
+
+/**
+ * 释放字典，以及字典中包含的所有键值对
+ * @param  d  字典指针
+ * @return void
+ */
+void oadictRelease(oadict *d) {
+    _oadictClear(d, &d->ht[0]);
+    _oadictClear(d, &d->ht[1]);
+    zfree(d);
+}
+
+
+/**
+ * 查找键
+ * @param  d   字典指针
+ * @param  key 键
+ * @return     节点，指向槽位数组内部，在下一次写操作或rehash后失效
+ */
+oadictEntry *oadictFind(oadict *d, const void *key) {
+    uint64_t hash;
+    int table;
+
+    if (oadictSize(d) == 0) {
+        return NULL;
+    }
+
+    if (oadictIsRehashing(d)) {
+        _oadictRehashStep(d);
+    }
+
+    hash = dictHashKey(d, key);
+    for (table = 0; table <= 1; table++) {
+        long idx = _oadictLookup(d, &d->ht[table], key, hash);
+        if (idx != -1) {
+            return &d->ht[table].slots[idx];
+        }
+        if (!oadictIsRehashing(d)) {
+            break;
+        }
+    }
+    return NULL;
+}
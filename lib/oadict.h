@@ -0,0 +1,110 @@
+#ifndef __OADICT_H__
+#define __OADICT_H__
+
+#include <stdint.h>
+
+#include "dict.h"
+
+/*
+ * 开放寻址（Swiss table风格）字典
+ *
+ * 与dict使用同一个dictType回调、同样的DICT_OK/DICT_ERR返回值，以及同样的
+ * 双表渐进式rehash。区别在于节点直接存放在槽位数组中，不再单独分配，
+ * 每个槽位另有一个控制字节：
+ *   - 空槽     OADICT_CTRL_EMPTY
+ *   - 已删除   OADICT_CTRL_DELETED（墓碑，探测时不能在此终止）
+ *   - 已占用   哈希值的低7位（h2）
+ * 查找时一次比较一组（SSE2为16个，AVX2为32个）控制字节，只有h2相同的槽位
+ * 才需要真正比较键，绝大多数查找只访问一次控制字节和一次槽位。
+ *
+ * dictGetKey/dictGetVal/dictSetKey/dictSetVal等宏同样适用于oadict。
+ * dictType中的pooledEntries、noValue和内嵌键选项只对dict有效。
+ */
+
+#if defined(__AVX2__)
+#define OADICT_GROUP_WIDTH 32
+#elif defined(__SSE2__)
+#define OADICT_GROUP_WIDTH 16
+#else
+#define OADICT_GROUP_WIDTH 8
+#endif
+
+#define OADICT_CTRL_EMPTY   ((int8_t)-128)
+#define OADICT_CTRL_DELETED ((int8_t)-2)
+
+
+// 开放寻址哈希表节点，没有next指针
+typedef struct oadictEntry {
+    // 键
+    void *key;
+
+    // 值
+    union {
+        void *val;
+        uint64_t u64;
+        int64_t s64;
+        double d;
+    } v;
+} oadictEntry;
+
+
+// 开放寻址哈希表
+typedef struct oadictht {
+    // 控制字节数组，长度为size+OADICT_GROUP_WIDTH，
+    // 末尾的OADICT_GROUP_WIDTH个字节是开头的镜像，使跨越表尾的组可以一次读取
+    int8_t *ctrl;
+
+    // 槽位数组
+    oadictEntry *slots;
+
+    // 哈希表大小，总是2的幂且不小于OADICT_GROUP_WIDTH
+    unsigned long size;
+
+    // 哈希表大小掩码，总是等于size-1
+    unsigned long sizemask;
+
+    // 该哈希表已有节点的数量
+    unsigned long used;
+
+    // 在需要扩容前还能占用的空槽数量（最大负载因子7/8）
+    unsigned long growthLeft;
+} oadictht;
+
+
+// 开放寻址字典
+typedef struct oadict {
+    // 类型特定函数
+    dictType *type;
+
+    // 私有数据
+    void *privdata;
+
+    // 哈希表，rehash时新节点只写入ht[1]
+    oadictht ht[2];
+
+    // rehash索引（ht[0]中的槽位下标）
+    // 当rehash不在进行时，值为-1
+    long rehashidx;
+} oadict;
+
+
+/* ------------------------------- Macros ------------------------------------*/
+
+#define oadictSize(d) ((d)->ht[0].used+(d)->ht[1].used)
+#define oadictSlots(d) ((d)->ht[0].size+(d)->ht[1].size)
+#define oadictIsRehashing(d) ((d)->rehashidx != -1)
+
+
+/* ------------------------------- APIs ------------------------------------*/
+oadict *oadictCreate(dictType *type, void *privDataPtr);
+oadictEntry *oadictAddRaw(oadict *d, void *key, oadictEntry **existing);
+int oadictAdd(oadict *d, void *key, void *val);
+int oadictDelete(oadict *d, const void *key);
+void oadictRelease(oadict *d);
+
+int oadictExpand(oadict *d, unsigned long size);
+int oadictRehash(oadict *d, int n);
+
+oadictEntry *oadictFind(oadict *d, const void *key);
+
+#endif
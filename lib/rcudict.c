@@ -0,0 +1,470 @@
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+
+#include "rcudict.h"
+#include "zmalloc.h"
+
+
+// 写者发布、读者读取共享指针时使用的原子操作
+#define rcuLoad(p) __atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+#define rcuStore(p, v) __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+
+/* ------------------------------ reclamation -------------------------------- */
+
+/**
+ * 所有活跃读者中最小的epoch，没有活跃读者时为当前的全局epoch
+ * 调用前的写操作（摘下节点、发布快照）对之后进入临界区的读者都可见
+ */
+static uint64_t _rcudictMinEpoch(rcudict *d) {
+    uint64_t min;
+    int i, count;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    min = __atomic_load_n(&d->epoch, __ATOMIC_SEQ_CST);
+    count = __atomic_load_n(&d->readerCount, __ATOMIC_ACQUIRE);
+    if (count > RCUDICT_MAX_READERS) {
+        count = RCUDICT_MAX_READERS;
+    }
+    for (i = 0; i < count; i++) {
+        uint64_t e = __atomic_load_n(&d->readers[i].epoch, __ATOMIC_SEQ_CST);
+        if (e != 0 && e < min) {
+            min = e;
+        }
+    }
+    return min;
+}
+
+static void _rcudictFreeRetired(rcudict *d, rcudictRetired *r) {
+    if (r->freeKeyVal) {
+        rcudictEntry *he = r->ptr;
+        dictFreeKey(d, he);
+        dictFreeVal(d, he);
+    }
+    zfree(r->ptr);
+    zfree(r);
+}
+
+/**
+ * 回收所有读者都已经看不到的对象
+ * 先推进全局epoch，之后进入临界区的读者的epoch都大于已有对象的epoch
+ * @param  d  字典
+ * @return    回收的对象数量
+ */
+unsigned long rcudictReclaim(rcudict *d) {
+    rcudictRetired **link = &d->retired;
+    unsigned long freed = 0;
+    uint64_t min;
+
+    __atomic_add_fetch(&d->epoch, 1, __ATOMIC_SEQ_CST);
+    min = _rcudictMinEpoch(d);
+
+    while (*link) {
+        rcudictRetired *r = *link;
+
+        if (r->epoch < min) {
+            *link = r->next;
+            _rcudictFreeRetired(d, r);
+            freed++;
+        } else {
+            link = &r->next;
+        }
+    }
+    d->retiredCount -= freed;
+    return freed;
+}
+
+// 记录一个已经对新读者不可见的对象，freeKeyVal表示它是需要销毁键值的节点
+static void _rcudictRetire(rcudict *d, void *ptr, int freeKeyVal) {
+    rcudictRetired *r = zmalloc(sizeof(*r));
+
+    r->ptr = ptr;
+    r->freeKeyVal = freeKeyVal;
+    r->epoch = __atomic_load_n(&d->epoch, __ATOMIC_RELAXED);
+    r->next = d->retired;
+    d->retired = r;
+    d->retiredCount++;
+}
+
+static void _rcudictReclaimIfNeeded(rcudict *d) {
+    if (d->retiredCount >= RCUDICT_RECLAIM_THRESHOLD) {
+        rcudictReclaim(d);
+    }
+}
+
+// 发布新快照，旧快照延迟回收
+static void _rcudictPublish(rcudict *d, rcudictht *ht0, rcudictht *ht1) {
+    rcudictSnapshot *s = zmalloc(sizeof(*s)), *old = d->snapshot;
+
+    s->ht[0] = ht0;
+    s->ht[1] = ht1;
+    rcuStore(d->snapshot, s);
+    _rcudictRetire(d, old, 0);
+}
+
+
+/* ----------------------------- API implementation ------------------------- */
+
+/**
+ * 创建一个读无锁的字典
+ * dictType中的pooledEntries、noValue和内嵌键选项对rcudict无效
+ * @param  type         类型特定函数
+ * @param  privDataPtr  私有数据
+ * @return
+ */
+rcudict *rcudictCreate(dictType *type, void *privDataPtr) {
+    rcudict *d = zmalloc_aligned(64, sizeof(*d));
+
+    memset(d, 0, sizeof(*d));
+    d->type = type;
+    d->privdata = privDataPtr;
+    d->snapshot = zmalloc(sizeof(rcudictSnapshot));
+    d->snapshot->ht[0] = NULL;
+    d->snapshot->ht[1] = NULL;
+    d->rehashidx = -1;
+    d->epoch = 1;
+    return d;
+}
+
+
+/**
+ * 注册一个读者，每个读线程调用一次
+ * @param  d  字典
+ * @return    读者编号，超过RCUDICT_MAX_READERS时返回-1
+ */
+int rcudictRegisterReader(rcudict *d) {
+    int id = __atomic_fetch_add(&d->readerCount, 1, __ATOMIC_ACQ_REL);
+
+    if (id >= RCUDICT_MAX_READERS) {
+        return -1;
+    }
+    return id;
+}
+
+
+/**
+ * 进入读临界区，之后通过rcudictFind得到的节点在rcudictReadUnlock之前不会被释放
+ * 写者在我们发布epoch之后的扫描一定能看到它；没看到的扫描发生在此之前，
+ * 那时已经摘下的对象我们也不可能再读到
+ */
+void rcudictReadLock(rcudict *d, int reader) {
+    uint64_t e = __atomic_load_n(&d->epoch, __ATOMIC_SEQ_CST);
+
+    __atomic_store_n(&d->readers[reader].epoch, e, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+// 离开读临界区
+void rcudictReadUnlock(rcudict *d, int reader) {
+    __atomic_store_n(&d->readers[reader].epoch, 0, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * 查找键，读者必须在临界区内调用，写者可以直接调用
+ * 不修改字典的任何字段
+ * @param  d    字典
+ * @param  key  键
+ * @return      节点，不存在时返回NULL
+ */
+rcudictEntry *rcudictFind(rcudict *d, const void *key) {
+    rcudictSnapshot *s = rcuLoad(d->snapshot);
+    uint64_t h;
+    int table;
+
+    if (s->ht[0] == NULL) {
+        return NULL;
+    }
+
+    h = dictHashKey(d, key);
+    for (table = 0; table <= 1; table++) {
+        rcudictht *ht = s->ht[table];
+        rcudictEntry *he;
+
+        if (ht == NULL) {
+            break;
+        }
+        he = rcuLoad(ht->table[h & ht->sizemask]);
+        while (he) {
+            if (key == he->key || dictCompareKeys(d, key, he->key)) {
+                return he;
+            }
+            he = rcuLoad(he->next);
+        }
+    }
+    return NULL;
+}
+
+
+// 扩充后的哈希表大小
+static unsigned long _rcudictNextPower(unsigned long size) {
+    unsigned long i = DICT_HT_INITIAL_SIZE;
+
+    if (size >= LONG_MAX) {
+        return LONG_MAX + 1LU;
+    }
+
+    while (i < size) {
+        i *= 2;
+    }
+    return i;
+}
+
+
+// 扩充或创建哈希表
+int rcudictExpand(rcudict *d, unsigned long size) {
+    rcudictht *n, *ht0 = d->snapshot->ht[0];
+    unsigned long realsize;
+
+    if (rcudictIsRehashing(d) || d->used[0] > size) {
+        return DICT_ERR;
+    }
+
+    realsize = _rcudictNextPower(size);
+    if (ht0 && realsize == ht0->size) {
+        return DICT_ERR;
+    }
+
+    n = zmalloc(sizeof(*n) + realsize * sizeof(rcudictEntry *));
+    n->size = realsize;
+    n->sizemask = realsize - 1;
+    memset(n->table, 0, realsize * sizeof(rcudictEntry *));
+
+    if (ht0 == NULL) {
+        _rcudictPublish(d, n, NULL);
+        return DICT_OK;
+    }
+
+    // 持有旧快照（只有ht[0]）的读者看不到ht[1]，在它们全部离开之前不能清空ht[0]的桶
+    _rcudictPublish(d, ht0, n);
+    d->rehashidx = 0;
+    d->rehashEpoch = __atomic_fetch_add(&d->epoch, 1, __ATOMIC_SEQ_CST);
+    return DICT_OK;
+}
+
+
+/**
+ * rehash操作
+ * 把ht[0]一个桶中的节点复制到ht[1]，发布之后再清空这个桶，旧节点延迟回收。
+ * 正在遍历旧链表的读者可以继续读完，清空之后到来的读者会在ht[1]中找到副本。
+ * @param  d  字典
+ * @param  n  最多迁移的桶数
+ * @return    1表示还需要继续rehash（包括还在等待宽限期），0表示已完成
+ */
+int rcudictRehash(rcudict *d, int n) {
+    rcudictht *ht0, *ht1;
+    int empty_visits = n * 10;
+
+    if (!rcudictIsRehashing(d)) {
+        return 0;
+    }
+
+    if (d->rehashEpoch != 0) {
+        if (_rcudictMinEpoch(d) <= d->rehashEpoch) {
+            return 1;
+        }
+        d->rehashEpoch = 0;
+    }
+
+    ht0 = d->snapshot->ht[0];
+    ht1 = d->snapshot->ht[1];
+    while (n-- && d->used[0] != 0) {
+        rcudictEntry *he;
+
+        while (ht0->table[d->rehashidx] == NULL) {
+            d->rehashidx++;
+            if (--empty_visits == 0) {
+                return 1;
+            }
+        }
+
+        for (he = ht0->table[d->rehashidx]; he; he = he->next) {
+            rcudictEntry *copy = zmalloc(sizeof(*copy));
+            uint64_t idx = dictHashKey(d, he->key) & ht1->sizemask;
+
+            copy->key = he->key;
+            copy->v = he->v;
+            copy->next = ht1->table[idx];
+            rcuStore(ht1->table[idx], copy);
+            d->used[0]--;
+            d->used[1]++;
+        }
+
+        he = ht0->table[d->rehashidx];
+        rcuStore(ht0->table[d->rehashidx], NULL);
+        while (he) {
+            rcudictEntry *next = he->next;
+            _rcudictRetire(d, he, 0);
+            he = next;
+        }
+        d->rehashidx++;
+    }
+
+    if (d->used[0] == 0) {
+        _rcudictPublish(d, ht1, NULL);
+        _rcudictRetire(d, ht0, 0);
+        d->used[0] = d->used[1];
+        d->used[1] = 0;
+        d->rehashidx = -1;
+        _rcudictReclaimIfNeeded(d);
+        return 0;
+    }
+
+    _rcudictReclaimIfNeeded(d);
+    return 1;
+}
+
+
+// 如果需要，则扩充哈希表
+static int _rcudictExpandIfNeeded(rcudict *d) {
+    rcudictht *ht0 = d->snapshot->ht[0];
+
+    if (rcudictIsRehashing(d)) {
+        return DICT_OK;
+    }
+
+    if (ht0 == NULL) {
+        return rcudictExpand(d, DICT_HT_INITIAL_SIZE);
+    }
+
+    // 等待宽限期时新节点都写入ht[1]，rehash完成后节点数可能已经超过size的两倍，
+    // 按节点数而不是表大小扩容
+    if (d->used[0] >= ht0->size) {
+        return rcudictExpand(d, d->used[0] * 2);
+    }
+    return DICT_OK;
+}
+
+
+/**
+ * 将给定的键值对添加到字典，只能由写者调用
+ * @param  d    字典
+ * @param  key  键
+ * @param  val  值
+ * @return      键已存在时返回DICT_ERR
+ */
+int rcudictAdd(rcudict *d, void *key, void *val) {
+    rcudictEntry *he;
+    rcudictht *ht;
+    uint64_t idx;
+    int table;
+
+    if (rcudictIsRehashing(d)) {
+        rcudictRehash(d, 1);
+    }
+
+    if (rcudictFind(d, key) != NULL) {
+        return DICT_ERR;
+    }
+
+    if (_rcudictExpandIfNeeded(d) == DICT_ERR) {
+        return DICT_ERR;
+    }
+
+    table = rcudictIsRehashing(d) ? 1 : 0;
+    ht = d->snapshot->ht[table];
+    idx = dictHashKey(d, key) & ht->sizemask;
+
+    // 节点完全初始化之后才发布
+    he = zmalloc(sizeof(*he));
+    dictSetKey(d, he, key);
+    dictSetVal(d, he, val);
+    he->next = ht->table[idx];
+    rcuStore(ht->table[idx], he);
+    d->used[table]++;
+
+    _rcudictReclaimIfNeeded(d);
+    return DICT_OK;
+}
+
+
+/**
+ * 将给定的键从字典中删除，只能由写者调用
+ * 节点从链表中摘下后，等所有可能看到它的读者离开才销毁键值并释放
+ * @param  d    字典
+ * @param  key  键
+ * @return
+ */
+int rcudictDelete(rcudict *d, const void *key) {
+    uint64_t h;
+    int table;
+
+    if (rcudictSize(d) == 0) {
+        return DICT_ERR;
+    }
+
+    if (rcudictIsRehashing(d)) {
+        rcudictRehash(d, 1);
+    }
+
+    h = dictHashKey(d, key);
+    for (table = 0; table <= 1; table++) {
+        rcudictht *ht = d->snapshot->ht[table];
+        rcudictEntry *he, *prevHe = NULL;
+        uint64_t idx;
+
+        if (ht == NULL) {
+            break;
+        }
+        idx = h & ht->sizemask;
+        he = ht->table[idx];
+        while (he) {
+            if (key == he->key || dictCompareKeys(d, key, he->key)) {
+                // 被摘下的节点的next保持不变，正在读它的读者可以继续走下去
+                if (prevHe) {
+                    rcuStore(prevHe->next, he->next);
+                } else {
+                    rcuStore(ht->table[idx], he->next);
+                }
+                d->used[table]--;
+                _rcudictRetire(d, he, 1);
+                _rcudictReclaimIfNeeded(d);
+                return DICT_OK;
+            }
+            prevHe = he;
+            he = he->next;
+        }
+    }
+    return DICT_ERR;
+}
+
+
+/**
+ * 释放字典，调用时不能有读者在临界区内
+ * @param  d  字典
+ * @return void
+ */
+void rcudictRelease(rcudict *d) {
+    rcudictSnapshot *s = d->snapshot;
+    int table;
+
+    for (table = 0; table <= 1; table++) {
+        rcudictht *ht = s->ht[table];
+        unsigned long i;
+
+        if (ht == NULL) {
+            continue;
+        }
+        for (i = 0; i < ht->size; i++) {
+            rcudictEntry *he = ht->table[i], *next;
+
+            while (he) {
+                next = he->next;
+                dictFreeKey(d, he);
+                dictFreeVal(d, he);
+                zfree(he);
+                he = next;
+            }
+        }
+        zfree(ht);
+    }
+    zfree(s);
+
+    while (d->retired) {
+        rcudictRetired *r = d->retired;
+        d->retired = r->next;
+        _rcudictFreeRetired(d, r);
+    }
+    zfree(d);
+}
@@ -0,0 +1,140 @@
+#ifndef __RCUDICT_H__
+#define __RCUDICT_H__
+
+#include <stdint.h>
+
+#include "dict.h"
+
+/*
+ * 读无锁的字典（单写者，基于epoch的延迟回收）
+ *
+ * 读者不加任何锁：通过原子发布的快照找到当前的一到两个哈希表，然后沿链表查找。
+ * 同一时刻只能有一个写者（多个写线程需要在外部互斥），写者负责添加、删除和
+ * 渐进式rehash，从链表中摘下的节点、旧的桶数组和旧快照不会立即释放，而是记录
+ * 摘下时的全局epoch，等所有活跃读者都进入了更新的epoch之后才真正释放。
+ *
+ * 与dict的区别：
+ *   - rehash时复制节点到新表而不是移动节点，正在遍历旧链表的读者不会被带到
+ *     另一条链表上；旧节点和新节点共享键和值，旧节点回收时不销毁它们
+ *   - 开始rehash后要等一个宽限期，确保没有读者还在使用只包含旧表的快照，
+ *     之后才开始清空旧表的桶
+ *   - 不自动缩容，不支持迭代器
+ *
+ * 读者的用法：
+ *   int id = rcudictRegisterReader(d);     每个线程一次
+ *   rcudictReadLock(d, id);
+ *   de = rcudictFind(d, key);              de只在ReadUnlock之前有效
+ *   rcudictReadUnlock(d, id);
+ */
+
+#define RCUDICT_MAX_READERS 128
+
+// 读者多次进入临界区之间写者积累的待回收对象达到该数量时尝试回收
+#define RCUDICT_RECLAIM_THRESHOLD 64
+
+
+// 哈希表节点，next只能由写者修改，并且总是在节点初始化完成后才发布
+typedef struct rcudictEntry {
+    struct rcudictEntry *next;
+
+    void *key;
+
+    union {
+        void *val;
+        uint64_t u64;
+        int64_t s64;
+        double d;
+    } v;
+} rcudictEntry;
+
+
+// 哈希表，分配后大小不变
+typedef struct rcudictht {
+    unsigned long size;
+    unsigned long sizemask;
+    rcudictEntry *table[];
+} rcudictht;
+
+
+// 快照，读者一次读取得到一致的表组合；发布后不再修改
+typedef struct rcudictSnapshot {
+    rcudictht *ht[2];
+} rcudictSnapshot;
+
+
+// 读者记录，占用一个缓存行
+typedef struct rcudictReader {
+    // 读者进入临界区时的全局epoch，不在临界区时为0
+    uint64_t epoch;
+} __attribute__((aligned(64))) rcudictReader;
+
+
+// 待回收对象
+typedef struct rcudictRetired {
+    struct rcudictRetired *next;
+
+    // 被摘下时的全局epoch
+    uint64_t epoch;
+
+    void *ptr;
+
+    // 节点回收时是否销毁键和值（rehash留下的旧节点不销毁）
+    int freeKeyVal;
+} rcudictRetired;
+
+
+// 字典
+typedef struct rcudict {
+    // 类型特定函数
+    dictType *type;
+
+    // 私有数据
+    void *privdata;
+
+    // 当前快照，读者通过原子读取获得
+    rcudictSnapshot *snapshot;
+
+    // 两个表各自的节点数量，只有写者访问
+    unsigned long used[2];
+
+    // rehash索引，当rehash不在进行时，值为-1
+    long rehashidx;
+
+    // 开始rehash时的epoch，活跃读者都越过它之后才能清空旧表的桶
+    uint64_t rehashEpoch;
+
+    // 全局epoch，从1开始
+    uint64_t epoch;
+
+    // 待回收对象链表
+    rcudictRetired *retired;
+    unsigned long retiredCount;
+
+    // 已注册的读者数量
+    int readerCount;
+    rcudictReader readers[RCUDICT_MAX_READERS];
+} rcudict;
+
+
+/* ------------------------------- Macros ------------------------------------*/
+
+#define rcudictSize(d) ((d)->used[0]+(d)->used[1])
+#define rcudictIsRehashing(d) ((d)->rehashidx != -1)
+
+
+/* ------------------------------- APIs ------------------------------------*/
+rcudict *rcudictCreate(dictType *type, void *privDataPtr);
+void rcudictRelease(rcudict *d);
+
+int rcudictRegisterReader(rcudict *d);
+void rcudictReadLock(rcudict *d, int reader);
+void rcudictReadUnlock(rcudict *d, int reader);
+rcudictEntry *rcudictFind(rcudict *d, const void *key);
+
+int rcudictAdd(rcudict *d, void *key, void *val);
+int rcudictDelete(rcudict *d, const void *key);
+int rcudictExpand(rcudict *d, unsigned long size);
+int rcudictRehash(rcudict *d, int n);
+unsigned long rcudictReclaim(rcudict *d);
+
+#endif
@@ -1,9 +1,28 @@
+#ifdef __linux__
+#define _GNU_SOURCE /* mremap */
+#endif
+
+#include <ctype.h>
+#include <errno.h>
 #include <limits.h>
+#include <math.h>
+#include <stdlib.h>
 #include <string.h>
 
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include "sds.h"
 #include "zmalloc.h"
 
+// 传给sdsnewlen时表示不初始化内容
+const char *SDS_NOINIT = "SDS_NOINIT";
+
+// 创建或扩充到SDS_MMAP_THRESHOLD的字符串是否改用mmap/mremap
+static int sds_mmap_growth = 1;
+
 /*
  * 获取sds头部大小
  *
@@ -12,6 +31,8 @@
  */
 static inline int sdsHdrSize(char type) {
     switch (type & SDS_TYPE_MASK) {
+        case SDS_TYPE_5:
+            return SIZEOF_SDS_HDR(5);
         case SDS_TYPE_8:
             return SIZEOF_SDS_HDR(8);
         case SDS_TYPE_16:
@@ -32,6 +53,8 @@ static inline int sdsHdrSize(char type) {
  * @return 头部类型
  */
 static inline char sdsReqType(size_t string_size) {
+    if (string_size < 1<<5)
+        return SDS_TYPE_5;
     if (string_size < 1<<8)
         return SDS_TYPE_8;
     if (string_size < 1<<16)
@@ -46,6 +69,123 @@ static inline char sdsReqType(size_t string_size) {
 }
 
 
+/*
+ * 获取头部类型能记录的最大长度
+ *
+ * @param type 类型
+ * @return 最大长度
+ */
+static inline size_t sdsTypeMaxSize(char type) {
+    if (type == SDS_TYPE_5)
+        return (1<<5) - 1;
+    if (type == SDS_TYPE_8)
+        return (1<<8) - 1;
+    if (type == SDS_TYPE_16)
+        return (1<<16) - 1;
+#if (LONG_MAX == LLONG_MAX)
+    if (type == SDS_TYPE_32)
+        return (1ll<<32) - 1;
+#endif
+    return -1;
+}
+
+
+/*
+ * 分配器按大小类别取整，多出来的字节也记到alloc中，后续拼接可以直接使用
+ *
+ * @param ptr zmalloc返回的内存
+ * @param type 头部类型
+ * @return 可以记到alloc中的长度
+ */
+static inline size_t sdsUsableAlloc(void *ptr, char type) {
+    size_t usable = zmalloc_usable_size(ptr) - sdsHdrSize(type) - 1;
+
+    if (usable > sdsTypeMaxSize(type))
+        usable = sdsTypeMaxSize(type);
+    return usable;
+}
+
+
+/*
+ * 超大的字符串直接用mmap分配，扩充时用mremap移动页表，不拷贝数据
+ * 这样的字符串flags中有SDS_FLAG_MMAP，alloc是映射长度减去头部和结尾的'\0'
+ */
+#ifdef __linux__
+static inline size_t sdsMmapSize(size_t size) {
+    size_t page = sysconf(_SC_PAGESIZE);
+
+    return (size + page - 1) & ~(page - 1);
+}
+
+static void *sdsMmapAlloc(size_t size) {
+    void *ptr = mmap(NULL, sdsMmapSize(size), PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+static void *sdsMmapRealloc(void *ptr, size_t oldsize, size_t size) {
+    void *newptr = mremap(ptr, sdsMmapSize(oldsize), sdsMmapSize(size), MREMAP_MAYMOVE);
+
+    return newptr == MAP_FAILED ? NULL : newptr;
+}
+
+static void sdsMmapFree(void *ptr, size_t size) {
+    munmap(ptr, sdsMmapSize(size));
+}
+#endif
+
+// 内存是否由mmap分配，SDS_TYPE_5的flags高位是长度，没有这个标志
+static inline int sdsIsMmap(const sds s) {
+    return (s[-1] & SDS_TYPE_MASK) != SDS_TYPE_5 && (s[-1] & SDS_FLAG_MMAP);
+}
+
+// 需要size字节（包括头部和结尾的'\0'）时是否使用mmap
+static inline int sdsUseMmap(size_t size) {
+#ifdef __linux__
+    return sds_mmap_growth && size >= SDS_MMAP_THRESHOLD;
+#else
+    (void)size;
+    return 0;
+#endif
+}
+
+// mmap分配的字符串可以记到alloc中的长度
+static inline size_t sdsMmapUsable(size_t size, char type) {
+#ifdef __linux__
+    size_t usable = sdsMmapSize(size) - sdsHdrSize(type) - 1;
+
+    if (usable > sdsTypeMaxSize(type))
+        usable = sdsTypeMaxSize(type);
+    return usable;
+#else
+    (void)type;
+    return size;
+#endif
+}
+
+// 释放sds的内存，包括mmap分配的
+static void sdsFreeBuffer(sds s) {
+    void *sh = (char *)s - sdsHdrSize(s[-1]);
+
+#ifdef __linux__
+    if (sdsIsMmap(s)) {
+        sdsMmapFree(sh, sdsAllocSize(s));
+        return;
+    }
+#endif
+    zfree(sh);
+}
+
+/*
+ * 设置创建或扩充到SDS_MMAP_THRESHOLD的字符串是否改用mmap/mremap，只影响之后的分配
+ * 已经用mmap分配的字符串不受影响
+ */
+void sdsSetMmapGrowth(int enable) {
+    sds_mmap_growth = enable;
+}
+
+
 /*
  * 根据字符串创建sds字符串
  *
@@ -55,51 +195,78 @@ static inline char sdsReqType(size_t string_size) {
  */
 sds sdsnewlen(const void *init, size_t initlen) {
     char type = sdsReqType(initlen);
-    int hdrlen = sdsHdrSize(type);
-    int memsize = hdrlen + initlen + 1;
+    /* 空字符串通常是为了之后拼接而创建的，使用可以预留空间的SDS_TYPE_8 */
+    if (type == SDS_TYPE_5 && initlen == 0)
+        type = SDS_TYPE_8;
+    size_t hdrlen = sdsHdrSize(type);
+    size_t memsize = hdrlen + initlen + 1;
+    int mmapped = 0;
+    void *ptr;
+    size_t usable;
 
-    void *ptr = zmalloc(memsize);
-    if (ptr == NULL)
-        return NULL;
+    if (memsize <= initlen)
+        return NULL; /* size_t溢出 */
+#ifdef __linux__
+    /* 超大的字符串直接用mmap分配，之后的拼接可以mremap，匿名映射已经是全0 */
+    if (sdsUseMmap(memsize)) {
+        ptr = sdsMmapAlloc(memsize);
+        if (ptr == NULL)
+            return NULL;
+        mmapped = 1;
+        usable = sdsMmapUsable(memsize, type);
+    } else
+#endif
+    {
+        ptr = zmalloc(memsize);
+        if (ptr == NULL)
+            return NULL;
+        usable = sdsUsableAlloc(ptr, type);
+    }
 
     if (init == SDS_NOINIT)
         init = NULL;
-    else if (!init)
+    else if (!init && !mmapped)
         memset(ptr, 0, memsize);
 
     sds s = (char *)ptr + hdrlen;
     unsigned char *fp = ((unsigned char *)s - 1); /* flags pointer. */
 
     switch (type) {
+        case SDS_TYPE_5: {
+            *fp = type | (initlen << SDS_TYPE_BITS);
+            break;
+        }
         case SDS_TYPE_8: {
             SDS_HDR_VAR(8, s);
             sh->len = initlen;
-            sh->alloc = initlen;
+            sh->alloc = usable;
             *fp = type;
             break;
         }
         case SDS_TYPE_16: {
             SDS_HDR_VAR(16, s);
             sh->len = initlen;
-            sh->alloc = initlen;
+            sh->alloc = usable;
             *fp = type;
             break;
         }
         case SDS_TYPE_32: {
             SDS_HDR_VAR(32, s);
             sh->len = initlen;
-            sh->alloc = initlen;
+            sh->alloc = usable;
             *fp = type;
             break;
         }
         case SDS_TYPE_64: {
             SDS_HDR_VAR(64, s);
             sh->len = initlen;
-            sh->alloc = initlen;
+            sh->alloc = usable;
             *fp = type;
             break;
         }
     }
+    if (mmapped)
+        *fp |= SDS_FLAG_MMAP;
 
     if (initlen && init)
         memcpy(s, init, initlen);
@@ -108,6 +275,40 @@ sds sdsnewlen(const void *init, size_t initlen) {
 }
 
 
+/*
+ * 在调用者提供的内存中构造sds字符串需要的字节数
+ *
+ * @param initlen 字符串的长度
+ * @return 字节数（头部+字符串+结尾的'\0'）
+ */
+size_t sdsembedsize(size_t initlen) {
+    return sdsHdrSize(sdsReqType(initlen)) + initlen + 1;
+}
+
+
+/*
+ * 在调用者提供的内存中构造sds字符串，例如内嵌在其它结构体中
+ * 这样的sds没有空闲空间，不能被sdsfree释放，也不能再拼接
+ *
+ * @param buf 内存，至少sdsembedsize(initlen)字节
+ * @param init 初始字符串
+ * @param initlen 初始字符串的长度
+ * @return sds
+ */
+sds sdsembed(void *buf, const void *init, size_t initlen) {
+    char type = sdsReqType(initlen);
+    sds s = (char *)buf + sdsHdrSize(type);
+
+    s[-1] = type;
+    sdssetlen(s, initlen);
+    sdssetalloc(s, initlen);
+    if (initlen)
+        memcpy(s, init, initlen);
+    s[initlen] = '\0';
+    return s;
+}
+
+
 /*
  * 根据字符串创建sds字符串
  *
@@ -141,7 +342,7 @@ sds sdsempty(void) {
 void sdsfree(sds s) {
     if (s == NULL)
         return;
-    zfree((char *)s - sdsHdrSize(s[-1]));
+    sdsFreeBuffer(s);
 }
 
 
@@ -150,25 +351,55 @@ void sdsfree(sds s) {
  *
  * @param s sds字符串
  * @param addlen 扩充长度
+ * @param greedy 不为0时多分配空间（小于SDS_MAX_PREALLOC时翻倍，否则多分配SDS_MAX_PREALLOC），
+ *               为0时只分配需要的空间
  * @return
  */
-sds sdsMakeRoomFor(sds s, size_t addlen) {
+static sds _sdsMakeRoomFor(sds s, size_t addlen, int greedy) {
     size_t avail = sdsavail(s);
     if (avail >= addlen)
         return s;
 
     size_t len = sdslen(s);
     size_t newlen = len + addlen;
-    if (newlen < SDS_MAX_PREALLOC)
-        newlen *= 2;
-    else
-        newlen += SDS_MAX_PREALLOC;
+    if (newlen <= len)
+        return NULL; /* size_t溢出 */
+    if (greedy) {
+        if (newlen < SDS_MAX_PREALLOC)
+            newlen *= 2;
+        else
+            newlen += SDS_MAX_PREALLOC;
+    }
 
     void *newsh;
     char oldtype = s[-1] & SDS_TYPE_MASK;
     void *sh = (char *)s - sdsHdrSize(oldtype);
     char type = sdsReqType(newlen);
+    /* SDS_TYPE_5没有记录空闲空间的字段，正在拼接的字符串至少使用SDS_TYPE_8 */
+    if (type == SDS_TYPE_5)
+        type = SDS_TYPE_8;
     int hdrlen = sdsHdrSize(type);
+#ifdef __linux__
+    if (sdsIsMmap(s) || sdsUseMmap(hdrlen + newlen + 1)) {
+        if (sdsIsMmap(s) && oldtype == type) {
+            newsh = sdsMmapRealloc(sh, sdsAllocSize(s), hdrlen + newlen + 1);
+            if (newsh == NULL)
+                return NULL;
+            s = (char *)newsh + hdrlen;
+        } else {
+            newsh = sdsMmapAlloc(hdrlen + newlen + 1);
+            if (newsh == NULL)
+                return NULL;
+            memcpy((char *)newsh + hdrlen, s, len + 1);
+            sdsFreeBuffer(s);
+            s = (char *)newsh + hdrlen;
+            s[-1] = type | SDS_FLAG_MMAP;
+            sdssetlen(s, len);
+        }
+        sdssetalloc(s, sdsMmapUsable(hdrlen + newlen + 1, type));
+        return s;
+    }
+#endif
     if (oldtype == type) {
         newsh = zrealloc(sh, hdrlen + newlen + 1);
         if (newsh == NULL)
@@ -178,17 +409,138 @@ sds sdsMakeRoomFor(sds s, size_t addlen) {
         newsh = zmalloc(hdrlen + newlen + 1);
         if (newsh == NULL)
             return NULL;
-        memcpy(newsh + hdrlen, s, len + 1);
+        memcpy((char *)newsh + hdrlen, s, len + 1);
         zfree(sh);
         s = (char *)newsh + hdrlen;
         s[-1] = type;
         sdssetlen(s, len);
     }
-    sdssetalloc(s, newlen);
+    sdssetalloc(s, sdsUsableAlloc(newsh, type));
+    return s;
+}
+
+
+/*
+ * 扩充sds的空间，预留额外的空间给后续的拼接
+ *
+ * @param s sds字符串
+ * @param addlen 扩充长度
+ * @return
+ */
+sds sdsMakeRoomFor(sds s, size_t addlen) {
+    return _sdsMakeRoomFor(s, addlen, 1);
+}
+
+
+/*
+ * 扩充sds的空间，只分配需要的空间，适合不会再拼接的字符串
+ *
+ * @param s sds字符串
+ * @param addlen 扩充长度
+ * @return
+ */
+sds sdsMakeRoomForNonGreedy(sds s, size_t addlen) {
+    return _sdsMakeRoomFor(s, addlen, 0);
+}
+
+
+/*
+ * 把sds的空间调整为size，size小于字符串长度时截断字符串
+ * 头部类型变小且不是SDS_TYPE_5、SDS_TYPE_8时保留原来的头部，直接zrealloc，避免拷贝
+ *
+ * @param s sds字符串
+ * @param size 新的空间大小（不包括头部和结尾的'\0'）
+ * @return sds字符串，失败时返回NULL，原来的s不变
+ */
+sds sdsResize(sds s, size_t size) {
+    void *sh, *newsh;
+    char oldtype = s[-1] & SDS_TYPE_MASK;
+    int oldhdrlen = sdsHdrSize(oldtype);
+    size_t len = sdslen(s);
+    char type;
+    int hdrlen;
+
+    if (sdsalloc(s) == size)
+        return s;
+    if (size < len)
+        len = size;
+
+    sh = (char *)s - oldhdrlen;
+    type = sdsReqType(size);
+    /* 只有没有空闲空间时才能使用SDS_TYPE_5 */
+    if (type == SDS_TYPE_5 && size > len)
+        type = SDS_TYPE_8;
+    hdrlen = sdsHdrSize(type);
+#ifdef __linux__
+    /* mmap分配的字符串调整后仍然足够大时继续用mmap，否则改回zmalloc
+     * 原来的头部放得下size时用mremap，否则与_sdsMakeRoomFor一样换成新的映射再拷贝 */
+    if (sdsIsMmap(s) && hdrlen + size + 1 >= SDS_MMAP_THRESHOLD) {
+        if (type <= oldtype) {
+            newsh = sdsMmapRealloc(sh, sdsAllocSize(s), oldhdrlen + size + 1);
+            if (newsh == NULL)
+                return NULL;
+            s = (char *)newsh + oldhdrlen;
+            type = oldtype;
+            hdrlen = oldhdrlen;
+        } else {
+            newsh = sdsMmapAlloc(hdrlen + size + 1);
+            if (newsh == NULL)
+                return NULL;
+            memcpy((char *)newsh + hdrlen, s, len);
+            sdsFreeBuffer(s);
+            s = (char *)newsh + hdrlen;
+            s[-1] = type | SDS_FLAG_MMAP;
+        }
+        s[len] = '\0';
+        sdssetlen(s, len);
+        sdssetalloc(s, sdsMmapUsable(hdrlen + size + 1, type));
+        return s;
+    }
+#endif
+    if (!sdsIsMmap(s) && (oldtype == type || (type < oldtype && type > SDS_TYPE_8))) {
+        newsh = zrealloc(sh, oldhdrlen + size + 1);
+        if (newsh == NULL)
+            return NULL;
+        s = (char *)newsh + oldhdrlen;
+        type = oldtype;
+    } else {
+        newsh = zmalloc(hdrlen + size + 1);
+        if (newsh == NULL)
+            return NULL;
+        memcpy((char *)newsh + hdrlen, s, len);
+        sdsFreeBuffer(s);
+        s = (char *)newsh + hdrlen;
+        s[-1] = type;
+    }
+    s[len] = '\0';
+    sdssetlen(s, len);
+    sdssetalloc(s, sdsUsableAlloc(newsh, type));
     return s;
 }
 
 
+/*
+ * 释放sds末尾的空闲空间
+ *
+ * @param s sds字符串
+ * @return sds字符串
+ */
+sds sdsRemoveFreeSpace(sds s) {
+    return sdsResize(s, sdslen(s));
+}
+
+
+/*
+ * 获取sds占用的总字节数（头部+空间+结尾的'\0'）
+ *
+ * @param s sds字符串
+ * @return 字节数
+ */
+size_t sdsAllocSize(sds s) {
+    return sdsHdrSize(s[-1]) + sdsalloc(s) + 1;
+}
+
+
 /*
  * 拼接字符串
  *
@@ -269,6 +621,476 @@ sds sdscpy(sds s, const char *t) {
 }
 
 
+/* ---------------------- 区间、修剪、分割与大小写转换 ---------------------- */
+
+/*
+ * 查找字节、字符集合跨度和ASCII大小写转换有三种实现：
+ *   - 标量：逐字节处理，其他平台和测试使用
+ *   - SSE2：x86_64的基本指令集，每次处理16字节
+ *   - AVX2：运行时检测CPU支持后使用，每次处理32字节，剩余部分交给SSE2
+ */
+
+// 字符集合：标量实现查表，SIMD实现对集合中的每个字符做一次比较
+typedef struct sdsCharset {
+    unsigned char map[256];
+    const char *chars;
+    size_t n;
+} sdsCharset;
+
+// 字符集合超过这个数量时SIMD逐字符比较不划算，改用标量查表
+#define SDS_SIMD_MAX_CSET 8
+
+
+// 在[p, end)中查找字节c，找不到返回NULL
+static const char *_sdsFindByteScalar(const char *p, const char *end, char c) {
+    for (; p < end; p++) {
+        if (*p == c)
+            return p;
+    }
+    return NULL;
+}
+
+// 把[first, first+25]中的字节翻转0x20，first为'A'时转小写，为'a'时转大写
+static void _sdsMapCaseScalar(char *p, size_t len, char first) {
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        if ((unsigned char)(p[i] - first) < 26)
+            p[i] ^= 0x20;
+    }
+}
+
+// 从头开始连续属于集合的字节数
+static size_t _sdsSpanScalar(const char *p, size_t len, const sdsCharset *cs) {
+    size_t i = 0;
+
+    while (i < len && cs->map[(unsigned char)p[i]])
+        i++;
+    return i;
+}
+
+// 从尾部开始连续属于集合的字节数
+static size_t _sdsRspanScalar(const char *p, size_t len, const sdsCharset *cs) {
+    size_t i = 0;
+
+    while (i < len && cs->map[(unsigned char)p[len - i - 1]])
+        i++;
+    return i;
+}
+
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+
+#define SDS_X86_DISPATCH 1
+
+static inline __attribute__((always_inline)) const char *_sdsFindByteSse2(const char *p, const char *end, char c) {
+    __m128i needle = _mm_set1_epi8(c);
+
+    while (end - p >= 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, needle));
+
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 16;
+    }
+    return _sdsFindByteScalar(p, end, c);
+}
+
+/*
+ * 加上0x80-first后，范围内的字节变成有符号数的[-128, -103]，
+ * 一次有符号比较就能得到需要翻转的字节
+ */
+static inline __attribute__((always_inline)) void _sdsMapCaseSse2(char *p, size_t len, char first) {
+    __m128i shift = _mm_set1_epi8((char)(0x80 - first));
+    __m128i limit = _mm_set1_epi8((char)(0x80 + 26));
+    __m128i flip = _mm_set1_epi8(0x20);
+    size_t i;
+
+    for (i = 0; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i m = _mm_cmplt_epi8(_mm_add_epi8(x, shift), limit);
+
+        _mm_storeu_si128((__m128i *)(p + i), _mm_xor_si128(x, _mm_and_si128(m, flip)));
+    }
+    _sdsMapCaseScalar(p + i, len - i, first);
+}
+
+// 16字节中属于集合的字节的位掩码
+static inline int _sdsCharsetMask16(__m128i x, const sdsCharset *cs) {
+    __m128i m = _mm_setzero_si128();
+    size_t j;
+
+    for (j = 0; j < cs->n; j++) {
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8(cs->chars[j])));
+    }
+    return _mm_movemask_epi8(m);
+}
+
+static inline __attribute__((always_inline)) size_t _sdsSpanSse2(const char *p, size_t len, const sdsCharset *cs) {
+    size_t i = 0;
+
+    if (cs->n <= SDS_SIMD_MAX_CSET) {
+        for (; i + 16 <= len; i += 16) {
+            int mask = _sdsCharsetMask16(_mm_loadu_si128((const __m128i *)(p + i)), cs);
+
+            if (mask != 0xffff)
+                return i + __builtin_ctz(~mask);
+        }
+    }
+    return i + _sdsSpanScalar(p + i, len - i, cs);
+}
+
+static inline __attribute__((always_inline)) size_t _sdsRspanSse2(const char *p, size_t len, const sdsCharset *cs) {
+    size_t i = 0;
+
+    if (cs->n <= SDS_SIMD_MAX_CSET) {
+        for (; i + 16 <= len; i += 16) {
+            int mask = _sdsCharsetMask16(_mm_loadu_si128((const __m128i *)(p + len - i - 16)), cs);
+
+            // 最高的不属于集合的字节之后的字节都属于集合
+            if (mask != 0xffff)
+                return i + __builtin_clz(~mask & 0xffff) - 16;
+        }
+    }
+    return i + _sdsRspanScalar(p, len - i, cs);
+}
+
+__attribute__((target("avx2")))
+static const char *_sdsFindByteAvx2(const char *p, const char *end, char c) {
+    __m256i needle = _mm256_set1_epi8(c);
+
+    while (end - p >= 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)p);
+        unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, needle));
+
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return _sdsFindByteSse2(p, end, c);
+}
+
+__attribute__((target("avx2")))
+static void _sdsMapCaseAvx2(char *p, size_t len, char first) {
+    __m256i shift = _mm256_set1_epi8((char)(0x80 - first));
+    __m256i limit = _mm256_set1_epi8((char)(0x80 + 26));
+    __m256i flip = _mm256_set1_epi8(0x20);
+    size_t i;
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i m = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(x, shift));
+
+        _mm256_storeu_si256((__m256i *)(p + i), _mm256_xor_si256(x, _mm256_and_si256(m, flip)));
+    }
+    _sdsMapCaseSse2(p + i, len - i, first);
+}
+
+__attribute__((target("avx2")))
+static inline unsigned int _sdsCharsetMask32(__m256i x, const sdsCharset *cs) {
+    __m256i m = _mm256_setzero_si256();
+    size_t j;
+
+    for (j = 0; j < cs->n; j++) {
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, _mm256_set1_epi8(cs->chars[j])));
+    }
+    return _mm256_movemask_epi8(m);
+}
+
+__attribute__((target("avx2")))
+static size_t _sdsSpanAvx2(const char *p, size_t len, const sdsCharset *cs) {
+    size_t i = 0;
+
+    if (cs->n <= SDS_SIMD_MAX_CSET) {
+        for (; i + 32 <= len; i += 32) {
+            unsigned int mask = _sdsCharsetMask32(_mm256_loadu_si256((const __m256i *)(p + i)), cs);
+
+            if (mask != 0xffffffffU)
+                return i + __builtin_ctz(~mask);
+        }
+    }
+    return i + _sdsSpanSse2(p + i, len - i, cs);
+}
+
+__attribute__((target("avx2")))
+static size_t _sdsRspanAvx2(const char *p, size_t len, const sdsCharset *cs) {
+    size_t i = 0;
+
+    if (cs->n <= SDS_SIMD_MAX_CSET) {
+        for (; i + 32 <= len; i += 32) {
+            unsigned int mask = _sdsCharsetMask32(_mm256_loadu_si256((const __m256i *)(p + len - i - 32)), cs);
+
+            if (mask != 0xffffffffU)
+                return i + __builtin_clz(~mask);
+        }
+    }
+    return i + _sdsRspanSse2(p, len - i, cs);
+}
+
+#endif
+
+// 一组实现，整组切换，调用者不会看到不同实现混在一起
+typedef struct sdsSimdOps {
+    const char *name;
+    const char *(*findByte)(const char *p, const char *end, char c);
+    void (*mapCase)(char *p, size_t len, char first);
+    size_t (*span)(const char *p, size_t len, const sdsCharset *cs);
+    size_t (*rspan)(const char *p, size_t len, const sdsCharset *cs);
+} sdsSimdOps;
+
+static const sdsSimdOps sds_simd_scalar = {
+    "scalar", _sdsFindByteScalar, _sdsMapCaseScalar, _sdsSpanScalar, _sdsRspanScalar
+};
+#ifdef SDS_X86_DISPATCH
+static const sdsSimdOps sds_simd_sse2 = {
+    "sse2", _sdsFindByteSse2, _sdsMapCaseSse2, _sdsSpanSse2, _sdsRspanSse2
+};
+static const sdsSimdOps sds_simd_avx2 = {
+    "avx2", _sdsFindByteAvx2, _sdsMapCaseAvx2, _sdsSpanAvx2, _sdsRspanAvx2
+};
+#endif
+
+// 按CPU选择的实现，进程启动时设置一次，之后只读，多个线程可以同时使用
+static const sdsSimdOps *sds_simd_ops = &sds_simd_scalar;
+
+// sdsSimdForceScalar设置的覆盖，只对调用线程有效
+static __thread const sdsSimdOps *sds_simd_override;
+
+// 根据CPU选择实现
+static void _sdsSelectImpl(void) __attribute__((constructor));
+static void _sdsSelectImpl(void) {
+#ifdef SDS_X86_DISPATCH
+    __builtin_cpu_init();
+    sds_simd_ops = __builtin_cpu_supports("avx2") ? &sds_simd_avx2 : &sds_simd_sse2;
+#endif
+}
+
+static inline const sdsSimdOps *_sdsSimdOps(void) {
+    const sdsSimdOps *ops = sds_simd_override;
+
+    return ops ? ops : sds_simd_ops;
+}
+
+// 当前线程使用的实现，用于测试和基准输出
+const char *sdsSimdImpl(void) {
+    return _sdsSimdOps()->name;
+}
+
+/**
+ * 为测试强制当前线程使用标量实现，force为0时恢复按CPU选择，不影响其他线程
+ */
+void sdsSimdForceScalar(int force) {
+    sds_simd_override = force ? &sds_simd_scalar : NULL;
+}
+
+
+/*
+ * 只保留[start, end]区间内的字符串，原地移动，不重新分配内存
+ * 下标可以为负数，-1表示最后一个字符，超出范围时截到字符串两端
+ *
+ * @param s sds字符串
+ * @param start 起始下标
+ * @param end 结束下标（包括）
+ * @return
+ */
+void sdsrange(sds s, ssize_t start, ssize_t end) {
+    size_t newlen, len = sdslen(s);
+
+    if (len == 0)
+        return;
+    if (start < 0) {
+        start += len;
+        if (start < 0)
+            start = 0;
+    }
+    if (end < 0) {
+        end += len;
+        if (end < 0)
+            end = 0;
+    }
+    newlen = (start > end) ? 0 : (end - start) + 1;
+    if (newlen != 0) {
+        if (start >= (ssize_t)len) {
+            newlen = 0;
+        } else if (end >= (ssize_t)len) {
+            end = len - 1;
+            newlen = (end - start) + 1;
+        }
+    }
+    if (start && newlen)
+        memmove(s, s + start, newlen);
+    s[newlen] = '\0';
+    sdssetlen(s, newlen);
+}
+
+
+/*
+ * 去掉字符串两端所有属于cset的字符，原地移动，不重新分配内存
+ *
+ * @param s sds字符串
+ * @param cset 要去掉的字符集合，以'\0'结尾
+ * @return sds字符串
+ */
+sds sdstrim(sds s, const char *cset) {
+    size_t len = sdslen(s), left, right = 0, newlen;
+    sdsCharset cs;
+    const char *c;
+
+    const sdsSimdOps *ops = _sdsSimdOps();
+
+    memset(cs.map, 0, sizeof(cs.map));
+    for (c = cset; *c; c++) {
+        cs.map[(unsigned char)*c] = 1;
+    }
+    cs.chars = cset;
+    cs.n = c - cset;
+
+    left = ops->span(s, len, &cs);
+    if (left < len)
+        right = ops->rspan(s + left, len - left, &cs);
+    newlen = len - left - right;
+    if (left && newlen)
+        memmove(s, s + left, newlen);
+    s[newlen] = '\0';
+    sdssetlen(s, newlen);
+    return s;
+}
+
+
+/*
+ * 按分隔符分割字符串，分隔符可以有多个字节，是binary-safe的
+ * 连续的分隔符之间得到空字符串；len为0时返回空数组
+ *
+ * @param s 字符串
+ * @param len 字符串长度
+ * @param sep 分隔符
+ * @param seplen 分隔符长度
+ * @param count 得到的sds个数
+ * @return sds数组，用sdsfreesplitres释放；参数错误或内存不足时返回NULL
+ */
+sds *sdssplitlen(const char *s, ssize_t len, const char *sep, int seplen, int *count) {
+    int elements = 0, slots = 5;
+    const char *start = s, *p = s, *last;
+    const sdsSimdOps *ops = _sdsSimdOps();
+    sds *tokens;
+
+    if (seplen < 1 || len < 0)
+        return NULL;
+
+    tokens = zmalloc(sizeof(sds) * slots);
+    if (tokens == NULL)
+        return NULL;
+    if (len == 0) {
+        *count = 0;
+        return tokens;
+    }
+
+    // 分隔符的第一个字节只可能出现在[s, last)中
+    last = (len >= seplen) ? s + len - seplen + 1 : s;
+    while (p < last && (p = ops->findByte(p, last, sep[0])) != NULL) {
+        if (seplen > 1 && memcmp(p + 1, sep + 1, seplen - 1) != 0) {
+            p++;
+            continue;
+        }
+
+        // 为当前元素和最后一个元素留出位置
+        if (slots < elements + 2) {
+            sds *newtokens;
+
+            slots *= 2;
+            newtokens = zrealloc(tokens, sizeof(sds) * slots);
+            if (newtokens == NULL)
+                goto cleanup;
+            tokens = newtokens;
+        }
+        tokens[elements] = sdsnewlen(start, p - start);
+        if (tokens[elements] == NULL)
+            goto cleanup;
+        elements++;
+        p += seplen;
+        start = p;
+    }
+
+    tokens[elements] = sdsnewlen(start, s + len - start);
+    if (tokens[elements] == NULL)
+        goto cleanup;
+    elements++;
+    *count = elements;
+    return tokens;
+
+cleanup:
+    sdsfreesplitres(tokens, elements);
+    *count = 0;
+    return NULL;
+}
+
+
+/*
+ * 释放sdssplitlen返回的数组
+ *
+ * @param tokens sds数组
+ * @param count sds个数
+ * @return
+ */
+void sdsfreesplitres(sds *tokens, int count) {
+    if (!tokens)
+        return;
+    while (count--)
+        sdsfree(tokens[count]);
+    zfree(tokens);
+}
+
+
+/*
+ * 把ASCII大写字母转换为小写，其他字节不变，与locale无关
+ *
+ * @param s sds字符串
+ * @return
+ */
+void sdstolower(sds s) {
+    _sdsSimdOps()->mapCase(s, sdslen(s), 'A');
+}
+
+
+/*
+ * 把ASCII小写字母转换为大写，其他字节不变，与locale无关
+ *
+ * @param s sds字符串
+ * @return
+ */
+void sdstoupper(sds s) {
+    _sdsSimdOps()->mapCase(s, sdslen(s), 'a');
+}
+
+
+/*
+ * 把from中出现的字符替换为to中对应位置的字符，from中重复的字符以第一次出现为准
+ *
+ * @param s sds字符串
+ * @param from 要替换的字符
+ * @param to 替换后的字符
+ * @param setlen from和to的长度
+ * @return sds字符串
+ */
+sds sdsmapchars(sds s, const char *from, const char *to, size_t setlen) {
+    unsigned char map[256];
+    size_t j, len = sdslen(s);
+
+    for (j = 0; j < 256; j++) {
+        map[j] = j;
+    }
+    for (j = setlen; j > 0; j--) {
+        map[(unsigned char)from[j - 1]] = to[j - 1];
+    }
+    for (j = 0; j < len; j++) {
+        s[j] = map[(unsigned char)s[j]];
+    }
+    return s;
+}
+
+
 sds sdscatvprintf(sds s, const char *fmt, va_list ap) {
     va_list cpy;
     char staticbuf[1024], *buf = staticbuf, *t;
@@ -316,36 +1138,318 @@ sds sdscatprintf(sds s, const char *fmt, ...) {
     return t;
 }
 
-#define SDS_LLSTR_SIZE 21
+/*
+ * 格式化拼接字符串，只支持少数几种格式，不经过vsnprintf，直接写入sds
+ *   %s - C字符串
+ *   %S - sds字符串
+ *   %i - int
+ *   %I - long long
+ *   %u - unsigned int
+ *   %U - unsigned long long
+ *   %% - '%'字符
+ * 不支持宽度、精度等修饰符
+ *
+ * @param s sds字符串
+ * @param fmt 格式
+ * @return sds字符串
+ */
+sds sdscatfmt(sds s, const char *fmt, ...) {
+    const char *f = fmt;
+    size_t i = sdslen(s), alloc;
+    va_list ap;
+
+    // 预先为格式中的文字和较短的参数留出空间，减少扩充的次数
+    s = sdsMakeRoomFor(s, strlen(fmt) * 2);
+    if (s == NULL)
+        return NULL;
+    alloc = sdsalloc(s);
+
+    /* 长度只记在局部变量i中，扩充前才写回sds头部 */
+#define SDS_FMT_ROOM(l) do { \
+        if (alloc - i < (l)) { \
+            sdssetlen(s, i); \
+            s = sdsMakeRoomFor(s, (l)); \
+            if (s == NULL) \
+                goto fail; \
+            alloc = sdsalloc(s); \
+        } \
+    } while (0)
+
+    va_start(ap, fmt);
+    while (*f) {
+        const char *str;
+        size_t l;
+
+        // 一次拷贝到下一个'%'之前的所有文字
+        if (*f != '%') {
+            for (l = 1; f[l] && f[l] != '%'; l++);
+            SDS_FMT_ROOM(l);
+            memcpy(s + i, f, l);
+            i += l;
+            f += l;
+            continue;
+        }
+
+        f++;
+        switch (*f) {
+            case 's':
+            case 'S':
+                str = va_arg(ap, char *);
+                l = (*f == 's') ? strlen(str) : sdslen((sds)str);
+                SDS_FMT_ROOM(l);
+                memcpy(s + i, str, l);
+                i += l;
+                break;
+            case 'i':
+            case 'I':
+                SDS_FMT_ROOM(SDS_LLSTR_SIZE);
+                i += sdsll2str(s + i, (*f == 'i') ? va_arg(ap, int) : va_arg(ap, long long));
+                break;
+            case 'u':
+            case 'U':
+                SDS_FMT_ROOM(SDS_LLSTR_SIZE);
+                i += sdsull2str(s + i, (*f == 'u') ? va_arg(ap, unsigned int) : va_arg(ap, unsigned long long));
+                break;
+            case '\0':
+                // 格式以单独的'%'结尾
+                SDS_FMT_ROOM(1);
+                s[i++] = '%';
+                continue;
+            default:
+                // %%和不支持的格式原样输出该字符
+                SDS_FMT_ROOM(1);
+                s[i++] = *f;
+                break;
+        }
+        f++;
+    }
+#undef SDS_FMT_ROOM
+    va_end(ap);
+
+    sdssetlen(s, i);
+    s[i] = '\0';
+    return s;
+
+fail:
+    va_end(ap);
+    return NULL;
+}
+
+
+// 00到99的两位十进制数字，每次查表输出两位
+static const char sdsDigitPairs[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+
+/*
+ * 获取无符号整数的十进制位数
+ *
+ * @param v 整数
+ * @return 位数
+ */
+static inline int sdsDigits10(unsigned long long v) {
+    if (v < 10) return 1;
+    if (v < 100) return 2;
+    if (v < 1000) return 3;
+    if (v < 1000000000000ULL) {
+        if (v < 100000000ULL) {
+            if (v < 1000000) {
+                if (v < 10000) return 4;
+                return 5 + (v >= 100000);
+            }
+            return 7 + (v >= 10000000ULL);
+        }
+        if (v < 10000000000ULL) {
+            return 9 + (v >= 1000000000ULL);
+        }
+        return 11 + (v >= 100000000000ULL);
+    }
+    return 12 + sdsDigits10(v / 1000000000000ULL);
+}
+
+
+/*
+ * 无符号整数转换为字符串，先算出位数，再从后往前每次输出两位，不需要反转
+ *
+ * @param s 缓冲区，至少SDS_LLSTR_SIZE字节
+ * @param v 整数
+ * @return 字符串长度（不包括结尾的'\0'）
+ */
+int sdsull2str(char *s, unsigned long long v) {
+    int len = sdsDigits10(v);
+    char *p = s + len - 1;
+
+    s[len] = '\0';
+    while (v >= 100) {
+        int i = (v % 100) * 2;
+        v /= 100;
+        p[0] = sdsDigitPairs[i + 1];
+        p[-1] = sdsDigitPairs[i];
+        p -= 2;
+    }
+    if (v < 10) {
+        p[0] = '0' + v;
+    } else {
+        int i = v * 2;
+        p[0] = sdsDigitPairs[i + 1];
+        p[-1] = sdsDigitPairs[i];
+    }
+    return len;
+}
+
+
+/*
+ * 有符号整数转换为字符串
+ *
+ * @param s 缓冲区，至少SDS_LLSTR_SIZE字节
+ * @param value 整数
+ * @return 字符串长度（不包括结尾的'\0'）
+ */
 int sdsll2str(char *s, long long value) {
-    char *p, aux;
     unsigned long long v;
-    size_t l;
-
-    /* Generate the string representation, this method produces
-     * an reversed string. */
-    v = (value < 0) ? -value : value;
-    p = s;
-    do {
-        *p++ = '0'+(v%10);
-        v /= 10;
-    } while(v);
-    if (value < 0) *p++ = '-';
-
-    /* Compute length and add null term. */
-    l = p-s;
-    *p = '\0';
-
-    /* Reverse the string. */
-    p--;
-    while(s < p) {
-        aux = *s;
-        *s = *p;
-        *p = aux;
-        s++;
-        p--;
-    }
-    return l;
+
+    if (value >= 0)
+        return sdsull2str(s, value);
+
+    // -(value+1)+1避免LLONG_MIN取反溢出
+    v = (unsigned long long)(-(value + 1)) + 1;
+    *s = '-';
+    return sdsull2str(s + 1, v) + 1;
+}
+
+
+/*
+ * 严格地把字符串转换为无符号整数
+ * 只接受十进制数字，不接受空白、正负号和多余的前导0，溢出时失败
+ *
+ * @param s 字符串
+ * @param slen 字符串长度
+ * @param value 转换结果，可以为NULL
+ * @return 成功返回1，失败返回0
+ */
+int string2ull(const char *s, size_t slen, unsigned long long *value) {
+    unsigned long long v;
+    size_t i;
+
+    if (slen == 0 || slen >= SDS_LLSTR_SIZE)
+        return 0;
+    if (slen == 1 && s[0] == '0') {
+        if (value != NULL) *value = 0;
+        return 1;
+    }
+    if (s[0] < '1' || s[0] > '9')
+        return 0;
+
+    v = s[0] - '0';
+    for (i = 1; i < slen; i++) {
+        unsigned int digit = (unsigned char)s[i] - '0';
+
+        if (digit > 9)
+            return 0;
+        if (v > (ULLONG_MAX - digit) / 10)
+            return 0;
+        v = v * 10 + digit;
+    }
+    if (value != NULL) *value = v;
+    return 1;
+}
+
+
+/*
+ * 严格地把字符串转换为有符号整数
+ * 格式与sdsll2str的输出相同：可选的'-'加上没有多余前导0的十进制数字，不接受"-0"
+ *
+ * @param s 字符串
+ * @param slen 字符串长度
+ * @param value 转换结果，可以为NULL
+ * @return 成功返回1，失败返回0
+ */
+int string2ll(const char *s, size_t slen, long long *value) {
+    unsigned long long v;
+
+    if (slen > 0 && s[0] == '-') {
+        if (!string2ull(s + 1, slen - 1, &v) || v == 0)
+            return 0;
+        if (v > (unsigned long long)LLONG_MAX + 1)
+            return 0;
+        if (value != NULL) *value = -(long long)(v - 1) - 1;
+        return 1;
+    }
+
+    if (!string2ull(s, slen, &v) || v > LLONG_MAX)
+        return 0;
+    if (value != NULL) *value = v;
+    return 1;
+}
+
+
+/*
+ * 严格地把字符串转换为浮点数
+ * 整个字符串都必须被解析，不接受前导空白、nan和超出范围的值
+ *
+ * @param s 字符串
+ * @param slen 字符串长度
+ * @param dp 转换结果，可以为NULL
+ * @return 成功返回1，失败返回0
+ */
+int string2d(const char *s, size_t slen, double *dp) {
+    char buf[SDS_DSTR_SIZE];
+    char *eptr;
+    double value;
+
+    if (slen == 0 || slen >= sizeof(buf) || isspace((unsigned char)s[0]))
+        return 0;
+    memcpy(buf, s, slen);
+    buf[slen] = '\0';
+
+    errno = 0;
+    value = strtod(buf, &eptr);
+    if ((size_t)(eptr - buf) != slen ||
+        (errno == ERANGE && (value == HUGE_VAL || value == -HUGE_VAL || value == 0)) ||
+        isnan(value))
+        return 0;
+    if (dp != NULL) *dp = value;
+    return 1;
+}
+
+
+/*
+ * 在sds末尾直接写入有符号整数，不经过临时缓冲区
+ *
+ * @param s sds字符串
+ * @param value 整数
+ * @return sds字符串
+ */
+sds sdscatll(sds s, long long value) {
+    size_t curlen = sdslen(s);
+
+    s = sdsMakeRoomFor(s, SDS_LLSTR_SIZE);
+    if (s == NULL)
+        return NULL;
+    sdssetlen(s, curlen + sdsll2str(s + curlen, value));
+    return s;
+}
+
+
+/*
+ * 在sds末尾直接写入无符号整数，不经过临时缓冲区
+ *
+ * @param s sds字符串
+ * @param value 整数
+ * @return sds字符串
+ */
+sds sdscatull(sds s, unsigned long long value) {
+    size_t curlen = sdslen(s);
+
+    s = sdsMakeRoomFor(s, SDS_LLSTR_SIZE);
+    if (s == NULL)
+        return NULL;
+    sdssetlen(s, curlen + sdsull2str(s + curlen, value));
+    return s;
 }
 
 
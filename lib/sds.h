@@ -7,7 +7,11 @@
 
 
 #define SDS_MAX_PREALLOC (1024*1024)
-const char *SDS_NOINIT;
+// sdsll2str/sdsull2str需要的缓冲区大小，包括符号和结尾的'\0'
+#define SDS_LLSTR_SIZE 21
+// string2d能解析的最大长度（不包括结尾的'\0'）
+#define SDS_DSTR_SIZE 128
+extern const char *SDS_NOINIT;
 
 typedef char *sds;
 
@@ -22,6 +26,15 @@ typedef char *sds;
         char buf[]; \
     };
 
+/*
+ * 短字符串的头部只有一个字节：低3位是类型，高5位是长度
+ * 没有alloc字段，不能预留空间，拼接时会升级为SDS_TYPE_8
+ */
+struct __attribute__ ((__packed__)) sdshdr5 {
+    unsigned char flags;
+    char buf[];
+};
+
 /*
  * 定义四种类型sds头部结构
  */
@@ -30,20 +43,30 @@ SDS_STRUCT(16)
 SDS_STRUCT(32)
 SDS_STRUCT(64)
 
+#define SDS_TYPE_5  0
 #define SDS_TYPE_8  1
 #define SDS_TYPE_16 2
 #define SDS_TYPE_32 3
 #define SDS_TYPE_64 4
 #define SDS_TYPE_MASK 7
+#define SDS_TYPE_BITS 3
+#define SDS_TYPE_5_LEN(f) ((f) >> SDS_TYPE_BITS)
+// 内存由mmap分配，SDS_TYPE_5没有这个标志（flags的高5位是长度）
+#define SDS_FLAG_MMAP 8
+
+// 创建或扩充后达到这个大小（包括头部）的字符串改用mmap/mremap，见sdsSetMmapGrowth
+#define SDS_MMAP_THRESHOLD (64*1024*1024)
 
 #define SIZEOF_SDS_HDR(T) (sizeof(struct sdshdr##T))
 #define SDS_HDR(T, s) ((struct sdshdr##T *)((s) - SIZEOF_SDS_HDR(T)))
-#define SDS_HDR_VAR(T, s) struct sdshdr##T *sh = (void*)((s) - SIZEOF_SDS_HDR(T));
+#define SDS_HDR_VAR(T, s) struct sdshdr##T *sh = (struct sdshdr##T *)((s) - SIZEOF_SDS_HDR(T));
 
 
 static inline size_t sdslen(const sds s) {
     unsigned char flags = s[-1];
     switch (flags & SDS_TYPE_MASK) {
+        case SDS_TYPE_5:
+            return SDS_TYPE_5_LEN(flags);
         case SDS_TYPE_8:
             return SDS_HDR(8, s)->len;
         case SDS_TYPE_16:
@@ -60,6 +83,9 @@ static inline size_t sdslen(const sds s) {
 static inline size_t sdssetlen(sds s, size_t newlen) {
     unsigned char flags = s[-1];
     switch (flags & SDS_TYPE_MASK) {
+        case SDS_TYPE_5:
+            ((unsigned char *)s)[-1] = SDS_TYPE_5 | (newlen << SDS_TYPE_BITS);
+            return newlen;
         case SDS_TYPE_8:
             return SDS_HDR(8, s)->len = newlen;
         case SDS_TYPE_16:
@@ -76,6 +102,8 @@ static inline size_t sdssetlen(sds s, size_t newlen) {
 static inline size_t sdsalloc(const sds s) {
     unsigned char flags = s[-1];
     switch (flags & SDS_TYPE_MASK) {
+        case SDS_TYPE_5:
+            return SDS_TYPE_5_LEN(flags);
         case SDS_TYPE_8:
             return SDS_HDR(8, s)->alloc;
         case SDS_TYPE_16:
@@ -92,6 +120,9 @@ static inline size_t sdsalloc(const sds s) {
 static inline size_t sdssetalloc(sds s, size_t newlen) {
     unsigned char flags = s[-1];
     switch (flags & SDS_TYPE_MASK) {
+        case SDS_TYPE_5:
+            // 没有alloc字段
+            return SDS_TYPE_5_LEN(flags);
         case SDS_TYPE_8:
             return SDS_HDR(8, s)->alloc = newlen;
         case SDS_TYPE_16:
@@ -108,6 +139,8 @@ static inline size_t sdssetalloc(sds s, size_t newlen) {
 static inline size_t sdsavail(const sds s) {
     unsigned char flags = s[-1];
     switch (flags & SDS_TYPE_MASK) {
+        case SDS_TYPE_5:
+            return 0;
         case SDS_TYPE_8: {
             SDS_HDR_VAR(8, s);
             return sh->alloc - sh->len;
@@ -132,6 +165,8 @@ static inline size_t sdsavail(const sds s) {
 sds sdsnewlen(const void *init, size_t initlen);
 sds sdsnew(const char *init);
 sds sdsempty(void);
+size_t sdsembedsize(size_t initlen);
+sds sdsembed(void *buf, const void *init, size_t initlen);
 void sdsfree(sds s);
 sds sdscatlen(sds s, const void *t, size_t len);
 sds sdscat(sds s, const char *t);
@@ -139,6 +174,23 @@ sds sdscatsds(sds s, const sds t);
 sds sdscpylen(sds s, const char *t, size_t len);
 sds sdscpy(sds s, const char *t);
 
+void sdsrange(sds s, ssize_t start, ssize_t end);
+sds sdstrim(sds s, const char *cset);
+sds *sdssplitlen(const char *s, ssize_t len, const char *sep, int seplen, int *count);
+void sdsfreesplitres(sds *tokens, int count);
+void sdstolower(sds s);
+void sdstoupper(sds s);
+sds sdsmapchars(sds s, const char *from, const char *to, size_t setlen);
+const char *sdsSimdImpl(void);
+void sdsSimdForceScalar(int force);
+
+sds sdsMakeRoomFor(sds s, size_t addlen);
+sds sdsMakeRoomForNonGreedy(sds s, size_t addlen);
+sds sdsResize(sds s, size_t size);
+sds sdsRemoveFreeSpace(sds s);
+size_t sdsAllocSize(sds s);
+void sdsSetMmapGrowth(int enable);
+
 sds sdscatvprintf(sds s, const char *fmt, va_list ap);
 #ifdef __GNUC__
 /*
@@ -150,6 +202,16 @@ sds sdscatprintf(sds s, const char *fmt, ...)
 sds sdscatprintf(sds s, const char *fmt, ...);
 #endif
 
+sds sdscatfmt(sds s, const char *fmt, ...);
+
 sds sdsfromlonglong(long long value);
+sds sdscatll(sds s, long long value);
+sds sdscatull(sds s, unsigned long long value);
+
+int sdsll2str(char *s, long long value);
+int sdsull2str(char *s, unsigned long long v);
+int string2ll(const char *s, size_t slen, long long *value);
+int string2ull(const char *s, size_t slen, unsigned long long *value);
+int string2d(const char *s, size_t slen, double *dp);
 
 #endif
\ No newline at end of file
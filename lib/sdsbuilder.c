@@ -0,0 +1,157 @@
+#include <string.h>
+
+#include "sdsbuilder.h"
+#include "zmalloc.h"
+
+
+/**
+ * 初始化
+ * @param  b          构造器
+ * @param  chunksize  块大小，为0时使用SDS_BUILDER_CHUNK
+ */
+void sdsbuilderInit(sdsbuilder *b, size_t chunksize) {
+    b->chunks = NULL;
+    b->nchunks = 0;
+    b->slots = 0;
+    b->chunksize = chunksize ? chunksize : SDS_BUILDER_CHUNK;
+    b->head = 0;
+    b->tail = 0;
+    b->len = 0;
+}
+
+// 在末尾添加一个空块
+static int _sdsbuilderAddChunk(sdsbuilder *b) {
+    char *chunk;
+
+    if (b->nchunks == b->slots) {
+        size_t slots = b->slots ? b->slots * 2 : 8;
+        char **chunks = zrealloc(b->chunks, slots * sizeof(char *));
+
+        if (chunks == NULL)
+            return 0;
+        b->chunks = chunks;
+        b->slots = slots;
+    }
+    chunk = zmalloc(b->chunksize);
+    if (chunk == NULL)
+        return 0;
+    b->chunks[b->nchunks++] = chunk;
+    b->tail = 0;
+    return 1;
+}
+
+/**
+ * 追加数据，已经写入的数据不会移动
+ * @param  b    构造器
+ * @param  t    数据
+ * @param  len  长度
+ * @return      成功返回1，内存不足返回0（已经追加的部分保留）
+ */
+int sdsbuilderAppend(sdsbuilder *b, const void *t, size_t len) {
+    const char *p = t;
+
+    while (len > 0) {
+        size_t n;
+
+        if (b->nchunks == 0 || b->tail == b->chunksize) {
+            if (!_sdsbuilderAddChunk(b))
+                return 0;
+        }
+        n = b->chunksize - b->tail;
+        if (n > len)
+            n = len;
+        memcpy(b->chunks[b->nchunks - 1] + b->tail, p, n);
+        b->tail += n;
+        b->len += n;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+/**
+ * 把所有数据拷贝到一个新的sds中，然后清空构造器
+ * 达到SDS_MMAP_THRESHOLD时sds由mmap分配，之后的拼接不需要再拷贝整个字符串
+ * @param  b  构造器
+ * @return    sds字符串，内存不足时返回NULL，构造器不变
+ */
+sds sdsbuilderFlatten(sdsbuilder *b) {
+    sds s = sdsnewlen(SDS_NOINIT, b->len);
+    size_t i, off = 0;
+
+    if (s == NULL)
+        return NULL;
+    for (i = 0; i < b->nchunks; i++) {
+        size_t start = (i == 0) ? b->head : 0;
+        size_t end = (i == b->nchunks - 1) ? b->tail : b->chunksize;
+
+        memcpy(s + off, b->chunks[i] + start, end - start);
+        off += end - start;
+    }
+    sdsbuilderReset(b);
+    return s;
+}
+
+/**
+ * 填充iovec数组，按顺序指向还没有被丢掉的数据，可以直接交给writev
+ * @param  b       构造器
+ * @param  iov     iovec数组
+ * @param  iovcnt  数组长度
+ * @return         填充的个数，数据多于iovcnt块时只填充前iovcnt块
+ */
+int sdsbuilderIovec(const sdsbuilder *b, struct iovec *iov, int iovcnt) {
+    size_t i;
+    int n = 0;
+
+    for (i = 0; i < b->nchunks && n < iovcnt; i++) {
+        size_t start = (i == 0) ? b->head : 0;
+        size_t end = (i == b->nchunks - 1) ? b->tail : b->chunksize;
+
+        if (end == start)
+            continue;
+        iov[n].iov_base = b->chunks[i] + start;
+        iov[n].iov_len = end - start;
+        n++;
+    }
+    return n;
+}
+
+/**
+ * 从头部丢掉n字节，通常是writev已经写出的字节数，读完的块被释放
+ * @param  b  构造器
+ * @param  n  字节数，超过剩余长度时全部丢掉
+ */
+void sdsbuilderConsume(sdsbuilder *b, size_t n) {
+    size_t drop = 0;
+
+    if (n >= b->len) {
+        sdsbuilderReset(b);
+        return;
+    }
+    b->len -= n;
+    n += b->head;
+    // 除最后一块外，读完的块直接释放；剩余数据至少还有1字节，最后一块不会被读完
+    while (drop < b->nchunks - 1 && n >= b->chunksize) {
+        zfree(b->chunks[drop++]);
+        n -= b->chunksize;
+    }
+    if (drop) {
+        memmove(b->chunks, b->chunks + drop, (b->nchunks - drop) * sizeof(char *));
+        b->nchunks -= drop;
+    }
+    b->head = n;
+}
+
+/**
+ * 释放所有块，构造器可以继续使用
+ * @param  b  构造器
+ */
+void sdsbuilderReset(sdsbuilder *b) {
+    size_t i;
+
+    for (i = 0; i < b->nchunks; i++) {
+        zfree(b->chunks[i]);
+    }
+    zfree(b->chunks);
+    sdsbuilderInit(b, b->chunksize);
+}
@@ -0,0 +1,51 @@
+#ifndef __SDSBUILDER_H__
+#define __SDSBUILDER_H__
+
+#include <sys/uio.h>
+
+#include "sds.h"
+
+/*
+ * 分块构造很大的字符串
+ *
+ * 用sdscatlen一点点拼出几百MB的字符串时，每次扩充都可能由zrealloc拷贝整个缓冲区。
+ * sdsbuilder把追加的数据放到固定大小的块中，已经写入的数据不会再移动：
+ *   - 需要一个sds时用sdsbuilderFlatten一次性拷贝出来
+ *   - 只是要写到文件或者socket时用sdsbuilderIovec得到iovec数组交给writev，
+ *     再用sdsbuilderConsume丢掉已经写出的数据，整个过程不需要拼成连续的内存
+ */
+
+// 默认的块大小
+#define SDS_BUILDER_CHUNK (1024*1024)
+
+typedef struct sdsbuilder {
+    // 块数组，除最后一块外都是写满的
+    char **chunks;
+    size_t nchunks;
+    size_t slots;
+
+    // 每块的大小
+    size_t chunksize;
+
+    // 第一块中已经被sdsbuilderConsume丢掉的字节数
+    size_t head;
+
+    // 最后一块中已经写入的字节数
+    size_t tail;
+
+    // 还没有被丢掉的总字节数
+    size_t len;
+} sdsbuilder;
+
+#define sdsbuilderLen(b) ((b)->len)
+
+
+/* ------------------------------- APIs ------------------------------------*/
+void sdsbuilderInit(sdsbuilder *b, size_t chunksize);
+int sdsbuilderAppend(sdsbuilder *b, const void *t, size_t len);
+sds sdsbuilderFlatten(sdsbuilder *b);
+int sdsbuilderIovec(const sdsbuilder *b, struct iovec *iov, int iovcnt);
+void sdsbuilderConsume(sdsbuilder *b, size_t n);
+void sdsbuilderReset(sdsbuilder *b);
+
+#endif
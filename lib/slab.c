@@ -0,0 +1,92 @@
+#include "slab.h"
+#include "zmalloc.h"
+
+
+/**
+ * 初始化slab池
+ * @param  pool     slab池
+ * @param  objsize  对象大小
+ */
+void slabPoolInit(slabPool *pool, size_t objsize) {
+    if (objsize < sizeof(void *)) {
+        objsize = sizeof(void *);
+    }
+    // 保证对象按指针大小对齐
+    objsize = (objsize + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    pool->objsize = objsize;
+    pool->freelist = NULL;
+    pool->slabs = NULL;
+    pool->unsliced = 0;
+    pool->capacity = 0;
+    pool->slabcount = 0;
+    pool->used = 0;
+}
+
+
+/**
+ * 分配一个对象，优先复用空闲链表
+ * @param  pool  slab池
+ * @return       对象指针，内存不足时为NULL
+ */
+void *slabAlloc(slabPool *pool) {
+    void *obj;
+
+    if (pool->freelist) {
+        obj = pool->freelist;
+        pool->freelist = *(void **)obj;
+        pool->used++;
+        return obj;
+    }
+
+    if (pool->unsliced == 0) {
+        size_t count = pool->capacity ? pool->capacity * 2 : SLAB_MIN_OBJECTS;
+        slab *s;
+
+        if (count > SLAB_MAX_OBJECTS) {
+            count = SLAB_MAX_OBJECTS;
+        }
+        s = zmalloc(sizeof(*s) + count * pool->objsize);
+        if (s == NULL) {
+            return NULL;
+        }
+        s->next = pool->slabs;
+        pool->slabs = s;
+        pool->capacity = count;
+        pool->unsliced = count;
+        pool->slabcount++;
+    }
+
+    obj = pool->slabs->data + (pool->capacity - pool->unsliced) * pool->objsize;
+    pool->unsliced--;
+    pool->used++;
+    return obj;
+}
+
+
+/**
+ * 释放一个对象到空闲链表
+ * @param  pool  slab池
+ * @param  obj   由slabAlloc分配的对象
+ */
+void slabFree(slabPool *pool, void *obj) {
+    *(void **)obj = pool->freelist;
+    pool->freelist = obj;
+    pool->used--;
+}
+
+
+/**
+ * 一次性释放所有slab，池中的对象全部失效
+ * @param  pool  slab池
+ */
+void slabPoolRelease(slabPool *pool) {
+    slab *s = pool->slabs, *next;
+
+    while (s) {
+        next = s->next;
+        zfree(s);
+        s = next;
+    }
+    slabPoolInit(pool, pool->objsize);
+}
@@ -0,0 +1,49 @@
+#ifndef __SLAB_H__
+#define __SLAB_H__
+
+#include <stddef.h>
+
+/*
+ * 固定大小对象的slab池
+ *
+ * 对象从成批分配的slab中切分，释放的对象挂到空闲链表上供下次分配复用，
+ * 只有slabPoolRelease才会把内存还给分配器。
+ * 适合大量小对象频繁增删的场景（例如dictEntry），避免每个对象一次malloc。
+ */
+
+// 第一个slab容纳的对象数，之后每个slab翻倍，直到SLAB_MAX_OBJECTS
+#define SLAB_MIN_OBJECTS 16
+#define SLAB_MAX_OBJECTS 1024
+
+typedef struct slab {
+    struct slab *next;
+    char data[];
+} slab;
+
+typedef struct slabPool {
+    // 对象大小，至少为一个指针
+    size_t objsize;
+
+    // 空闲对象链表，链表指针存放在对象的开头
+    void *freelist;
+
+    // 所有slab组成的链表，最新的在表头
+    slab *slabs;
+
+    // 最新slab中尚未切分的对象数量及其容量
+    size_t unsliced;
+    size_t capacity;
+
+    // 已分配的slab数量
+    size_t slabcount;
+
+    // 使用中的对象数量
+    size_t used;
+} slabPool;
+
+void slabPoolInit(slabPool *pool, size_t objsize);
+void *slabAlloc(slabPool *pool);
+void slabFree(slabPool *pool, void *obj);
+void slabPoolRelease(slabPool *pool);
+
+#endif
@@ -2,6 +2,7 @@
 #define __ZMALLOC_H__
 
 #include <malloc.h>
+#include <stdlib.h>
 
 #ifndef zrealloc
 #define zrealloc realloc
@@ -11,8 +12,27 @@
 #define zmalloc malloc
 #endif
 
+#ifndef zcalloc
+#define zcalloc calloc
+#endif
+
 #ifndef zfree
 #define zfree free
 #endif
 
+// 分配器实际给出的可用字节数，可能大于申请的大小
+#ifndef zmalloc_usable_size
+#define zmalloc_usable_size malloc_usable_size
+#endif
+
+// 按align字节对齐分配（align为2的幂且是指针大小的倍数），用zfree释放
+static inline void *zmalloc_aligned(size_t align, size_t size) {
+    void *ptr;
+
+    if (posix_memalign(&ptr, align, size) != 0) {
+        return NULL;
+    }
+    return ptr;
+}
+
 #endif
\ No newline at end of file
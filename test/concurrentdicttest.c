@@ -0,0 +1,111 @@
+#include <pthread.h>
+#include <CUnit/CUnit.h>
+
+#include "concurrentdict.h"
+#include "testcases.h"
+
+#define CONCURRENT_THREADS 4
+#define CONCURRENT_KEYS 20000
+
+
+// 整数直接作为键指针
+static uint64_t intHashCallback(const void *key) {
+    return dictGenHashFunction(&key, sizeof(key));
+}
+
+static dictType intKeyType = {intHashCallback, NULL, NULL, NULL, NULL, NULL};
+
+typedef struct concurrentTestArg {
+    concurrentDict *cd;
+    long id;
+    long errors;
+} concurrentTestArg;
+
+
+// 写者：添加自己范围内的键，再删除其中的一半
+static void *writerThread(void *privdata) {
+    concurrentTestArg *arg = privdata;
+    long j, base = arg->id * CONCURRENT_KEYS + 1;
+
+    for (j = 0; j < CONCURRENT_KEYS; j++) {
+        if (concurrentDictAdd(arg->cd, (void *)(base + j), (void *)(base + j)) != DICT_OK) {
+            arg->errors++;
+        }
+    }
+    for (j = 0; j < CONCURRENT_KEYS; j += 2) {
+        if (concurrentDictDelete(arg->cd, (void *)(base + j)) != DICT_OK) {
+            arg->errors++;
+        }
+    }
+    return NULL;
+}
+
+// 读者：反复查找所有写者的键，找到时值必须与键相同
+static void *readerThread(void *privdata) {
+    concurrentTestArg *arg = privdata;
+    long round, j;
+
+    for (round = 0; round < 3; round++) {
+        for (j = 1; j <= CONCURRENT_THREADS * CONCURRENT_KEYS; j++) {
+            void *val = NULL;
+            if (concurrentDictFind(arg->cd, (void *)j, &val) == DICT_OK && val != (void *)j) {
+                arg->errors++;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void countCallback(void *privdata, const dictEntry *de) {
+    long *count = privdata;
+
+    if (dictGetKey(de) == dictGetVal(de)) {
+        (*count)++;
+    }
+}
+
+
+void concurrentDictTest(void) {
+    pthread_t writers[CONCURRENT_THREADS], readers[CONCURRENT_THREADS];
+    concurrentTestArg wargs[CONCURRENT_THREADS], rargs[CONCURRENT_THREADS];
+    concurrentDict *cd = concurrentDictCreate(&intKeyType, NULL, 4);
+    long i, j, count = 0;
+    void *val;
+
+    CU_ASSERT_PTR_NULL(concurrentDictCreate(&intKeyType, NULL, CONCURRENTDICT_MAX_SHARD_BITS + 1));
+    CU_ASSERT_PTR_NOT_NULL(cd);
+
+    for (i = 0; i < CONCURRENT_THREADS; i++) {
+        wargs[i].cd = rargs[i].cd = cd;
+        wargs[i].id = rargs[i].id = i;
+        wargs[i].errors = rargs[i].errors = 0;
+        pthread_create(&writers[i], NULL, writerThread, &wargs[i]);
+        pthread_create(&readers[i], NULL, readerThread, &rargs[i]);
+    }
+    for (i = 0; i < CONCURRENT_THREADS; i++) {
+        pthread_join(writers[i], NULL);
+        pthread_join(readers[i], NULL);
+        CU_ASSERT_EQUAL(wargs[i].errors, 0);
+        CU_ASSERT_EQUAL(rargs[i].errors, 0);
+    }
+
+    // 每个写者留下奇数位置的一半键
+    CU_ASSERT_EQUAL(concurrentDictSize(cd), CONCURRENT_THREADS * CONCURRENT_KEYS / 2);
+    for (j = 1; j <= CONCURRENT_THREADS * CONCURRENT_KEYS; j++) {
+        int expected = (j - 1) % 2 == 1 ? DICT_OK : DICT_ERR;
+        CU_ASSERT_EQUAL(concurrentDictFind(cd, (void *)j, &val), expected);
+    }
+    CU_ASSERT_EQUAL(concurrentDictAdd(cd, (void *)2, NULL), DICT_ERR);
+
+    concurrentDictForEach(cd, countCallback, &count);
+    CU_ASSERT_EQUAL(count, CONCURRENT_THREADS * CONCURRENT_KEYS / 2);
+
+    // 完成所有分片的rehash后内容不变
+    while (concurrentDictRehashMilliseconds(cd, 100));
+    for (i = 0; i < (1L << cd->shardbits); i++) {
+        CU_ASSERT_FALSE(dictIsRehashing(cd->shards[i].d));
+    }
+    CU_ASSERT_EQUAL(concurrentDictSize(cd), CONCURRENT_THREADS * CONCURRENT_KEYS / 2);
+
+    concurrentDictRelease(cd);
+}
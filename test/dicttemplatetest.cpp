@@ -0,0 +1,59 @@
+#include <string>
+#include <CUnit/CUnit.h>
+
+#include "dict.hpp"
+
+extern "C" {
+#include "testcases.h"
+}
+
+
+void dictTemplateTest(void) {
+    long j, count = 1000;
+
+    /* sds键，与C的dict互通 */
+    {
+        Dict<sds, long, SdsDictTraits> d;
+
+        for (j = 0; j < count; j++) {
+            /* 右值键直接移交给字典 */
+            CU_ASSERT_NOT_EQUAL(d.add(sdsfromlonglong(j), j), NULL);
+        }
+        CU_ASSERT_EQUAL(d.size(), (size_t)count);
+
+        /* 左值键由Traits::dup复制，调用者保留原来的键 */
+        sds key = sdsnew("extra");
+        CU_ASSERT_NOT_EQUAL(d.add(key, -1L), NULL);
+        CU_ASSERT_EQUAL(d.add(key, -2L), NULL);
+        CU_ASSERT_NOT_EQUAL(d.find(key)->key, key);
+        sdsfree(key);
+
+        for (j = 0; j < count; j++) {
+            sds k = sdsfromlonglong(j);
+            Dict<sds, long, SdsDictTraits>::Entry *e = d.find(k);
+            CU_ASSERT_NOT_EQUAL(e, NULL);
+            CU_ASSERT_STRING_EQUAL(e->key, k);
+            CU_ASSERT_EQUAL(e->val, j);
+            sdsfree(k);
+        }
+
+        for (j = 0; j < count; j += 2) {
+            sds k = sdsfromlonglong(j);
+            CU_ASSERT_TRUE(d.remove(k));
+            CU_ASSERT_FALSE(d.remove(k));
+            sdsfree(k);
+        }
+        CU_ASSERT_EQUAL(d.size(), (size_t)count / 2 + 1);
+    }
+
+    /* 值按移动方式插入 */
+    {
+        Dict<uint64_t, std::string> d;
+        std::string val(64, 'x');
+
+        CU_ASSERT_NOT_EQUAL(d.add((uint64_t)1, std::move(val)), NULL);
+        CU_ASSERT_TRUE(val.empty());
+        CU_ASSERT_EQUAL(d.find(1)->val.size(), (size_t)64);
+        CU_ASSERT_EQUAL(d.find(2), NULL);
+    }
+}
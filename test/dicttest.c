@@ -1,6 +1,8 @@
 #include <CUnit/CUnit.h>
 
 #include "dict.h"
+#include "oadict.h"
+#include "intdict.h"
 #include "sds.h"
 #include "testcases.h"
 
@@ -64,4 +66,745 @@ void dictTest(void) {
     }
 
     dictRelease(d);
-}
\ No newline at end of file
+}
+
+void oadictTest(void) {
+    long j, count = 1000;
+
+    oadict *d = oadictCreate(&type, NULL);
+
+    for (j = 0; j < count; j++) {
+        CU_ASSERT_EQUAL(
+            oadictAdd(d, sdsfromlonglong(j), (void*)j),
+            DICT_OK
+        );
+    }
+    CU_ASSERT_EQUAL(oadictSize(d), count);
+
+    /* 重复的键不能再次添加 */
+    sds dup = sdsfromlonglong(0);
+    CU_ASSERT_EQUAL(oadictAdd(d, dup, NULL), DICT_ERR);
+    sdsfree(dup);
+
+    for (j = 0; j < count; j++) {
+        sds key = sdsfromlonglong(j);
+        oadictEntry *de = oadictFind(d, key);
+        CU_ASSERT_NOT_EQUAL(de, NULL);
+        CU_ASSERT_STRING_EQUAL(dictGetKey(de), key);
+        CU_ASSERT_EQUAL(dictGetSignedIntegerVal(de), j);
+        sdsfree(key);
+    }
+
+    /* 删除偶数键，留下的墓碑不能截断奇数键的探测序列 */
+    for (j = 0; j < count; j += 2) {
+        sds key = sdsfromlonglong(j);
+        CU_ASSERT_EQUAL(oadictDelete(d, key), DICT_OK);
+        sdsfree(key);
+    }
+    CU_ASSERT_EQUAL(oadictSize(d), count / 2);
+
+    for (j = 0; j < count; j++) {
+        sds key = sdsfromlonglong(j);
+        oadictEntry *de = oadictFind(d, key);
+        if (j % 2) {
+            CU_ASSERT_NOT_EQUAL(de, NULL);
+        } else {
+            CU_ASSERT_EQUAL(de, NULL);
+        }
+        sdsfree(key);
+    }
+
+    /* 反复增删，触发原地清理墓碑 */
+    for (j = count; j < count * 10; j++) {
+        CU_ASSERT_EQUAL(oadictAdd(d, sdsfromlonglong(j), (void*)j), DICT_OK);
+        sds key = sdsfromlonglong(j);
+        CU_ASSERT_EQUAL(oadictDelete(d, key), DICT_OK);
+        sdsfree(key);
+    }
+    CU_ASSERT_EQUAL(oadictSize(d), count / 2);
+
+    oadictRelease(d);
+
+    /* 缩小到刚好放得下的新表（448个节点，512个槽位），rehash期间继续插入，新表不能被写满 */
+    d = oadictCreate(&type, NULL);
+    for (j = 0; j < count * 2; j++) {
+        oadictAdd(d, sdsfromlonglong(j), (void*)j);
+    }
+    for (j = 448; j < count * 2; j++) {
+        sds key = sdsfromlonglong(j);
+        oadictDelete(d, key);
+        sdsfree(key);
+    }
+    CU_ASSERT_EQUAL(oadictExpand(d, 448), DICT_OK);
+    CU_ASSERT_EQUAL(d->ht[1].size, 512);
+    for (j = count * 2; j < count * 4; j++) {
+        CU_ASSERT_EQUAL(oadictAdd(d, sdsfromlonglong(j), (void*)j), DICT_OK);
+        CU_ASSERT_TRUE(d->ht[0].growthLeft <= d->ht[0].size);
+        CU_ASSERT_TRUE(d->ht[1].growthLeft <= d->ht[1].size);
+    }
+    CU_ASSERT_EQUAL(oadictSize(d), 448 + count * 2);
+    for (j = 0; j < count * 4; j++) {
+        sds key = sdsfromlonglong(j);
+        oadictEntry *de = oadictFind(d, key);
+        if (j < 448 || j >= count * 2) {
+            CU_ASSERT_NOT_EQUAL(de, NULL);
+        } else {
+            CU_ASSERT_EQUAL(de, NULL);
+        }
+        sdsfree(key);
+    }
+    oadictRelease(d);
+}
+
+
+void dictFindManyTest(void) {
+    long j, count = 1000;
+    const void *keys[2 * 1000];
+    dictEntry *out[2 * 1000];
+
+    dict *d = dictCreate(&type, NULL);
+
+    for (j = 0; j < count; j++) {
+        dictAdd(d, sdsfromlonglong(j), (void*)j);
+    }
+    /* 查找时处于rehash状态，需要同时查找两个哈希表 */
+    if (!dictIsRehashing(d)) {
+        dictExpand(d, dictSize(d) * 4);
+    }
+    CU_ASSERT_TRUE(dictIsRehashing(d));
+
+    /* 前一半命中，后一半不存在 */
+    for (j = 0; j < 2 * count; j++) {
+        keys[j] = sdsfromlonglong(j);
+    }
+    CU_ASSERT_EQUAL(dictFindMany(d, keys, 2 * count, out), (size_t)count);
+
+    for (j = 0; j < 2 * count; j++) {
+        if (j < count) {
+            CU_ASSERT_NOT_EQUAL(out[j], NULL);
+            CU_ASSERT_STRING_EQUAL(dictGetKey(out[j]), keys[j]);
+            CU_ASSERT_EQUAL(dictGetSignedIntegerVal(out[j]), j);
+        } else {
+            CU_ASSERT_EQUAL(out[j], NULL);
+        }
+        sdsfree((sds)keys[j]);
+    }
+
+    dictRelease(d);
+}
+
+
+static void scanCallback(void *privdata, const dictEntry *de) {
+    int *seen = privdata;
+    seen[dictGetSignedIntegerVal(de)]++;
+}
+
+void dictScanTest(void) {
+    long j, count = 1000;
+    unsigned long cursor = 0;
+    int steps = 0;
+    int seen[4 * 1000] = {0};
+
+    dict *d = dictCreate(&type, NULL);
+
+    for (j = 0; j < count; j++) {
+        dictAdd(d, sdsfromlonglong(j), (void*)j);
+    }
+    while (dictRehash(d, 100));
+
+    do {
+        cursor = dictScan(d, cursor, scanCallback, seen);
+        steps++;
+
+        /* 遍历过程中扩大哈希表 */
+        if (steps == 50) {
+            for (j = count; j < 4 * count; j++) {
+                dictAdd(d, sdsfromlonglong(j), (void*)j);
+            }
+        }
+        /* 遍历过程中删除新加入的键，并缩小哈希表 */
+        if (steps == 500) {
+            for (j = count; j < 4 * count; j++) {
+                sds key = sdsfromlonglong(j);
+                dictDelete(d, key);
+                sdsfree(key);
+            }
+            while (dictRehash(d, 100));
+            dictExpand(d, dictSize(d));
+        }
+    } while (cursor != 0);
+
+    /* 整个遍历过程中一直存在的键至少返回一次 */
+    for (j = 0; j < count; j++) {
+        CU_ASSERT_TRUE(seen[j] >= 1);
+    }
+
+    dictRelease(d);
+}
+
+
+/* 每次dictDelete和dictFind最多执行一步rehash，dictRehash(d, 1)最多访问10个空桶，
+ * rehashidx的前进不超过这个值 */
+#define SHRINK_STEP_BUCKETS 10
+
+// rehash进行中时检查一次调用推进的桶数，开始或结束rehash的调用不计
+static void shrinkCheckStep(long before, long after) {
+    if (before != -1 && after != -1) {
+        CU_ASSERT_TRUE(after >= before);
+        CU_ASSERT_TRUE(after - before <= SHRINK_STEP_BUCKETS);
+    }
+}
+
+void dictShrinkTest(void) {
+    long j, count = 1000000, keep = count / 10, before, steps = 0;
+    unsigned long peak;
+
+    dict *d = dictCreate(&type, NULL);
+
+    for (j = 0; j < count; j++) {
+        dictAdd(d, sdsfromlonglong(j), (void*)j);
+    }
+    while (dictRehash(d, 100));
+    peak = d->ht[0].size;
+
+    /* 删除90%的键，缩小由删除操作触发，每次调用只推进一步rehash */
+    for (j = keep; j < count; j++) {
+        sds key = sdsfromlonglong(j);
+        before = d->rehashidx;
+        CU_ASSERT_EQUAL(dictDelete(d, key), DICT_OK);
+        shrinkCheckStep(before, d->rehashidx);
+        sdsfree(key);
+    }
+    CU_ASSERT_EQUAL(dictSize(d), keep);
+
+    /* 剩余的渐进式rehash由普通查找完成 */
+    for (j = 0; dictIsRehashing(d); j = (j + 1) % keep) {
+        sds key = sdsfromlonglong(j);
+        before = d->rehashidx;
+        CU_ASSERT_NOT_EQUAL(dictFind(d, key), NULL);
+        shrinkCheckStep(before, d->rehashidx);
+        sdsfree(key);
+        steps++;
+    }
+    // 推进是分散到多次查找中完成的
+    CU_ASSERT_TRUE(steps > 1);
+
+    CU_ASSERT_TRUE(d->ht[0].size <= peak / 4);
+    CU_ASSERT_TRUE(d->ht[0].size >= (unsigned long)keep);
+
+    /* 旧的桶数组已经释放，只剩下缩小后的表 */
+    CU_ASSERT_PTR_NULL(d->ht[1].table);
+    CU_ASSERT_EQUAL(d->ht[1].size, 0);
+
+    /* 关闭调整大小后dictResize失败 */
+    dictSetResizable(d, 0);
+    CU_ASSERT_EQUAL(dictResize(d), DICT_ERR);
+    dictSetResizable(d, 1);
+
+    dictRelease(d);
+}
+
+
+dictType pooledType = {
+    hashCallback,
+    NULL,
+    NULL,
+    compareCallback,
+    freeCallback,
+    NULL,
+    1
+};
+
+void dictPoolTest(void) {
+    long j, count = 10000;
+    size_t slabs;
+
+    dict *d = dictCreate(&pooledType, NULL);
+    CU_ASSERT_NOT_EQUAL(d->entryPool, NULL);
+
+    for (j = 0; j < count; j++) {
+        dictAdd(d, sdsfromlonglong(j), (void*)j);
+    }
+    CU_ASSERT_EQUAL(d->entryPool->used, (size_t)count);
+    slabs = d->entryPool->slabcount;
+
+    for (j = 0; j < count; j++) {
+        sds key = sdsfromlonglong(j);
+        CU_ASSERT_EQUAL(dictDelete(d, key), DICT_OK);
+        sdsfree(key);
+    }
+    CU_ASSERT_EQUAL(d->entryPool->used, 0);
+
+    /* 再次插入时复用空闲节点，不再分配新的slab */
+    for (j = 0; j < count; j++) {
+        dictAdd(d, sdsfromlonglong(j), (void*)j);
+    }
+    CU_ASSERT_EQUAL(d->entryPool->slabcount, slabs);
+
+    for (j = 0; j < count; j++) {
+        sds key = sdsfromlonglong(j);
+        dictEntry *de = dictFind(d, key);
+        CU_ASSERT_NOT_EQUAL(de, NULL);
+        CU_ASSERT_EQUAL(dictGetSignedIntegerVal(de), j);
+        sdsfree(key);
+    }
+
+    dictRelease(d);
+}
+
+
+size_t embedSizeCallback(const void *key) {
+    return sdsembedsize(sdslen((sds)key));
+}
+
+void *embedCallback(void *buf, const void *key) {
+    return sdsembed(buf, key, sdslen((sds)key));
+}
+
+dictType setType = {
+    hashCallback,
+    NULL,
+    NULL,
+    compareCallback,
+    freeCallback,
+    NULL,
+    1,
+    1,
+    NULL,
+    NULL
+};
+
+dictType embeddedSetType = {
+    hashCallback,
+    NULL,
+    NULL,
+    compareCallback,
+    NULL,
+    NULL,
+    0,
+    1,
+    embedSizeCallback,
+    embedCallback
+};
+
+void dictLayoutTest(void) {
+    long j, count = 1000;
+    dictType *types[] = {&setType, &embeddedSetType};
+    int t;
+
+    for (t = 0; t < 2; t++) {
+        dict *d = dictCreate(types[t], NULL);
+        int embedded = types[t]->keyEmbed != NULL;
+
+        for (j = 0; j < count; j++) {
+            sds key = sdsfromlonglong(j);
+            CU_ASSERT_EQUAL(dictAdd(d, key, NULL), DICT_OK);
+            /* 内嵌键的字典复制键，调用者保留原来的键 */
+            if (embedded) sdsfree(key);
+        }
+        CU_ASSERT_EQUAL(dictSize(d), count);
+
+        for (j = 0; j < count; j++) {
+            sds key = sdsfromlonglong(j);
+            dictEntry *de = dictFind(d, key);
+            CU_ASSERT_NOT_EQUAL(de, NULL);
+            CU_ASSERT_STRING_EQUAL(dictGetKey(de), key);
+            CU_ASSERT_EQUAL(sdslen(dictGetKey(de)), sdslen(key));
+            /* 键位于节点内部 */
+            if (embedded) {
+                char *k = dictGetKey(de);
+                CU_ASSERT_TRUE(k > (char *)de &&
+                    k < (char *)de + sizeof(dictEntryNoValue) + sdsembedsize(sdslen(key)));
+            }
+            sdsfree(key);
+        }
+
+        for (j = 0; j < count; j += 2) {
+            sds key = sdsfromlonglong(j);
+            CU_ASSERT_EQUAL(dictDelete(d, key), DICT_OK);
+            CU_ASSERT_EQUAL(dictFind(d, key), NULL);
+            sdsfree(key);
+        }
+        CU_ASSERT_EQUAL(dictSize(d), count / 2);
+
+        dictRelease(d);
+    }
+}
+
+
+void intdictTest(void) {
+    uint64_t j, count = 10000;
+
+    intdict *d = intdictCreate(NULL);
+
+    for (j = 0; j < count; j++) {
+        CU_ASSERT_EQUAL(intdictAdd(d, j * 0x10000, (void*)j), DICT_OK);
+    }
+    CU_ASSERT_EQUAL(intdictAdd(d, 0, NULL), DICT_ERR);
+    CU_ASSERT_EQUAL(intdictSize(d), count);
+
+    for (j = 0; j < count; j++) {
+        intdictEntry *de = intdictFind(d, j * 0x10000);
+        CU_ASSERT_NOT_EQUAL(de, NULL);
+        CU_ASSERT_EQUAL(dictGetUnsignedIntegerVal(de), j);
+        CU_ASSERT_EQUAL(intdictFind(d, j * 0x10000 + 1), NULL);
+    }
+
+    for (j = 0; j < count; j += 2) {
+        CU_ASSERT_EQUAL(intdictDelete(d, j * 0x10000), DICT_OK);
+    }
+    CU_ASSERT_EQUAL(intdictDelete(d, 0), DICT_ERR);
+    CU_ASSERT_EQUAL(intdictSize(d), count / 2);
+
+    intdictRelease(d);
+}
+
+
+void dictRandomTest(void) {
+    long j, count = 200, samples = 400000;
+    long hits[3][200];
+    dictEntry *des[64];
+    unsigned int n, i;
+    int v;
+    dict *d = dictCreate(&type, NULL);
+
+    CU_ASSERT_PTR_NULL(dictGetRandomKey(d));
+    CU_ASSERT_PTR_NULL(dictGetFairRandomKey(d));
+    CU_ASSERT_EQUAL(dictGetSomeKeys(d, des, 10), 0);
+
+    for (j = 0; j < count; j++) {
+        dictAdd(d, sdsfromlonglong(j), (void*)j);
+    }
+    while (dictIsRehashing(d)) {
+        dictRehashMilliseconds(d, 100);
+    }
+
+    // 统计每个键被选中的次数
+    memset(hits, 0, sizeof(hits));
+    for (j = 0; j < samples; j++) {
+        hits[0][dictGetSignedIntegerVal(dictGetRandomKey(d))]++;
+        hits[1][dictGetSignedIntegerVal(dictGetFairRandomKey(d))]++;
+    }
+    for (j = 0; j < samples / 20; j++) {
+        n = dictGetSomeKeys(d, des, 20);
+        CU_ASSERT_EQUAL(n, 20);
+        for (i = 0; i < n; i++) {
+            hits[2][dictGetSignedIntegerVal(des[i])]++;
+        }
+    }
+
+    // 期望每个键被选中samples/count次。dictGetRandomKey受链表长度影响，
+    // dictGetSomeKeys受相邻空桶数量影响，只要求每个键都能被选中且偏差在几倍以内；
+    // dictGetFairRandomKey要求均匀，允许的偏差超过6倍标准差
+    for (j = 0; j < count; j++) {
+        long expected = samples / count;
+        for (v = 0; v <= 2; v += 2) {
+            CU_ASSERT(hits[v][j] > expected / 8 && hits[v][j] < expected * 8);
+        }
+        CU_ASSERT(hits[1][j] > expected * 85 / 100 && hits[1][j] < expected * 115 / 100);
+    }
+
+    // rehash过程中采样到的节点都是有效的
+    for (j = count; j < count * 20; j++) {
+        dictAdd(d, sdsfromlonglong(j), (void*)j);
+        if (dictIsRehashing(d)) {
+            dictEntry *de = dictGetRandomKey(d);
+            CU_ASSERT_EQUAL(dictFind(d, dictGetKey(de)), de);
+            n = dictGetSomeKeys(d, des, 64);
+            CU_ASSERT(n > 0);
+            for (i = 0; i < n; i++) {
+                CU_ASSERT(dictGetSignedIntegerVal(des[i]) <= j);
+            }
+        }
+    }
+
+    // 请求数量超过字典大小时最多返回字典大小个节点
+    dictRelease(d);
+    d = dictCreate(&type, NULL);
+    for (j = 0; j < 10; j++) {
+        dictAdd(d, sdsfromlonglong(j), (void*)j);
+    }
+    CU_ASSERT(dictGetSomeKeys(d, des, 64) <= 10);
+    dictRelease(d);
+}
+
+
+void dictRehashSchedulerTest(void) {
+    long sizes[] = {100, 5000, 1000}, j;
+    dict *d[3];
+    dictRehashStats stats;
+    dictRehashScheduler *s = dictRehashSchedulerCreate(1000);
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        d[i] = dictCreate(&type, NULL);
+        dictSetRehashScheduler(d[i], s);
+        for (j = 0; j < sizes[i]; j++) {
+            dictAdd(d[i], sdsfromlonglong(j), (void*)j);
+        }
+        while (dictIsRehashing(d[i])) {
+            dictRehash(d[i], 100);
+        }
+        CU_ASSERT_EQUAL(dictExpand(d[i], sizes[i] * 4), DICT_OK);
+    }
+
+    // 开始rehash的字典自动登记
+    dictRehashSchedulerGetStats(s, &stats);
+    CU_ASSERT_EQUAL(stats.pendingDicts, 3);
+    CU_ASSERT_EQUAL(stats.pendingEntries, 6100);
+
+    // 释放的字典自动移除
+    dictRelease(d[0]);
+    dictRehashSchedulerGetStats(s, &stats);
+    CU_ASSERT_EQUAL(stats.pendingDicts, 2);
+    CU_ASSERT_EQUAL(stats.pendingEntries, 6000);
+
+    // 预算为0时每次tick只推进剩余节点最多的字典一步
+    s->budgetUs = 0;
+    CU_ASSERT(dictRehashSchedulerTick(s) > 0);
+    CU_ASSERT(d[1]->rehashidx > 0);
+    CU_ASSERT_EQUAL(d[2]->rehashidx, 0);
+
+    s->budgetUs = 1000000;
+    dictRehashSchedulerTick(s);
+    dictRehashSchedulerGetStats(s, &stats);
+    CU_ASSERT_EQUAL(stats.pendingDicts, 0);
+    CU_ASSERT_EQUAL(stats.pendingBuckets, 0);
+    CU_ASSERT_EQUAL(stats.completed, 2);
+    CU_ASSERT_EQUAL(stats.ticks, 2);
+    CU_ASSERT(stats.maxStepNs > 0 && stats.maxStepNs <= stats.totalNs);
+
+    for (i = 1; i < 3; i++) {
+        CU_ASSERT(!dictIsRehashing(d[i]));
+        CU_ASSERT_EQUAL(dictSize(d[i]), (unsigned long)sizes[i]);
+        for (j = 0; j < sizes[i]; j++) {
+            sds key = sdsfromlonglong(j);
+            dictEntry *de = dictFind(d[i], key);
+            CU_ASSERT(de != NULL && dictGetSignedIntegerVal(de) == j);
+            sdsfree(key);
+        }
+        dictRelease(d[i]);
+    }
+    dictRehashSchedulerRelease(s);
+}
+
+
+void dictIteratorTest(void) {
+    long j, count = 1000, visited;
+    char seen[1000];
+    dictIterator iter, *it;
+    dictEntry *de;
+    long long fingerprint;
+    long rehashidx;
+    dict *d = dictCreate(&type, NULL);
+
+    for (j = 0; j < count; j++) {
+        dictAdd(d, sdsfromlonglong(j), (void*)j);
+    }
+    while (dictIsRehashing(d)) {
+        dictRehash(d, 100);
+    }
+    dictExpand(d, count * 4);
+    dictRehash(d, 10);
+    CU_ASSERT(dictIsRehashing(d));
+
+    // 非安全迭代器不暂停rehash，可以调用只读的函数，两个表中的节点都能遍历到
+    memset(seen, 0, sizeof(seen));
+    visited = 0;
+    rehashidx = d->rehashidx;
+    dictInitIterator(&iter, d);
+    while ((de = dictNext(&iter)) != NULL) {
+        CU_ASSERT_EQUAL(d->iterators, 0);
+        CU_ASSERT_EQUAL(dictFindByHash(d, dictGetKey(de), dictHashKey(d, dictGetKey(de))), de);
+        seen[dictGetSignedIntegerVal(de)]++;
+        visited++;
+    }
+    dictResetIterator(&iter);
+    CU_ASSERT_EQUAL(visited, count);
+    CU_ASSERT_EQUAL(d->rehashidx, rehashidx);
+    for (j = 0; j < count; j++) {
+        CU_ASSERT_EQUAL(seen[j], 1);
+    }
+
+    // 修改字典会改变指纹，非安全迭代器释放时据此发现非法操作
+    fingerprint = dictFingerprint(d);
+    CU_ASSERT_EQUAL(fingerprint, dictFingerprint(d));
+    dictRehash(d, 1);
+    CU_ASSERT_NOT_EQUAL(fingerprint, dictFingerprint(d));
+
+    // 安全迭代器暂停rehash，可以删除当前节点，每个节点仍然只遍历一次
+    memset(seen, 0, sizeof(seen));
+    visited = 0;
+    rehashidx = d->rehashidx;
+    it = dictGetSafeIterator(d);
+    while ((de = dictNext(it)) != NULL) {
+        long v = dictGetSignedIntegerVal(de);
+
+        CU_ASSERT_EQUAL(d->iterators, 1);
+        seen[v]++;
+        visited++;
+        if (v % 2 == 0) {
+            CU_ASSERT_EQUAL(dictDelete(d, dictGetKey(de)), DICT_OK);
+        }
+    }
+    dictReleaseIterator(it);
+    CU_ASSERT_EQUAL(d->iterators, 0);
+    CU_ASSERT_EQUAL(d->rehashidx, rehashidx);
+    CU_ASSERT_EQUAL(visited, count);
+    CU_ASSERT_EQUAL(dictSize(d), (unsigned long)count / 2);
+    for (j = 0; j < count; j++) {
+        CU_ASSERT_EQUAL(seen[j], 1);
+    }
+
+    // 没有调用dictNext的迭代器可以直接释放
+    it = dictGetIterator(d);
+    dictReleaseIterator(it);
+    dictInitSafeIterator(&iter, d);
+    dictResetIterator(&iter);
+    CU_ASSERT_EQUAL(d->iterators, 0);
+
+    dictRelease(d);
+}
+
+
+void dictBulkLoadTest(void) {
+    long j, count = 5000;
+    void *keys[5000], *vals[5000];
+    int flags[] = {DICT_BULK_UNIQUE, DICT_BULK_UNIQUE | DICT_BULK_PARTITION};
+    int f;
+
+    for (f = 0; f < 2; f++) {
+        dict *d = dictCreate(&type, NULL);
+
+        // 先装载一半的键，表的大小一次到位
+        for (j = 0; j < count / 2; j++) {
+            keys[j] = sdsfromlonglong(j);
+            vals[j] = (void*)j;
+        }
+        CU_ASSERT_EQUAL(dictBulkLoad(d, keys, vals, count / 2, flags[f]), (size_t)count / 2);
+        CU_ASSERT(!dictIsRehashing(d));
+        CU_ASSERT_EQUAL(d->ht[0].size, 4096);
+
+        // 重叠的键被跳过，已有节点先迁移到扩充后的表
+        for (j = 0; j < count; j++) {
+            keys[j] = sdsfromlonglong(j + count / 4);
+            vals[j] = (void*)(j + count / 4);
+        }
+        CU_ASSERT_EQUAL(dictBulkLoad(d, keys, vals, count, flags[f] & ~DICT_BULK_UNIQUE),
+                        (size_t)(count - count / 4));
+        for (j = 0; j < count / 4; j++) {
+            sdsfree(keys[j]);
+        }
+        CU_ASSERT(!dictIsRehashing(d));
+        CU_ASSERT_EQUAL(d->ht[0].size, 8192);
+        CU_ASSERT_EQUAL(dictSize(d), (unsigned long)(count + count / 4));
+
+        for (j = 0; j < count + count / 4; j++) {
+            sds key = sdsfromlonglong(j);
+            dictEntry *de = dictFind(d, key);
+            CU_ASSERT(de != NULL && dictGetSignedIntegerVal(de) == j);
+            sdsfree(key);
+        }
+        dictRelease(d);
+    }
+}
+
+
+void dictTableAllocTest(void) {
+    unsigned long sizes[] = {1024, 256 * 1024, 1024 * 1024}, i, j;
+    int hugepages;
+
+    // 三种大小分别走zcalloc、mmap和对齐的大页映射
+    for (hugepages = 0; hugepages <= 1; hugepages++) {
+        dictSetTableHugePages(hugepages);
+        for (i = 0; i < 3; i++) {
+            dict *d = dictCreate(&type, NULL);
+            int zero = 1;
+
+            CU_ASSERT_EQUAL(dictExpand(d, sizes[i]), DICT_OK);
+            CU_ASSERT_EQUAL(d->ht[0].size, sizes[i]);
+            if (hugepages && sizes[i] * sizeof(dictEntry *) >= DICT_TABLE_HUGEPAGE_THRESHOLD) {
+                CU_ASSERT_EQUAL((uintptr_t)d->ht[0].table % DICT_HUGEPAGE_SIZE, 0);
+            }
+            for (j = 0; j < sizes[i]; j++) {
+                zero &= d->ht[0].table[j] == NULL;
+            }
+            CU_ASSERT(zero);
+
+            for (j = 0; j < 1000; j++) {
+                dictAdd(d, sdsfromlonglong(j), (void*)j);
+            }
+            // 缩小时释放大的桶数组
+            CU_ASSERT_EQUAL(dictResize(d), sizes[i] > 1024 ? DICT_OK : DICT_ERR);
+            while (dictIsRehashing(d)) {
+                dictRehash(d, 100);
+            }
+            CU_ASSERT_EQUAL(dictSize(d), 1000);
+            dictRelease(d);
+        }
+    }
+    dictSetTableHugePages(1);
+}
+
+
+void dictStatsTest(void) {
+    long j, count = 1000;
+    unsigned long sum, weighted;
+    dictStats stats;
+    char buf[4096];
+    int i;
+    dict *d = dictCreate(&type, NULL);
+
+    for (j = 0; j < count; j++) {
+        dictAdd(d, sdsfromlonglong(j), (void*)j);
+    }
+    while (dictIsRehashing(d)) {
+        dictRehash(d, 100);
+    }
+
+    // 链表长度分布覆盖所有桶和所有节点
+    dictGetStats(d, &stats, 0);
+    CU_ASSERT_EQUAL(stats.rehashidx, -1);
+    CU_ASSERT_EQUAL(stats.ht[0].used, (unsigned long)count);
+    CU_ASSERT_EQUAL(stats.ht[0].sampled, stats.ht[0].size);
+    CU_ASSERT_EQUAL(stats.ht[0].chainedEntries, (unsigned long)count);
+    CU_ASSERT_EQUAL(stats.ht[0].emptyBuckets, stats.ht[0].clvector[0]);
+    CU_ASSERT_EQUAL(stats.ht[0].tableBytes, stats.ht[0].size * sizeof(dictEntry *));
+    CU_ASSERT_EQUAL(stats.ht[1].size, 0);
+    sum = weighted = 0;
+    for (i = 0; i < DICT_STATS_VECTLEN; i++) {
+        sum += stats.ht[0].clvector[i];
+        weighted += i * stats.ht[0].clvector[i];
+    }
+    CU_ASSERT_EQUAL(sum, stats.ht[0].size);
+    CU_ASSERT_EQUAL(weighted, (unsigned long)count);
+    CU_ASSERT(stats.ht[0].maxChainLen >= 1 && stats.ht[0].clvector[stats.ht[0].maxChainLen] > 0);
+    CU_ASSERT(stats.ht[0].avgProbeLen >= 1 && stats.ht[0].avgProbeLen <= stats.ht[0].maxChainLen);
+    CU_ASSERT(stats.ht[0].avgChainLen >= 1 && stats.ht[0].avgChainLen <= stats.ht[0].maxChainLen);
+
+    // 抽样只统计指定数量的桶
+    dictGetStats(d, &stats, 16);
+    sum = 0;
+    for (i = 0; i < DICT_STATS_VECTLEN; i++) {
+        sum += stats.ht[0].clvector[i];
+    }
+    CU_ASSERT_EQUAL(stats.ht[0].sampled, 16);
+    CU_ASSERT_EQUAL(sum, 16);
+
+    // rehash进度和两个表的节点
+    dictExpand(d, count * 4);
+    dictRehash(d, 100);
+    dictGetStats(d, &stats, 0);
+    CU_ASSERT_EQUAL(stats.rehashidx, d->rehashidx);
+    CU_ASSERT(stats.rehashProgress > 0 && stats.rehashProgress < 1);
+    CU_ASSERT_EQUAL(stats.ht[0].chainedEntries + stats.ht[1].chainedEntries, (unsigned long)count);
+
+    CU_ASSERT_EQUAL(dictGetStatsMsg(buf, sizeof(buf), &stats), strlen(buf));
+    CU_ASSERT_PTR_NOT_NULL(strstr(buf, "Rehashing"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(buf, "Hash table 1 stats"));
+    // 缓冲区不够时截断
+    CU_ASSERT_EQUAL(dictGetStatsMsg(buf, 32, &stats), 31);
+    CU_ASSERT_EQUAL(strlen(buf), 31);
+
+    dictRelease(d);
+}
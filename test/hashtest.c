@@ -0,0 +1,185 @@
+#include <string.h>
+#include <strings.h>
+#include <CUnit/CUnit.h>
+
+#include "hash.h"
+#include "dict.h"
+#include "sds.h"
+#include "testcases.h"
+
+
+static uint64_t caseHashCallback(const void *key) {
+    return dictGenCaseHashFunction(key, sdslen((sds)key));
+}
+
+static int caseCompareCallback(void *privdata, const void *key1, const void *key2) {
+    DICT_NOTUSED(privdata);
+
+    return strcasecmp(key1, key2) == 0;
+}
+
+static void caseFreeCallback(void *privdata, void *val) {
+    DICT_NOTUSED(privdata);
+
+    sdsfree(val);
+}
+
+static dictType caseType = {
+    caseHashCallback,
+    NULL,
+    NULL,
+    caseCompareCallback,
+    caseFreeCallback,
+    NULL
+};
+
+
+void hashTest(void) {
+    uint8_t key[16], msg[64], saved[16];
+    const uint8_t zero[16] = {0};
+    int i;
+    dict *d;
+    sds k;
+
+    for (i = 0; i < 16; i++) key[i] = i;
+    for (i = 0; i < 64; i++) msg[i] = i;
+
+    // SipHash-2-4论文中的参考向量
+    CU_ASSERT_EQUAL(siphash24(msg, 0, key), 0x726fdb47dd0e0e31ULL);
+    CU_ASSERT_EQUAL(siphash24(msg, 8, key), 0x93f5f5799a932462ULL);
+    CU_ASSERT_EQUAL(siphash24(msg, 15, key), 0xa129ca6149be45e5ULL);
+
+    // XXH3-64参考实现的输出，覆盖各个长度区间
+    CU_ASSERT_EQUAL(xxh3_64((const uint8_t *)"hello", 5, 0), 0x9555e8555c62dcfdULL);
+    CU_ASSERT_EQUAL(xxh3_64(msg, 64, 42), 0x19611ac4647c1dfdULL);
+
+    // 大小写不敏感的版本等价于对小写输入求哈希
+    CU_ASSERT_EQUAL(siphash_nocase((const uint8_t *)"Hello, World 12", 15, key),
+                    siphash((const uint8_t *)"hello, world 12", 15, key));
+    CU_ASSERT_NOT_EQUAL(siphash((const uint8_t *)"Hello", 5, key),
+                        siphash((const uint8_t *)"hello", 5, key));
+
+    // 种子在启动时已经随机初始化
+    memcpy(saved, dictGetHashFunctionSeed(), sizeof(saved));
+    CU_ASSERT_NOT_EQUAL(memcmp(saved, zero, sizeof(zero)), 0);
+    dictSetHashFunctionSeed(key);
+    CU_ASSERT_EQUAL(dictGenSipHash24Function(msg, 15), 0xa129ca6149be45e5ULL);
+    CU_ASSERT_EQUAL(dictGenHashFunction(msg, 15), siphash(msg, 15, key));
+    dictSetHashFunctionSeed(saved);
+
+    // 使用大小写不敏感哈希的字典
+    d = dictCreate(&caseType, NULL);
+    CU_ASSERT_EQUAL(dictAdd(d, sdsnew("Content-Type"), NULL), DICT_OK);
+    CU_ASSERT_EQUAL(dictAdd(d, sdsnew("Content-Length"), NULL), DICT_OK);
+    k = sdsnew("CONTENT-TYPE");
+    CU_ASSERT_NOT_EQUAL(dictFind(d, k), NULL);
+    CU_ASSERT_EQUAL(dictAdd(d, k, NULL), DICT_ERR);
+    sdsfree(k);
+    k = sdsnew("content-length");
+    CU_ASSERT_NOT_EQUAL(dictFind(d, k), NULL);
+    sdsfree(k);
+    dictRelease(d);
+}
+
+
+static uint64_t batchHashCallback(const void *key) {
+    return dictGenHashFunction(key, sdslen((sds)key));
+}
+
+static void batchHashBatchCallback(const void **keys, size_t n, uint64_t *hashes) {
+    size_t lens[DICT_FIND_BATCH], i;
+
+    for (i = 0; i < n; i++) {
+        lens[i] = sdslen((sds)keys[i]);
+    }
+    dictGenHashFunctionBatch(keys, lens, n, hashes);
+}
+
+static int batchCompareCallback(void *privdata, const void *key1, const void *key2) {
+    size_t l1 = sdslen((sds)key1), l2 = sdslen((sds)key2);
+    DICT_NOTUSED(privdata);
+
+    return l1 == l2 && memcmp(key1, key2, l1) == 0;
+}
+
+static dictType batchType = {
+    batchHashCallback,
+    NULL,
+    NULL,
+    batchCompareCallback,
+    caseFreeCallback,
+    NULL,
+    0,
+    0,
+    NULL,
+    NULL,
+    batchHashBatchCallback
+};
+
+
+void siphashMultiTest(void) {
+    uint8_t key[16], buf[200];
+    const uint8_t *in[8];
+    size_t lens[8];
+    uint64_t out[8];
+    long j, count = 1000;
+    int force, round, i;
+    void *keys[1000], *vals[1000];
+    dictEntry *found[1000];
+    dict *d;
+
+    for (i = 0; i < 16; i++) key[i] = i * 7;
+    for (i = 0; i < (int)sizeof(buf); i++) buf[i] = i * 31 + 1;
+
+    // 标量和SIMD实现都与逐个调用siphash一致，包括长度不同的键
+    for (force = 1; force >= 0; force--) {
+        siphash_multi_force_scalar(force);
+        for (round = 0; round < 200; round++) {
+            for (i = 0; i < 8; i++) {
+                // 一半的轮次各通道长度相同，另一半长度各不相同
+                lens[i] = round & 1 ? (size_t)(round * 7 + i * 13) % 100 : (size_t)round % 100;
+                in[i] = buf + (round + i) % 64;
+            }
+            siphash_x8(in, lens, key, out);
+            for (i = 0; i < 8; i++) {
+                CU_ASSERT_EQUAL(out[i], siphash(in[i], lens[i], key));
+            }
+            siphash_x4(in + 2, lens + 2, key, out);
+            for (i = 0; i < 4; i++) {
+                CU_ASSERT_EQUAL(out[i], siphash(in[i + 2], lens[i + 2], key));
+            }
+        }
+    }
+    siphash_multi_force_scalar(0);
+
+    // 批量添加和查找
+    d = dictCreate(&batchType, NULL);
+    for (j = 0; j < count; j++) {
+        keys[j] = sdsfromlonglong(j * 1000003);
+        vals[j] = (void *)j;
+    }
+    CU_ASSERT_EQUAL(dictAddMany(d, keys, vals, count, found), (size_t)count);
+    CU_ASSERT_EQUAL(dictSize(d), count);
+    for (j = 0; j < count; j++) {
+        CU_ASSERT_PTR_NOT_NULL(found[j]);
+    }
+
+    // 已存在的键不会被添加，所有权仍在调用者
+    keys[0] = sdsfromlonglong(0);
+    keys[1] = sdsfromlonglong(-1);
+    CU_ASSERT_EQUAL(dictAddMany(d, keys, NULL, 2, found), 1);
+    CU_ASSERT_PTR_NULL(found[0]);
+    CU_ASSERT_PTR_NOT_NULL(found[1]);
+    sdsfree(keys[0]);
+
+    for (j = 0; j < count; j++) {
+        keys[j] = sdsfromlonglong(j * 1000003);
+    }
+    CU_ASSERT_EQUAL(dictFindMany(d, (const void **)keys, count, found), (size_t)count);
+    for (j = 0; j < count; j++) {
+        CU_ASSERT_EQUAL(dictGetSignedIntegerVal(found[j]), j);
+        CU_ASSERT_EQUAL(dictFind(d, keys[j]), found[j]);
+        sdsfree(keys[j]);
+    }
+    dictRelease(d);
+}
@@ -0,0 +1,207 @@
+#include <string.h>
+#include <pthread.h>
+#include <CUnit/CUnit.h>
+
+#include "lazyfree.h"
+#include "zmalloc.h"
+#include "testcases.h"
+
+#define LAZYFREE_TEST_KEYS 200000
+
+
+// 值的销毁次数，后台线程也会修改
+static long destroyed = 0;
+
+static uint64_t lazyHashCallback(const void *key) {
+    return dictGenHashFunction(key, sdslen((sds)key));
+}
+
+static int lazyCompareCallback(void *privdata, const void *key1, const void *key2) {
+    size_t l1 = sdslen((sds)key1), l2 = sdslen((sds)key2);
+    DICT_NOTUSED(privdata);
+
+    return l1 == l2 && memcmp(key1, key2, l1) == 0;
+}
+
+static void lazyKeyDestructor(void *privdata, void *key) {
+    DICT_NOTUSED(privdata);
+
+    sdsfree(key);
+}
+
+static void lazyValDestructor(void *privdata, void *val) {
+    DICT_NOTUSED(privdata);
+    DICT_NOTUSED(val);
+
+    __atomic_add_fetch(&destroyed, 1, __ATOMIC_RELAXED);
+}
+
+static dictType lazyType = {
+    lazyHashCallback,
+    NULL,
+    NULL,
+    lazyCompareCallback,
+    lazyKeyDestructor,
+    lazyValDestructor
+};
+
+// 所有键落在同一个桶中，形成一条很长的链表
+static uint64_t chainHashCallback(const void *key) {
+    DICT_NOTUSED(key);
+
+    return 0;
+}
+
+static dictType chainType = {
+    chainHashCallback,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    lazyValDestructor
+};
+
+static void lazyListFree(void *ptr) {
+    DICT_NOTUSED(ptr);
+
+    __atomic_add_fetch(&destroyed, 1, __ATOMIC_RELAXED);
+}
+
+static long destroyedCount(void) {
+    return __atomic_load_n(&destroyed, __ATOMIC_RELAXED);
+}
+
+static dict *lazyCreateDict(long count) {
+    dict *d = dictCreate(&lazyType, NULL);
+    long j;
+
+    for (j = 0; j < count; j++) {
+        dictAdd(d, sdsfromlonglong(j), (void *)j);
+    }
+    return d;
+}
+
+// 阻塞后台线程的任务，直到测试调用lazyGateOpen
+static pthread_mutex_t gate_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gate_cond = PTHREAD_COND_INITIALIZER;
+static int gate_open = 0;
+
+static void lazyGateJob(void *ptr) {
+    DICT_NOTUSED(ptr);
+
+    pthread_mutex_lock(&gate_mutex);
+    while (!gate_open) {
+        pthread_cond_wait(&gate_cond, &gate_mutex);
+    }
+    pthread_mutex_unlock(&gate_mutex);
+}
+
+static void lazyGateOpen(void) {
+    pthread_mutex_lock(&gate_mutex);
+    gate_open = 1;
+    pthread_cond_broadcast(&gate_cond);
+    pthread_mutex_unlock(&gate_mutex);
+}
+
+
+void dictEmptyStepTest(void) {
+    long j, count = 10000, steps = 0;
+    dict *d = lazyCreateDict(count);
+    int more;
+
+    // 停在rehash中途，两个表都有节点
+    dictExpand(d, count * 4);
+    dictRehash(d, 100);
+    CU_ASSERT_TRUE(dictIsRehashing(d));
+
+    destroyed = 0;
+    while (dictEmptyStep(d, 100)) {
+        steps++;
+        // 每一步最多释放budget个节点
+        CU_ASSERT_TRUE(destroyedCount() <= steps * 100);
+    }
+    CU_ASSERT_TRUE(steps >= count / 100);
+    CU_ASSERT_EQUAL(destroyedCount(), count);
+    CU_ASSERT_EQUAL(dictSize(d), 0);
+    CU_ASSERT_FALSE(dictIsRehashing(d));
+    CU_ASSERT_EQUAL(d->ht[0].size, 0);
+
+    // 清空后的字典可以继续使用
+    CU_ASSERT_EQUAL(dictAdd(d, sdsnew("key"), NULL), DICT_OK);
+    CU_ASSERT_EQUAL(dictSize(d), 1);
+    dictEmpty(d, NULL);
+    CU_ASSERT_EQUAL(dictSize(d), 0);
+    dictRelease(d);
+
+    // 清空到一半时直接释放
+    d = lazyCreateDict(count);
+    while (dictIsRehashing(d)) {
+        dictRehash(d, 100);
+    }
+    destroyed = 0;
+    dictEmptyStep(d, 1000);
+    CU_ASSERT_TRUE(destroyedCount() > 0 && destroyedCount() < count);
+    dictRelease(d);
+    CU_ASSERT_EQUAL(destroyedCount(), count);
+
+    // 单个桶中的长链表也按预算分多次释放
+    d = dictCreate(&chainType, NULL);
+    for (j = 1; j <= 1000; j++) {
+        dictAdd(d, (void *)j, (void *)j);
+    }
+    while (dictIsRehashing(d)) {
+        dictRehash(d, 100);
+    }
+    destroyed = 0;
+    steps = 0;
+    do {
+        long before = destroyedCount();
+
+        more = dictEmptyStep(d, 10);
+        CU_ASSERT_TRUE(destroyedCount() - before <= 10);
+        steps++;
+    } while (more);
+    CU_ASSERT_TRUE(steps >= 100);
+    CU_ASSERT_EQUAL(destroyedCount(), 1000);
+    CU_ASSERT_EQUAL(dictSize(d), 0);
+    dictRelease(d);
+}
+
+void lazyfreeTest(void) {
+    unsigned long long freed = lazyfreeFreedObjects();
+    list *l = listCreate();
+    long j;
+
+    // 小字典在调用者线程中同步释放
+    destroyed = 0;
+    lazyfreeDict(lazyCreateDict(10));
+    CU_ASSERT_EQUAL(destroyedCount(), 10);
+    CU_ASSERT_EQUAL(lazyfreeFreedObjects(), freed);
+
+    // 大字典、链表和sds交给后台线程
+    destroyed = 0;
+    lazyfreeDict(lazyCreateDict(LAZYFREE_TEST_KEYS));
+    listSetFreeMethod(l, lazyListFree);
+    for (j = 0; j < 1000; j++) {
+        listAddNodeTail(l, (void *)(j + 1));
+    }
+    lazyfreeList(l);
+    lazyfreeSds(sdsnewlen(NULL, 1 << 20));
+    lazyfreeSds(NULL);
+    lazyfreeWait();
+    CU_ASSERT_EQUAL(lazyfreePendingJobs(), 0);
+    CU_ASSERT_EQUAL(lazyfreeFreedObjects(), freed + 3);
+    CU_ASSERT_EQUAL(destroyedCount(), LAZYFREE_TEST_KEYS + 1000);
+
+    // 后台线程被阻塞时，lazyfreeDict只是提交任务，调用者线程中没有释放任何元素
+    gate_open = 0;
+    lazyfreeGeneric(lazyGateJob, NULL);
+    destroyed = 0;
+    lazyfreeDict(lazyCreateDict(LAZYFREE_TEST_KEYS));
+    CU_ASSERT_EQUAL(destroyedCount(), 0);
+    CU_ASSERT_EQUAL(lazyfreePendingJobs(), 2);
+    lazyGateOpen();
+    lazyfreeWait();
+    CU_ASSERT_EQUAL(destroyedCount(), LAZYFREE_TEST_KEYS);
+    CU_ASSERT_EQUAL(lazyfreeFreedObjects(), freed + 5);
+}
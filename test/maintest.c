@@ -27,8 +27,35 @@ int main(int argc, char*argv[]) {
     }
 
     CU_add_test(pSuite, "test of sds", sdsTest);
+    CU_add_test(pSuite, "test of sds resize", sdsResizeTest);
+    CU_add_test(pSuite, "test of sds type 5", sdsType5Test);
+    CU_add_test(pSuite, "test of sds integer conversion", sdsIntegerTest);
+    CU_add_test(pSuite, "test of sdscatfmt", sdsCatFmtTest);
+    CU_add_test(pSuite, "test of sds range, trim, split and case mapping", sdsStringOpsTest);
+    CU_add_test(pSuite, "test of sdsbuilder", sdsbuilderTest);
+    CU_add_test(pSuite, "test of sds mmap growth", sdsMmapGrowthTest);
     CU_add_test(pSuite, "test of dlist", dlistTest);
     CU_add_test(pSuite, "test of dict", dictTest);
+    CU_add_test(pSuite, "test of oadict", oadictTest);
+    CU_add_test(pSuite, "test of dictFindMany", dictFindManyTest);
+    CU_add_test(pSuite, "test of dictScan", dictScanTest);
+    CU_add_test(pSuite, "test of dict shrink", dictShrinkTest);
+    CU_add_test(pSuite, "test of dict entry pool", dictPoolTest);
+    CU_add_test(pSuite, "test of dict entry layouts", dictLayoutTest);
+    CU_add_test(pSuite, "test of intdict", intdictTest);
+    CU_add_test(pSuite, "test of dict random sampling", dictRandomTest);
+    CU_add_test(pSuite, "test of dict rehash scheduler", dictRehashSchedulerTest);
+    CU_add_test(pSuite, "test of dict iterators", dictIteratorTest);
+    CU_add_test(pSuite, "test of dict bulk load", dictBulkLoadTest);
+    CU_add_test(pSuite, "test of dict table allocation", dictTableAllocTest);
+    CU_add_test(pSuite, "test of dict stats", dictStatsTest);
+    CU_add_test(pSuite, "test of dictEmptyStep", dictEmptyStepTest);
+    CU_add_test(pSuite, "test of lazyfree", lazyfreeTest);
+    CU_add_test(pSuite, "test of Dict template", dictTemplateTest);
+    CU_add_test(pSuite, "test of hash functions", hashTest);
+    CU_add_test(pSuite, "test of multi-buffer siphash", siphashMultiTest);
+    CU_add_test(pSuite, "test of concurrentDict", concurrentDictTest);
+    CU_add_test(pSuite, "test of rcudict", rcudictTest);
 
     CU_basic_set_mode(CU_BRM_VERBOSE);
     CU_basic_run_tests();
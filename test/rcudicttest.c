@@ -0,0 +1,147 @@
+#include <string.h>
+#include <pthread.h>
+#include <CUnit/CUnit.h>
+
+#include "rcudict.h"
+#include "sds.h"
+#include "zmalloc.h"
+#include "testcases.h"
+
+#define RCU_READERS 3
+#define RCU_STABLE_KEYS 2000
+#define RCU_VOLATILE_KEYS 30000
+
+
+static uint64_t rcuHashCallback(const void *key) {
+    return dictGenHashFunction(key, sdslen((sds)key));
+}
+
+static int rcuCompareCallback(void *privdata, const void *key1, const void *key2) {
+    size_t l1 = sdslen((sds)key1), l2 = sdslen((sds)key2);
+    DICT_NOTUSED(privdata);
+
+    return l1 == l2 && memcmp(key1, key2, l1) == 0;
+}
+
+static void rcuFreeCallback(void *privdata, void *val) {
+    DICT_NOTUSED(privdata);
+
+    sdsfree(val);
+}
+
+static dictType rcuType = {
+    rcuHashCallback,
+    NULL,
+    NULL,
+    rcuCompareCallback,
+    rcuFreeCallback,
+    NULL
+};
+
+typedef struct rcuTestState {
+    rcudict *d;
+    sds *probes;
+    int done;
+    long errors[RCU_READERS];
+    long lookups[RCU_READERS];
+} rcuTestState;
+
+typedef struct rcuReaderArg {
+    rcuTestState *state;
+    int id;
+} rcuReaderArg;
+
+
+// 偶数键一直存在，奇数键不断被添加和删除；找到的节点，值必须与键对应
+static void *rcuReaderThread(void *privdata) {
+    rcuReaderArg *arg = privdata;
+    rcuTestState *state = arg->state;
+    int reader = rcudictRegisterReader(state->d);
+    unsigned long r = arg->id * 7919 + 1;
+    long total = RCU_STABLE_KEYS * 2 + RCU_VOLATILE_KEYS * 2;
+
+    while (!__atomic_load_n(&state->done, __ATOMIC_ACQUIRE)) {
+        int i;
+
+        rcudictReadLock(state->d, reader);
+        for (i = 0; i < 64; i++) {
+            long j;
+            rcudictEntry *de;
+
+            r = r * 6364136223846793005UL + 1442695040888963407UL;
+            j = (long)((r >> 33) % total);
+            de = rcudictFind(state->d, state->probes[j]);
+            if (j % 2 == 0 && j < RCU_STABLE_KEYS * 2 && de == NULL) {
+                state->errors[arg->id]++;
+            }
+            if (de && (dictGetSignedIntegerVal(de) != j ||
+                       sdslen((sds)de->key) != sdslen(state->probes[j]))) {
+                state->errors[arg->id]++;
+            }
+            state->lookups[arg->id]++;
+        }
+        rcudictReadUnlock(state->d, reader);
+    }
+    return NULL;
+}
+
+
+void rcudictTest(void) {
+    rcuTestState state;
+    rcuReaderArg args[RCU_READERS];
+    pthread_t readers[RCU_READERS];
+    long total = RCU_STABLE_KEYS * 2 + RCU_VOLATILE_KEYS * 2, j, round;
+    int i;
+
+    memset(&state, 0, sizeof(state));
+    state.d = rcudictCreate(&rcuType, NULL);
+    state.probes = zmalloc(sizeof(sds) * total);
+    for (j = 0; j < total; j++) {
+        state.probes[j] = sdsfromlonglong(j);
+    }
+    for (j = 0; j < RCU_STABLE_KEYS * 2; j += 2) {
+        CU_ASSERT_EQUAL(rcudictAdd(state.d, sdsfromlonglong(j), (void *)j), DICT_OK);
+    }
+
+    for (i = 0; i < RCU_READERS; i++) {
+        args[i].state = &state;
+        args[i].id = i;
+        pthread_create(&readers[i], NULL, rcuReaderThread, &args[i]);
+    }
+
+    // 唯一的写者：反复添加再删除全部奇数键，过程中会多次触发扩容和rehash
+    for (round = 0; round < 3; round++) {
+        for (j = 1; j < total; j += 2) {
+            sds key = sdsfromlonglong(j);
+            if (rcudictAdd(state.d, key, (void *)j) != DICT_OK) {
+                sdsfree(key);
+                CU_FAIL("rcudictAdd");
+            }
+        }
+        for (j = 1; j < total; j += 2) {
+            CU_ASSERT_EQUAL(rcudictDelete(state.d, state.probes[j]), DICT_OK);
+        }
+        CU_ASSERT_EQUAL(rcudictSize(state.d), RCU_STABLE_KEYS);
+    }
+
+    __atomic_store_n(&state.done, 1, __ATOMIC_RELEASE);
+    for (i = 0; i < RCU_READERS; i++) {
+        pthread_join(readers[i], NULL);
+        CU_ASSERT_EQUAL(state.errors[i], 0);
+        CU_ASSERT(state.lookups[i] > 0);
+    }
+
+    // 没有读者之后，rehash可以完成，待回收对象可以全部释放
+    while (rcudictRehash(state.d, 100));
+    rcudictReclaim(state.d);
+    CU_ASSERT_EQUAL(state.d->retiredCount, 0);
+    CU_ASSERT_EQUAL(rcudictAdd(state.d, state.probes[0], NULL), DICT_ERR);
+    CU_ASSERT_EQUAL(rcudictFind(state.d, state.probes[1]), NULL);
+    CU_ASSERT_EQUAL(dictGetSignedIntegerVal(rcudictFind(state.d, state.probes[2])), 2);
+
+    rcudictRelease(state.d);
+    for (j = 0; j < total; j++) {
+        sdsfree(state.probes[j]);
+    }
+    zfree(state.probes);
+}
@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include <string.h>
+#include <CUnit/CUnit.h>
+
+#include "sdsbuilder.h"
+#include "testcases.h"
+
+
+void sdsbuilderTest(void) {
+    char piece[100], expect[10000];
+    struct iovec iov[64];
+    size_t total = 0, off;
+    sdsbuilder b;
+    int i, n;
+    sds s;
+
+    // 块很小，追加的数据跨越块边界
+    sdsbuilderInit(&b, 256);
+    for (i = 0; i < 100; i++) {
+        memset(piece, 'a' + i % 26, i);
+        memcpy(expect + total, piece, i);
+        CU_ASSERT_TRUE(sdsbuilderAppend(&b, piece, i));
+        total += i;
+    }
+    CU_ASSERT_EQUAL(sdsbuilderLen(&b), total);
+
+    // iovec按顺序覆盖所有数据
+    n = sdsbuilderIovec(&b, iov, 64);
+    CU_ASSERT_EQUAL(n, (int)((total + 255) / 256));
+    for (i = 0, off = 0; i < n; i++) {
+        CU_ASSERT_TRUE(memcmp(iov[i].iov_base, expect + off, iov[i].iov_len) == 0);
+        off += iov[i].iov_len;
+    }
+    CU_ASSERT_EQUAL(off, total);
+    CU_ASSERT_EQUAL(sdsbuilderIovec(&b, iov, 2), 2);
+
+    // 模拟writev只写出了一部分
+    sdsbuilderConsume(&b, 1000);
+    CU_ASSERT_EQUAL(sdsbuilderLen(&b), total - 1000);
+    n = sdsbuilderIovec(&b, iov, 64);
+    CU_ASSERT_EQUAL(iov[0].iov_len, 256 - 1000 % 256);
+    CU_ASSERT_TRUE(memcmp(iov[0].iov_base, expect + 1000, iov[0].iov_len) == 0);
+
+    // 丢掉一部分之后继续追加，再一次拷贝成sds
+    CU_ASSERT_TRUE(sdsbuilderAppend(&b, "tail", 4));
+    memcpy(expect + total, "tail", 4);
+    total += 4;
+    s = sdsbuilderFlatten(&b);
+    CU_ASSERT_EQUAL(sdslen(s), total - 1000);
+    CU_ASSERT_TRUE(memcmp(s, expect + 1000, total - 1000) == 0);
+    CU_ASSERT_EQUAL(s[sdslen(s)], '\0');
+    CU_ASSERT_EQUAL(sdsbuilderLen(&b), 0);
+    CU_ASSERT_EQUAL(sdsbuilderIovec(&b, iov, 64), 0);
+    sdsfree(s);
+
+    s = sdsbuilderFlatten(&b);
+    CU_ASSERT_EQUAL(sdslen(s), 0);
+    sdsfree(s);
+
+    sdsbuilderAppend(&b, expect, 600);
+    sdsbuilderConsume(&b, 600);
+    CU_ASSERT_EQUAL(sdsbuilderLen(&b), 0);
+    sdsbuilderReset(&b);
+
+    // 超过阈值的结果直接用mmap分配，之后的拼接用mremap
+    sdsbuilderInit(&b, 0);
+    for (off = 0; off < SDS_MMAP_THRESHOLD; off += sizeof(expect)) {
+        sdsbuilderAppend(&b, expect, sizeof(expect));
+    }
+    s = sdsbuilderFlatten(&b);
+    CU_ASSERT_PTR_NOT_NULL(s);
+    CU_ASSERT_EQUAL(sdslen(s), off);
+#ifdef __linux__
+    CU_ASSERT_TRUE(s[-1] & SDS_FLAG_MMAP);
+#endif
+    CU_ASSERT_TRUE(memcmp(s + off - sizeof(expect), expect, sizeof(expect)) == 0);
+    s = sdscatlen(s, "tail", 4);
+    CU_ASSERT_TRUE(memcmp(s + off, "tail", 4) == 0);
+    sdsfree(s);
+}
+
+void sdsMmapGrowthTest(void) {
+    size_t chunk = 1024 * 1024, j;
+    char *buf = malloc(chunk);
+    sds s = sdsempty();
+
+    // 超过SDS_MMAP_THRESHOLD之后改用mmap，内容保持不变
+    for (j = 0; j < SDS_MMAP_THRESHOLD / chunk + 4; j++) {
+        memset(buf, 'a' + j % 26, chunk);
+        s = sdscatlen(s, buf, chunk);
+    }
+#ifdef __linux__
+    CU_ASSERT_TRUE(s[-1] & SDS_FLAG_MMAP);
+#endif
+    CU_ASSERT_EQUAL(s[-1] & SDS_TYPE_MASK, SDS_TYPE_32);
+    CU_ASSERT_EQUAL(sdslen(s), j * chunk);
+    for (j = 0; j < sdslen(s); j += chunk) {
+        CU_ASSERT_EQUAL(s[j], 'a' + (j / chunk) % 26);
+        CU_ASSERT_EQUAL(s[j + chunk - 1], 'a' + (j / chunk) % 26);
+    }
+
+    // 仍然超过阈值时用mremap缩小，低于阈值时改回普通分配
+    s = sdsRemoveFreeSpace(s);
+    CU_ASSERT_TRUE(sdsavail(s) < 4096);
+#ifdef __linux__
+    // 超过SDS_TYPE_32能记录的长度时换成SDS_TYPE_64的新映射，alloc不会被截断
+    if (sizeof(size_t) > 4) {
+        size_t huge = (size_t)5 << 30;
+
+        j = sdslen(s);
+        s = sdsResize(s, huge);
+        CU_ASSERT_PTR_NOT_NULL(s);
+        CU_ASSERT_TRUE(s[-1] & SDS_FLAG_MMAP);
+        CU_ASSERT_EQUAL(s[-1] & SDS_TYPE_MASK, SDS_TYPE_64);
+        CU_ASSERT_TRUE(sdsalloc(s) >= huge);
+        CU_ASSERT_EQUAL(sdslen(s), j);
+        CU_ASSERT_EQUAL(s[0], 'a');
+        CU_ASSERT_EQUAL(s[j - 1], 'a' + (j / chunk - 1) % 26);
+        CU_ASSERT_EQUAL(s[j], '\0');
+    }
+#endif
+    s = sdsResize(s, chunk);
+    CU_ASSERT_FALSE(s[-1] & SDS_FLAG_MMAP);
+    CU_ASSERT_EQUAL(sdslen(s), chunk);
+    CU_ASSERT_EQUAL(s[chunk - 1], 'a');
+    sdsfree(s);
+
+    // 长度超过4GB时头部和分配大小不会被截断
+    if (sizeof(size_t) > 4) {
+        size_t huge = ((size_t)4 << 30) + 16;
+
+        s = sdsnewlen(SDS_NOINIT, huge);
+        CU_ASSERT_PTR_NOT_NULL(s);
+        CU_ASSERT_EQUAL(s[-1] & SDS_TYPE_MASK, SDS_TYPE_64);
+        CU_ASSERT_EQUAL(sdslen(s), huge);
+        CU_ASSERT_EQUAL(s[huge], '\0');
+        sdsfree(s);
+    }
+    CU_ASSERT_PTR_NULL(sdsnewlen(SDS_NOINIT, (size_t)-1));
+
+    // 关闭后使用普通的zrealloc
+    sdsSetMmapGrowth(0);
+    s = sdsnewlen(NULL, SDS_MMAP_THRESHOLD);
+    s = sdscatlen(s, "x", 1);
+    CU_ASSERT_FALSE(s[-1] & SDS_FLAG_MMAP);
+    CU_ASSERT_EQUAL(s[SDS_MMAP_THRESHOLD], 'x');
+    sdsfree(s);
+    sdsSetMmapGrowth(1);
+    free(buf);
+}
@@ -1,3 +1,7 @@
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
 #include <CUnit/CUnit.h>
 
 #include "sds.h"
@@ -28,4 +32,301 @@ void sdsTest(void) {
 
     sdsfree(o);
     sdsfree(s);
-}
\ No newline at end of file
+}
+
+void sdsResizeTest(void) {
+    sds s = sdsnewlen("abc", 3);
+    size_t alloc;
+    int i;
+
+    // 分配器取整多出的字节记在alloc中
+    s = sdscatlen(s, "", 0);
+    s = sdsMakeRoomForNonGreedy(s, 1);
+    CU_ASSERT_TRUE(sdsalloc(s) >= 4);
+    CU_ASSERT_EQUAL(sdsAllocSize(s), sizeof(struct sdshdr8) + sdsalloc(s) + 1);
+
+    // 贪婪扩充预留空间，非贪婪扩充只分配需要的空间
+    for (i = 0; i < 100; i++) {
+        s = sdscatlen(s, "0123456789", 10);
+    }
+    CU_ASSERT_EQUAL(sdslen(s), 1003);
+    CU_ASSERT_TRUE(sdsavail(s) > 0);
+    alloc = sdsalloc(s);
+
+    s = sdsRemoveFreeSpace(s);
+    CU_ASSERT_EQUAL(sdslen(s), 1003);
+    CU_ASSERT_TRUE(sdsalloc(s) < alloc);
+    CU_ASSERT_TRUE(sdsavail(s) < 16);
+    CU_ASSERT_NSTRING_EQUAL(s, "abc0123456789", 13);
+
+    s = sdsMakeRoomForNonGreedy(s, 1000);
+    CU_ASSERT_TRUE(sdsavail(s) >= 1000 && sdsavail(s) < 1016);
+
+    // 缩小到字符串长度以下时截断，头部类型随之变化
+    s = sdsResize(s, 5);
+    CU_ASSERT_EQUAL(sdslen(s), 5);
+    CU_ASSERT_STRING_EQUAL(s, "abc01");
+    CU_ASSERT_EQUAL(s[-1] & SDS_TYPE_MASK, SDS_TYPE_5);
+
+    s = sdsResize(s, 70000);
+    CU_ASSERT_EQUAL(sdslen(s), 5);
+    CU_ASSERT_TRUE(sdsalloc(s) >= 70000);
+    CU_ASSERT_EQUAL(s[-1] & SDS_TYPE_MASK, SDS_TYPE_32);
+    CU_ASSERT_STRING_EQUAL(s, "abc01");
+    sdsfree(s);
+}
+
+
+void sdsType5Test(void) {
+    sds s = sdsnew("key:1234");
+    sds e = sdsempty();
+    char buf[64];
+    int i;
+
+    // 短字符串使用1字节头部，长度在flags的高5位
+    CU_ASSERT_EQUAL(s[-1] & SDS_TYPE_MASK, SDS_TYPE_5);
+    CU_ASSERT_EQUAL(sdslen(s), 8);
+    CU_ASSERT_EQUAL(sdsavail(s), 0);
+    CU_ASSERT_EQUAL(sdsAllocSize(s), sizeof(struct sdshdr5) + 8 + 1);
+    CU_ASSERT_EQUAL(sdsembedsize(8), sizeof(struct sdshdr5) + 8 + 1);
+
+    // 空字符串通常会被拼接，仍然使用SDS_TYPE_8
+    CU_ASSERT_EQUAL(e[-1] & SDS_TYPE_MASK, SDS_TYPE_8);
+
+    // 拼接时升级为可以预留空间的类型
+    s = sdscat(s, "5");
+    CU_ASSERT_EQUAL(s[-1] & SDS_TYPE_MASK, SDS_TYPE_8);
+    CU_ASSERT_EQUAL(sdslen(s), 9);
+    CU_ASSERT_STRING_EQUAL(s, "key:12345");
+    CU_ASSERT_TRUE(sdsavail(s) > 0);
+
+    // 去掉空闲空间后回到SDS_TYPE_5
+    s = sdsRemoveFreeSpace(s);
+    CU_ASSERT_EQUAL(s[-1] & SDS_TYPE_MASK, SDS_TYPE_5);
+    CU_ASSERT_STRING_EQUAL(s, "key:12345");
+
+    // 31字节是SDS_TYPE_5能表示的最大长度
+    for (i = 0; i < 32; i++) {
+        buf[i] = 'a' + i % 26;
+    }
+    sdsfree(s);
+    s = sdsnewlen(buf, 31);
+    CU_ASSERT_EQUAL(s[-1] & SDS_TYPE_MASK, SDS_TYPE_5);
+    CU_ASSERT_EQUAL(sdslen(s), 31);
+    sdsfree(s);
+    s = sdsnewlen(buf, 32);
+    CU_ASSERT_EQUAL(s[-1] & SDS_TYPE_MASK, SDS_TYPE_8);
+    CU_ASSERT_EQUAL(sdslen(s), 32);
+
+    s = sdscpy(s, "short");
+    CU_ASSERT_STRING_EQUAL(s, "short");
+    sdsfree(s);
+    sdsfree(e);
+}
+
+
+void sdsIntegerTest(void) {
+    static const long long values[] = {
+        0, 1, -1, 9, 10, 99, 100, -100, 12345, 1000000000, -999999999999LL,
+        LLONG_MAX, LLONG_MIN
+    };
+    char buf[SDS_LLSTR_SIZE], expect[32];
+    unsigned long long u;
+    long long v;
+    double d;
+    unsigned long i;
+    sds s;
+
+    // 与snprintf的输出一致，并且能被string2ll解析回来
+    for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        int len = sdsll2str(buf, values[i]);
+
+        snprintf(expect, sizeof(expect), "%lld", values[i]);
+        CU_ASSERT_STRING_EQUAL(buf, expect);
+        CU_ASSERT_EQUAL(len, (int)strlen(expect));
+        CU_ASSERT_TRUE(string2ll(buf, len, &v));
+        CU_ASSERT_EQUAL(v, values[i]);
+    }
+    CU_ASSERT_EQUAL(sdsull2str(buf, ULLONG_MAX), 20);
+    CU_ASSERT_STRING_EQUAL(buf, "18446744073709551615");
+    CU_ASSERT_TRUE(string2ull(buf, 20, &u));
+    CU_ASSERT_EQUAL(u, ULLONG_MAX);
+
+    // 严格解析：溢出、空白、正号、前导0、"-0"和非数字都失败
+    CU_ASSERT_FALSE(string2ll("9223372036854775808", 19, &v));
+    CU_ASSERT_FALSE(string2ll("-9223372036854775809", 20, &v));
+    CU_ASSERT_FALSE(string2ull("18446744073709551616", 20, &u));
+    CU_ASSERT_FALSE(string2ll("", 0, &v));
+    CU_ASSERT_FALSE(string2ll("-", 1, &v));
+    CU_ASSERT_FALSE(string2ll(" 1", 2, &v));
+    CU_ASSERT_FALSE(string2ll("+1", 2, &v));
+    CU_ASSERT_FALSE(string2ll("01", 2, &v));
+    CU_ASSERT_FALSE(string2ll("-0", 2, &v));
+    CU_ASSERT_FALSE(string2ll("12a", 3, &v));
+    CU_ASSERT_FALSE(string2ull("-1", 2, &u));
+    CU_ASSERT_TRUE(string2ll("123456", 3, &v));
+    CU_ASSERT_EQUAL(v, 123);
+
+    CU_ASSERT_TRUE(string2d("3.25", 4, &d));
+    CU_ASSERT_DOUBLE_EQUAL(d, 3.25, 0);
+    CU_ASSERT_TRUE(string2d("-1e10", 5, &d));
+    CU_ASSERT_DOUBLE_EQUAL(d, -1e10, 0);
+    CU_ASSERT_FALSE(string2d(" 1.5", 4, &d));
+    CU_ASSERT_FALSE(string2d("1.5x", 4, &d));
+    CU_ASSERT_FALSE(string2d("nan", 3, &d));
+    CU_ASSERT_FALSE(string2d("1e999", 5, &d));
+    CU_ASSERT_FALSE(string2d("", 0, &d));
+
+    // 直接写到sds末尾
+    s = sdsnew("len:");
+    s = sdscatll(s, -42);
+    s = sdscat(s, ",");
+    s = sdscatull(s, ULLONG_MAX);
+    CU_ASSERT_STRING_EQUAL(s, "len:-42,18446744073709551615");
+    CU_ASSERT_EQUAL(sdslen(s), strlen("len:-42,18446744073709551615"));
+    sdsfree(s);
+}
+
+
+void sdsCatFmtTest(void) {
+    sds name = sdsnew("key");
+    sds s = sdsempty();
+
+    s = sdscatfmt(s, "*%i\r\n$%i\r\n", 3, 5);
+    CU_ASSERT_STRING_EQUAL(s, "*3\r\n$5\r\n");
+
+    s = sdscatfmt(s, "%s=%S;%I|%u|%U 100%%",
+        "name", name, LLONG_MIN, UINT_MAX, ULLONG_MAX);
+    CU_ASSERT_STRING_EQUAL(s,
+        "*3\r\n$5\r\nname=key;-9223372036854775808|4294967295|18446744073709551615 100%");
+    CU_ASSERT_EQUAL(sdslen(s), strlen(s));
+    sdsfree(s);
+
+    // 不支持的格式和结尾单独的'%'原样输出
+    s = sdscatfmt(sdsempty(), "%d%i%", -7);
+    CU_ASSERT_STRING_EQUAL(s, "d-7%");
+    sdsfree(s);
+
+    // 参数比格式中的文字长得多时也能正确扩充
+    s = sdscatfmt(sdsnew("x"), "%s%s", "0123456789abcdefghijklmnopqrstuvwxyz", "0123456789abcdefghijklmnopqrstuvwxyz");
+    CU_ASSERT_EQUAL(sdslen(s), 73);
+    sdsfree(s);
+    sdsfree(name);
+}
+
+
+// 逐字节的参考实现：按分隔符分割后计数，并检查每一段
+static int naiveSplitCheck(const char *s, size_t len, const char *sep, size_t seplen, sds *tokens, int count) {
+    size_t start = 0, j = 0;
+    int n = 0;
+
+    while (seplen <= len && j + seplen <= len) {
+        if (memcmp(s + j, sep, seplen) == 0) {
+            if (n >= count || sdslen(tokens[n]) != j - start || memcmp(tokens[n], s + start, j - start))
+                return 0;
+            n++;
+            j += seplen;
+            start = j;
+        } else {
+            j++;
+        }
+    }
+    if (n >= count || sdslen(tokens[n]) != len - start || memcmp(tokens[n], s + start, len - start))
+        return 0;
+    return n + 1 == count;
+}
+
+static void *simdImplThread(void *arg) {
+    *(const char **)arg = sdsSimdImpl();
+    return NULL;
+}
+
+void sdsStringOpsTest(void) {
+    static const char alphabet[] = " \t,:abcXYZ@[`{";
+    const char *impl = sdsSimdImpl(), *other = NULL;
+    unsigned long r = 7;
+    int force, i, count;
+    pthread_t tid;
+    sds s, *tokens;
+
+    // sdsrange与Redis的语义相同，不重新分配内存
+    s = sdsnew("Hello World");
+    sdsrange(s, 1, -1);
+    CU_ASSERT_STRING_EQUAL(s, "ello World");
+    sdsrange(s, -5, -1);
+    CU_ASSERT_STRING_EQUAL(s, "World");
+    sdsrange(s, 2, 100);
+    CU_ASSERT_STRING_EQUAL(s, "rld");
+    sdsrange(s, 5, 8);
+    CU_ASSERT_EQUAL(sdslen(s), 0);
+    sdsfree(s);
+
+    s = sdsnew("  xx hello xx ");
+    s = sdstrim(s, " x");
+    CU_ASSERT_STRING_EQUAL(s, "hello");
+    s = sdstrim(s, "helo");
+    CU_ASSERT_EQUAL(sdslen(s), 0);
+    sdsfree(s);
+
+    s = sdsnew("hello");
+    s = sdsmapchars(s, "lol", "01X", 3);
+    CU_ASSERT_STRING_EQUAL(s, "he001");
+    sdsfree(s);
+
+    tokens = sdssplitlen("a--b----c", 9, "--", 2, &count);
+    CU_ASSERT_EQUAL(count, 4);
+    CU_ASSERT_STRING_EQUAL(tokens[3], "c");
+    CU_ASSERT_EQUAL(sdslen(tokens[2]), 0);
+    sdsfreesplitres(tokens, count);
+    tokens = sdssplitlen("", 0, ",", 1, &count);
+    CU_ASSERT_EQUAL(count, 0);
+    sdsfreesplitres(tokens, count);
+    CU_ASSERT_PTR_NULL(sdssplitlen("a", 1, "", 0, &count));
+
+    // SIMD和标量实现与逐字节的参考实现一致，长度覆盖16/32字节块的边界
+    for (force = 0; force <= 1; force++) {
+        sdsSimdForceScalar(force);
+        for (i = 0; i < 2000; i++) {
+            size_t len = i % 200, j, left, right;
+            char buf[200], lower[200], upper[200];
+            const char *cset = (i & 1) ? " \t" : " \t,:abcXYZ@";
+            const char *sep = (i & 2) ? "," : ", ";
+
+            for (j = 0; j < len; j++) {
+                r = r * 6364136223846793005UL + 1442695040888963407UL;
+                // 两端的字符更多落在修剪集合中
+                buf[j] = alphabet[(r >> 33) % ((j < 40 || j + 40 > len) ? 2 : sizeof(alphabet) - 1)];
+                lower[j] = (buf[j] >= 'A' && buf[j] <= 'Z') ? buf[j] + 32 : buf[j];
+                upper[j] = (buf[j] >= 'a' && buf[j] <= 'z') ? buf[j] - 32 : buf[j];
+            }
+
+            s = sdsnewlen(buf, len);
+            sdstolower(s);
+            CU_ASSERT_TRUE(memcmp(s, lower, len) == 0);
+            sdstoupper(s);
+            CU_ASSERT_TRUE(memcmp(s, upper, len) == 0);
+            sdsfree(s);
+
+            for (left = 0; left < len && strchr(cset, buf[left]); left++);
+            for (right = len; right > left && strchr(cset, buf[right - 1]); right--);
+            s = sdstrim(sdsnewlen(buf, len), cset);
+            CU_ASSERT_EQUAL(sdslen(s), right - left);
+            CU_ASSERT_TRUE(memcmp(s, buf + left, right - left) == 0);
+            sdsfree(s);
+
+            tokens = sdssplitlen(buf, len, sep, strlen(sep), &count);
+            CU_ASSERT_TRUE(len == 0 ? count == 0 : naiveSplitCheck(buf, len, sep, strlen(sep), tokens, count));
+            sdsfreesplitres(tokens, count);
+        }
+    }
+    sdsSimdForceScalar(0);
+
+    // 强制标量实现只影响调用线程
+    sdsSimdForceScalar(1);
+    CU_ASSERT_STRING_EQUAL(sdsSimdImpl(), "scalar");
+    pthread_create(&tid, NULL, simdImplThread, &other);
+    pthread_join(tid, NULL);
+    CU_ASSERT_STRING_EQUAL(other, impl);
+    sdsSimdForceScalar(0);
+    CU_ASSERT_STRING_EQUAL(sdsSimdImpl(), impl);
+}
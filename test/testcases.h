@@ -2,7 +2,34 @@
 #define __TESTCASES_H__
 
 void sdsTest(void);
+void sdsResizeTest(void);
+void sdsType5Test(void);
+void sdsIntegerTest(void);
+void sdsCatFmtTest(void);
+void sdsStringOpsTest(void);
+void sdsbuilderTest(void);
+void sdsMmapGrowthTest(void);
 void dlistTest(void);
 void dictTest(void);
+void oadictTest(void);
+void dictFindManyTest(void);
+void dictScanTest(void);
+void dictShrinkTest(void);
+void dictPoolTest(void);
+void dictLayoutTest(void);
+void intdictTest(void);
+void dictRandomTest(void);
+void dictRehashSchedulerTest(void);
+void dictIteratorTest(void);
+void dictBulkLoadTest(void);
+void dictTableAllocTest(void);
+void dictStatsTest(void);
+void dictEmptyStepTest(void);
+void lazyfreeTest(void);
+void dictTemplateTest(void);
+void hashTest(void);
+void siphashMultiTest(void);
+void concurrentDictTest(void);
+void rcudictTest(void);
 
 #endif
\ No newline at end of file